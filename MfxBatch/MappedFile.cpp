@@ -0,0 +1,114 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string & path)
+	: m_data(nullptr)
+	, m_size(0)
+	, m_file(INVALID_HANDLE_VALUE)
+	, m_mapping(nullptr)
+{
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Could not open '" + path + "'");
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size)) {
+		CloseHandle(m_file);
+		throw std::runtime_error("Could not get the size of '" + path + "'");
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+	if (m_size == 0) return;
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (nullptr != m_mapping) {
+		m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (nullptr == m_data) {
+		if (nullptr != m_mapping) CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw std::runtime_error("Could not map '" + path + "' in memory");
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (nullptr != m_data) UnmapViewOfFile(m_data);
+	if (nullptr != m_mapping) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+
+#else // _WIN32
+
+MappedFile::MappedFile(const std::string & path)
+	: m_data(nullptr)
+	, m_size(0)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Could not open '" + path + "'");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Could not get the size of '" + path + "'");
+	}
+	m_size = static_cast<size_t>(info.st_size);
+	if (m_size == 0) {
+		close(fd);
+		return;
+	}
+
+	void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file
+	close(fd);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("Could not map '" + path + "' in memory");
+	}
+	// Files are parsed front to back, once
+	madvise(data, m_size, MADV_SEQUENTIAL);
+	m_data = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+	if (nullptr != m_data) munmap(const_cast<char*>(m_data), m_size);
+}
+
+#endif // _WIN32
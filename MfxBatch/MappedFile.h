@@ -0,0 +1,51 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole file. Errors are reported as
+ * std::runtime_error.
+ */
+class MappedFile {
+public:
+	explicit MappedFile(const std::string & path);
+	~MappedFile();
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	const char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const char *m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void *m_file;
+	void *m_mapping;
+#endif // _WIN32
+};
@@ -0,0 +1,773 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "MeshIO.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+///////////////////////////////////////////////////////////////////////////////
+// Parsing helpers
+
+/**
+ * Read position in a text buffer that is not null terminated
+ */
+struct cursor_t {
+	const char *p;
+	const char *end;
+};
+
+static bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+/**
+ * Skip spaces within the current line
+ */
+static void skip_blanks(cursor_t & c)
+{
+	while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\r')) ++c.p;
+}
+
+static void skip_whitespace(cursor_t & c)
+{
+	while (c.p < c.end && is_space(*c.p)) ++c.p;
+}
+
+static void skip_line(cursor_t & c)
+{
+	const void *newline = memchr(c.p, '\n', c.end - c.p);
+	c.p = nullptr == newline ? c.end : static_cast<const char*>(newline) + 1;
+}
+
+static bool at_end_of_line(const cursor_t & c)
+{
+	return c.p >= c.end || *c.p == '\n' || *c.p == '#';
+}
+
+static bool parse_double(cursor_t & c, double & value)
+{
+	if (c.p < c.end && *c.p == '+') ++c.p;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	std::from_chars_result result = std::from_chars(c.p, c.end, value);
+	if (result.ec != std::errc()) return false;
+	c.p = result.ptr;
+	return true;
+#else // __cpp_lib_to_chars
+	// strtod needs a null terminated string, and the mapped file is not
+	char buffer[64];
+	size_t length = 0;
+	while (c.p + length < c.end && length + 1 < sizeof(buffer) && !is_space(c.p[length]) && c.p[length] != '/') {
+		buffer[length] = c.p[length];
+		++length;
+	}
+	buffer[length] = '\0';
+	char *parsed_end;
+	value = strtod(buffer, &parsed_end);
+	if (parsed_end == buffer) return false;
+	c.p += parsed_end - buffer;
+	return true;
+#endif // __cpp_lib_to_chars
+}
+
+static bool parse_float(cursor_t & c, float & value)
+{
+	double d;
+	if (!parse_double(c, d)) return false;
+	value = static_cast<float>(d);
+	return true;
+}
+
+static bool parse_integer(cursor_t & c, long long & value)
+{
+	bool negative = false;
+	if (c.p < c.end && (*c.p == '-' || *c.p == '+')) {
+		negative = *c.p == '-';
+		++c.p;
+	}
+	if (c.p >= c.end || *c.p < '0' || *c.p > '9') return false;
+	long long v = 0;
+	while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+		if (v > LLONG_MAX / 10) return false;
+		v = 10 * v + (*c.p - '0');
+		++c.p;
+	}
+	value = negative ? -v : v;
+	return true;
+}
+
+static void check_corners(const mesh_data_t & mesh)
+{
+	int point_count = mesh.pointCount();
+	for (int point : mesh.corners) {
+		if (point < 0 || point >= point_count) {
+			throw std::runtime_error("Face refers to point " + std::to_string(point) + " but there are only " + std::to_string(point_count));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OBJ
+
+void readObj(const char *data, size_t size, mesh_data_t & mesh)
+{
+	// Count elements first so that buffers are allocated once
+	size_t point_count = 0, face_count = 0;
+	cursor_t c = { data, data + size };
+	while (c.p < c.end) {
+		skip_blanks(c);
+		if (c.end - c.p >= 2 && (c.p[1] == ' ' || c.p[1] == '\t')) {
+			point_count += c.p[0] == 'v';
+			face_count += c.p[0] == 'f';
+		}
+		skip_line(c);
+	}
+	mesh.positions.clear();
+	mesh.corners.clear();
+	mesh.face_sizes.clear();
+	mesh.positions.reserve(3 * point_count);
+	mesh.face_sizes.reserve(face_count);
+	mesh.corners.reserve(4 * face_count);
+
+	int line = 1;
+	auto fail = [&line](const char *message) {
+		throw std::runtime_error("Line " + std::to_string(line) + ": " + message);
+	};
+
+	c = { data, data + size };
+	while (c.p < c.end) {
+		skip_blanks(c);
+		bool is_command = c.end - c.p >= 2 && (c.p[1] == ' ' || c.p[1] == '\t');
+		if (is_command && c.p[0] == 'v') {
+			++c.p;
+			for (int k = 0; k < 3; ++k) {
+				float value;
+				skip_blanks(c);
+				if (!parse_float(c, value)) fail("invalid point coordinates");
+				mesh.positions.push_back(value);
+			}
+		} else if (is_command && c.p[0] == 'f') {
+			++c.p;
+			int face_size = 0;
+			long long current_point_count = mesh.positions.size() / 3;
+			for (;;) {
+				skip_blanks(c);
+				if (at_end_of_line(c)) break;
+				long long index;
+				if (!parse_integer(c, index) || index == 0) fail("invalid face index");
+				// Indices start at 1, negative ones are relative to the last point
+				index = index < 0 ? current_point_count + index : index - 1;
+				if (index < 0 || index > INT_MAX) fail("face index out of range");
+				mesh.corners.push_back(static_cast<int>(index));
+				++face_size;
+				// Skip texture coordinate and normal indices
+				while (c.p < c.end && !is_space(*c.p)) ++c.p;
+			}
+			if (face_size == 0) fail("empty face");
+			mesh.face_sizes.push_back(face_size);
+		}
+		skip_line(c);
+		++line;
+	}
+
+	check_corners(mesh);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PLY
+
+enum class PlyType {
+	Int8,
+	UInt8,
+	Int16,
+	UInt16,
+	Int32,
+	UInt32,
+	Float32,
+	Float64,
+};
+
+enum class PlyFormat {
+	Ascii,
+	BinaryLittleEndian,
+	BinaryBigEndian,
+};
+
+struct ply_property_t {
+	std::string name;
+	PlyType type;
+	bool is_list;
+	PlyType count_type;
+};
+
+struct ply_element_t {
+	std::string name;
+	size_t count;
+	std::vector<ply_property_t> properties;
+};
+
+static bool parse_ply_type(const std::string & name, PlyType & type)
+{
+	if (name == "char" || name == "int8") type = PlyType::Int8;
+	else if (name == "uchar" || name == "uint8") type = PlyType::UInt8;
+	else if (name == "short" || name == "int16") type = PlyType::Int16;
+	else if (name == "ushort" || name == "uint16") type = PlyType::UInt16;
+	else if (name == "int" || name == "int32") type = PlyType::Int32;
+	else if (name == "uint" || name == "uint32") type = PlyType::UInt32;
+	else if (name == "float" || name == "float32") type = PlyType::Float32;
+	else if (name == "double" || name == "float64") type = PlyType::Float64;
+	else return false;
+	return true;
+}
+
+static size_t ply_type_size(PlyType type)
+{
+	switch (type) {
+	case PlyType::Int8:
+	case PlyType::UInt8:
+		return 1;
+	case PlyType::Int16:
+	case PlyType::UInt16:
+		return 2;
+	case PlyType::Int32:
+	case PlyType::UInt32:
+	case PlyType::Float32:
+		return 4;
+	case PlyType::Float64:
+		return 8;
+	}
+	return 0;
+}
+
+static bool is_little_endian()
+{
+	const uint16_t one = 1;
+	unsigned char first;
+	memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+/**
+ * Sequential reader of the binary body of a PLY file
+ */
+class PlyBinaryReader {
+public:
+	PlyBinaryReader(const char *begin, const char *end, bool swap)
+		: m_p(begin), m_end(end), m_swap(swap)
+	{}
+
+	double read(PlyType type) {
+		size_t size = ply_type_size(type);
+		if (static_cast<size_t>(m_end - m_p) < size) {
+			throw std::runtime_error("Unexpected end of PLY data");
+		}
+		unsigned char bytes[8];
+		memcpy(bytes, m_p, size);
+		m_p += size;
+		if (m_swap) std::reverse(bytes, bytes + size);
+
+		switch (type) {
+		case PlyType::Int8: { int8_t v; memcpy(&v, bytes, 1); return v; }
+		case PlyType::UInt8: { uint8_t v; memcpy(&v, bytes, 1); return v; }
+		case PlyType::Int16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+		case PlyType::UInt16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+		case PlyType::Int32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::UInt32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::Float32: { float v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::Float64: { double v; memcpy(&v, bytes, 8); return v; }
+		}
+		return 0;
+	}
+
+	const char *position() const { return m_p; }
+	size_t remaining() const { return static_cast<size_t>(m_end - m_p); }
+	void advance(size_t size) { m_p += size; }
+	bool swap() const { return m_swap; }
+
+private:
+	const char *m_p;
+	const char *m_end;
+	bool m_swap;
+};
+
+static size_t find_property(const ply_element_t & element, const char *name)
+{
+	for (size_t i = 0; i < element.properties.size(); ++i) {
+		if (element.properties[i].name == name) return i;
+	}
+	return element.properties.size();
+}
+
+/**
+ * Byte size of one item of an element, or 0 if it has list properties
+ */
+static size_t fixed_item_size(const ply_element_t & element)
+{
+	size_t size = 0;
+	for (const ply_property_t & prop : element.properties) {
+		if (prop.is_list) return 0;
+		size += ply_type_size(prop.type);
+	}
+	return size;
+}
+
+static size_t checked_list_size(double count)
+{
+	if (count < 0 || count > INT_MAX) throw std::runtime_error("Invalid PLY list size");
+	return static_cast<size_t>(count);
+}
+
+static void read_ply_binary_element(PlyBinaryReader & reader, const ply_element_t & element, mesh_data_t & mesh)
+{
+	bool is_vertex = element.name == "vertex";
+	bool is_face = element.name == "face";
+	size_t x = find_property(element, "x"), y = find_property(element, "y"), z = find_property(element, "z");
+	size_t indices = find_property(element, "vertex_indices");
+	if (indices == element.properties.size()) indices = find_property(element, "vertex_index");
+	size_t item_size = fixed_item_size(element);
+
+	if (is_vertex) {
+		if (x == element.properties.size() || y == element.properties.size() || z == element.properties.size()) {
+			throw std::runtime_error("PLY vertices have no x, y and z properties");
+		}
+		mesh.positions.resize(3 * element.count);
+	}
+	if (is_face) {
+		if (indices == element.properties.size() || !element.properties[indices].is_list) {
+			throw std::runtime_error("PLY faces have no vertex_indices list");
+		}
+		mesh.face_sizes.resize(element.count);
+		mesh.corners.reserve(3 * element.count);
+	}
+
+	if (!is_vertex && !is_face && item_size > 0) {
+		if (reader.remaining() / item_size < element.count) throw std::runtime_error("Unexpected end of PLY data");
+		reader.advance(item_size * element.count);
+		return;
+	}
+
+	// Most common layout: float x, y, z first, in the byte order of the machine
+	if (is_vertex && item_size > 0 && !reader.swap() && x == 0 && y == 1 && z == 2 &&
+		element.properties[0].type == PlyType::Float32 &&
+		element.properties[1].type == PlyType::Float32 &&
+		element.properties[2].type == PlyType::Float32) {
+		if (reader.remaining() / item_size < element.count) throw std::runtime_error("Unexpected end of PLY data");
+		const char *src = reader.position();
+		for (size_t i = 0; i < element.count; ++i) {
+			memcpy(&mesh.positions[3 * i], src + item_size * i, 3 * sizeof(float));
+		}
+		reader.advance(item_size * element.count);
+		return;
+	}
+
+	// Most common face layout: a single list of uchar count and int indices
+	if (is_face && !reader.swap() && element.properties.size() == 1 &&
+		element.properties[0].count_type == PlyType::UInt8 &&
+		(element.properties[0].type == PlyType::Int32 || element.properties[0].type == PlyType::UInt32)) {
+		// Sizes first, so that corners are allocated once
+		const char *p = reader.position();
+		size_t remaining = reader.remaining();
+		size_t offset = 0, corner_count = 0;
+		for (size_t i = 0; i < element.count; ++i) {
+			if (offset >= remaining) throw std::runtime_error("Unexpected end of PLY data");
+			size_t count = static_cast<unsigned char>(p[offset]);
+			mesh.face_sizes[i] = static_cast<int>(count);
+			corner_count += count;
+			offset += 1 + 4 * count;
+		}
+		if (offset > remaining) throw std::runtime_error("Unexpected end of PLY data");
+
+		mesh.corners.resize(corner_count);
+		int *corners = mesh.corners.data();
+		offset = 0;
+		for (size_t i = 0; i < element.count; ++i) {
+			size_t count = static_cast<size_t>(mesh.face_sizes[i]);
+			memcpy(corners, p + offset + 1, 4 * count);
+			corners += count;
+			offset += 1 + 4 * count;
+		}
+		reader.advance(offset);
+		return;
+	}
+
+	for (size_t i = 0; i < element.count; ++i) {
+		for (size_t k = 0; k < element.properties.size(); ++k) {
+			const ply_property_t & prop = element.properties[k];
+			if (prop.is_list) {
+				size_t count = checked_list_size(reader.read(prop.count_type));
+				if (is_face && k == indices) {
+					mesh.face_sizes[i] = static_cast<int>(count);
+					for (size_t j = 0; j < count; ++j) {
+						mesh.corners.push_back(static_cast<int>(reader.read(prop.type)));
+					}
+				} else {
+					for (size_t j = 0; j < count; ++j) reader.read(prop.type);
+				}
+			} else {
+				double value = reader.read(prop.type);
+				if (is_vertex && (k == x || k == y || k == z)) {
+					mesh.positions[3 * i + (k == x ? 0 : k == y ? 1 : 2)] = static_cast<float>(value);
+				}
+			}
+		}
+	}
+}
+
+static void read_ply_ascii_element(cursor_t & c, const ply_element_t & element, mesh_data_t & mesh)
+{
+	bool is_vertex = element.name == "vertex";
+	bool is_face = element.name == "face";
+	size_t x = find_property(element, "x"), y = find_property(element, "y"), z = find_property(element, "z");
+	size_t indices = find_property(element, "vertex_indices");
+	if (indices == element.properties.size()) indices = find_property(element, "vertex_index");
+
+	if (is_vertex) {
+		if (x == element.properties.size() || y == element.properties.size() || z == element.properties.size()) {
+			throw std::runtime_error("PLY vertices have no x, y and z properties");
+		}
+		mesh.positions.resize(3 * element.count);
+	}
+	if (is_face) {
+		if (indices == element.properties.size() || !element.properties[indices].is_list) {
+			throw std::runtime_error("PLY faces have no vertex_indices list");
+		}
+		mesh.face_sizes.resize(element.count);
+		mesh.corners.reserve(3 * element.count);
+	}
+
+	auto next = [&c]() {
+		double value;
+		skip_whitespace(c);
+		if (!parse_double(c, value)) throw std::runtime_error("Invalid number in PLY data");
+		return value;
+	};
+
+	for (size_t i = 0; i < element.count; ++i) {
+		for (size_t k = 0; k < element.properties.size(); ++k) {
+			const ply_property_t & prop = element.properties[k];
+			if (prop.is_list) {
+				size_t count = checked_list_size(next());
+				if (is_face && k == indices) {
+					mesh.face_sizes[i] = static_cast<int>(count);
+					for (size_t j = 0; j < count; ++j) {
+						mesh.corners.push_back(static_cast<int>(next()));
+					}
+				} else {
+					for (size_t j = 0; j < count; ++j) next();
+				}
+			} else {
+				double value = next();
+				if (is_vertex && (k == x || k == y || k == z)) {
+					mesh.positions[3 * i + (k == x ? 0 : k == y ? 1 : 2)] = static_cast<float>(value);
+				}
+			}
+		}
+	}
+}
+
+void readPly(const char *data, size_t size, mesh_data_t & mesh)
+{
+	mesh.positions.clear();
+	mesh.corners.clear();
+	mesh.face_sizes.clear();
+
+	cursor_t c = { data, data + size };
+	PlyFormat format = PlyFormat::Ascii;
+	std::vector<ply_element_t> elements;
+	bool is_ply = false;
+	bool has_format = false;
+
+	// Header, one keyword per line
+	for (;;) {
+		if (c.p >= c.end) throw std::runtime_error("PLY header has no end_header");
+		const char *line_begin = c.p;
+		skip_line(c);
+		std::vector<std::string> words;
+		const char *p = line_begin;
+		while (p < c.p) {
+			while (p < c.p && is_space(*p)) ++p;
+			const char *word_begin = p;
+			while (p < c.p && !is_space(*p)) ++p;
+			if (p > word_begin) words.emplace_back(word_begin, p);
+		}
+		if (words.empty()) continue;
+
+		if (!is_ply) {
+			if (words[0] != "ply") throw std::runtime_error("Not a PLY file");
+			is_ply = true;
+		} else if (words[0] == "format" && words.size() >= 2) {
+			if (words[1] == "ascii") format = PlyFormat::Ascii;
+			else if (words[1] == "binary_little_endian") format = PlyFormat::BinaryLittleEndian;
+			else if (words[1] == "binary_big_endian") format = PlyFormat::BinaryBigEndian;
+			else throw std::runtime_error("Unknown PLY format " + words[1]);
+			has_format = true;
+		} else if (words[0] == "element" && words.size() >= 3) {
+			elements.push_back(ply_element_t{ words[1], static_cast<size_t>(strtoull(words[2].c_str(), nullptr, 10)), {} });
+		} else if (words[0] == "property" && !elements.empty()) {
+			ply_property_t prop = {};
+			bool valid;
+			if (words.size() >= 5 && words[1] == "list") {
+				prop.is_list = true;
+				valid = parse_ply_type(words[2], prop.count_type) && parse_ply_type(words[3], prop.type);
+				prop.name = words[4];
+			} else if (words.size() >= 3) {
+				valid = parse_ply_type(words[1], prop.type);
+				prop.name = words[2];
+			} else {
+				valid = false;
+			}
+			if (!valid) throw std::runtime_error("Invalid PLY property declaration");
+			elements.back().properties.push_back(prop);
+		} else if (words[0] == "end_header") {
+			break;
+		}
+		// comment, obj_info and unknown keywords are ignored
+	}
+	if (!has_format) throw std::runtime_error("PLY header has no format");
+
+	for (const ply_element_t & element : elements) {
+		if (element.count > static_cast<size_t>(INT_MAX)) throw std::runtime_error("Too many elements in PLY file");
+	}
+
+	if (format == PlyFormat::Ascii) {
+		for (const ply_element_t & element : elements) {
+			read_ply_ascii_element(c, element, mesh);
+		}
+	} else {
+		bool swap = (format == PlyFormat::BinaryLittleEndian) != is_little_endian();
+		PlyBinaryReader reader(c.p, c.end, swap);
+		for (const ply_element_t & element : elements) {
+			read_ply_binary_element(reader, element, mesh);
+		}
+	}
+
+	check_corners(mesh);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Files
+
+std::string fileExtension(const std::string & path)
+{
+	size_t dot = path.find_last_of('.');
+	size_t separator = path.find_last_of("/\\");
+	if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) return "";
+	std::string extension = path.substr(dot);
+	for (char & ch : extension) ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+	return extension;
+}
+
+void readMeshFile(const std::string & path, mesh_data_t & mesh)
+{
+	std::string extension = fileExtension(path);
+	MappedFile file(path);
+	try {
+		if (extension == ".obj") {
+			readObj(file.data(), file.size(), mesh);
+		} else if (extension == ".ply") {
+			readPly(file.data(), file.size(), mesh);
+		} else {
+			throw std::runtime_error("Unsupported file extension '" + extension + "'");
+		}
+	}
+	catch (const std::runtime_error & e) {
+		throw std::runtime_error(path + ": " + e.what());
+	}
+}
+
+/**
+ * Output file with a large write buffer, that text writers fill in place
+ */
+class BufferedFile {
+public:
+	explicit BufferedFile(const std::string & path)
+		: m_path(path)
+		, m_file(fopen(path.c_str(), "wb"))
+		, m_size(0)
+	{
+		if (nullptr == m_file) throw std::runtime_error("Could not open '" + path + "' for writing");
+		m_buffer.resize(kBufferSize);
+	}
+
+	~BufferedFile() {
+		if (nullptr != m_file) fclose(m_file);
+	}
+
+	/**
+	 * Get room for at least size bytes at the end of the buffer
+	 */
+	char *reserve(size_t size) {
+		if (m_size + size > m_buffer.size()) {
+			flush();
+			if (size > m_buffer.size()) m_buffer.resize(size);
+		}
+		return m_buffer.data() + m_size;
+	}
+
+	void commit(size_t size) { m_size += size; }
+
+	void write(const void *data, size_t size) {
+		memcpy(reserve(size), data, size);
+		commit(size);
+	}
+
+	void write(const std::string & text) { write(text.data(), text.size()); }
+
+	void close() {
+		flush();
+		int error = fclose(m_file);
+		m_file = nullptr;
+		if (error != 0) throw std::runtime_error("Could not write '" + m_path + "'");
+	}
+
+private:
+	void flush() {
+		if (m_size > 0 && fwrite(m_buffer.data(), 1, m_size, m_file) != m_size) {
+			throw std::runtime_error("Could not write '" + m_path + "'");
+		}
+		m_size = 0;
+	}
+
+private:
+	static constexpr size_t kBufferSize = 1 << 20;
+	std::string m_path;
+	FILE *m_file;
+	std::vector<char> m_buffer;
+	size_t m_size;
+};
+
+static char *format_float(char *out, char *end, float value)
+{
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	return std::to_chars(out, end, value).ptr;
+#else // __cpp_lib_to_chars
+	int length = snprintf(out, end - out, "%.9g", value);
+	return out + std::max(0, std::min(length, static_cast<int>(end - out) - 1));
+#endif // __cpp_lib_to_chars
+}
+
+void writeObj(const std::string & path, const mesh_view_t & mesh)
+{
+	BufferedFile file(path);
+
+	for (int i = 0; i < mesh.point_count; ++i) {
+		const float *p = reinterpret_cast<const float*>(mesh.position_data + static_cast<size_t>(mesh.position_stride) * i);
+		char *begin = file.reserve(128);
+		char *end = begin + 128;
+		char *out = begin;
+		*out++ = 'v';
+		for (int k = 0; k < 3; ++k) {
+			*out++ = ' ';
+			out = format_float(out, end, p[k]);
+		}
+		*out++ = '\n';
+		file.commit(out - begin);
+	}
+
+	int corner = 0;
+	for (int f = 0; f < mesh.face_count; ++f) {
+		int face_size = mesh.faceSize(f);
+		size_t room = 2 + 12 * static_cast<size_t>(face_size);
+		char *begin = file.reserve(room);
+		char *end = begin + room;
+		char *out = begin;
+		*out++ = 'f';
+		for (int j = 0; j < face_size; ++j, ++corner) {
+			int point = *reinterpret_cast<const int*>(mesh.corner_data + static_cast<size_t>(mesh.corner_stride) * corner);
+			*out++ = ' ';
+			out = std::to_chars(out, end, point + 1).ptr;
+		}
+		*out++ = '\n';
+		file.commit(out - begin);
+	}
+
+	file.close();
+}
+
+void writePly(const std::string & path, const mesh_view_t & mesh)
+{
+	int max_face_size = 0;
+	for (int f = 0; f < mesh.face_count; ++f) {
+		max_face_size = std::max(max_face_size, mesh.faceSize(f));
+	}
+	bool byte_sizes = max_face_size <= 255;
+
+	BufferedFile file(path);
+	file.write(
+		std::string("ply\n") +
+		"format " + (is_little_endian() ? "binary_little_endian" : "binary_big_endian") + " 1.0\n" +
+		"element vertex " + std::to_string(mesh.point_count) + "\n" +
+		"property float x\n" +
+		"property float y\n" +
+		"property float z\n" +
+		"element face " + std::to_string(mesh.face_count) + "\n" +
+		"property list " + (byte_sizes ? "uchar" : "int") + " int vertex_indices\n" +
+		"end_header\n"
+	);
+
+	for (int i = 0; i < mesh.point_count; ++i) {
+		file.write(mesh.position_data + static_cast<size_t>(mesh.position_stride) * i, 3 * sizeof(float));
+	}
+
+	int corner = 0;
+	for (int f = 0; f < mesh.face_count; ++f) {
+		int face_size = mesh.faceSize(f);
+		char *out = file.reserve(sizeof(int) * (1 + static_cast<size_t>(face_size)));
+		char *begin = out;
+		if (byte_sizes) {
+			*out++ = static_cast<char>(static_cast<unsigned char>(face_size));
+		} else {
+			memcpy(out, &face_size, sizeof(int));
+			out += sizeof(int);
+		}
+		for (int j = 0; j < face_size; ++j, ++corner) {
+			memcpy(out, mesh.corner_data + static_cast<size_t>(mesh.corner_stride) * corner, sizeof(int));
+			out += sizeof(int);
+		}
+		file.commit(out - begin);
+	}
+
+	file.close();
+}
+
+void writeMeshFile(const std::string & path, const mesh_view_t & mesh)
+{
+	std::string extension = fileExtension(path);
+	if (extension == ".obj") {
+		writeObj(path, mesh);
+	} else if (extension == ".ply") {
+		writePly(path, mesh);
+	} else {
+		throw std::runtime_error("Unsupported file extension '" + extension + "'");
+	}
+}
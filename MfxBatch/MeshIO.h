@@ -0,0 +1,99 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Mesh loaded from a file, in the layout expected by OpenMfx
+ */
+struct mesh_data_t {
+	std::vector<float> positions; // xyz, 3 floats per point
+	std::vector<int> corners; // point index of each corner
+	std::vector<int> face_sizes;
+
+	int pointCount() const { return static_cast<int>(positions.size() / 3); }
+	int cornerCount() const { return static_cast<int>(corners.size()); }
+	int faceCount() const { return static_cast<int>(face_sizes.size()); }
+};
+
+/**
+ * Mesh to write, typically pointing to the output buffers of an effect.
+ * face_size_data may be null when all faces have constant_face_size corners.
+ */
+struct mesh_view_t {
+	int point_count;
+	int corner_count;
+	int face_count;
+	const char *position_data;
+	int position_stride;
+	const char *corner_data;
+	int corner_stride;
+	const char *face_size_data;
+	int face_size_stride;
+	int constant_face_size;
+
+	int faceSize(int face) const {
+		return nullptr == face_size_data
+			? constant_face_size
+			: *reinterpret_cast<const int*>(face_size_data + static_cast<size_t>(face_size_stride) * face);
+	}
+};
+
+/**
+ * Parse Wavefront OBJ content. Only points and faces are read, texture
+ * coordinates and normals are ignored. Errors are reported as
+ * std::runtime_error.
+ */
+void readObj(const char *data, size_t size, mesh_data_t & mesh);
+
+/**
+ * Parse PLY content, in ascii or binary encoding
+ */
+void readPly(const char *data, size_t size, mesh_data_t & mesh);
+
+/**
+ * Map a .obj or .ply file in memory and parse it
+ */
+void readMeshFile(const std::string & path, mesh_data_t & mesh);
+
+void writeObj(const std::string & path, const mesh_view_t & mesh);
+
+/**
+ * Write a binary PLY file, in the byte order of the machine
+ */
+void writePly(const std::string & path, const mesh_view_t & mesh);
+
+/**
+ * Write a .obj or .ply file depending on the extension of path
+ */
+void writeMeshFile(const std::string & path, const mesh_view_t & mesh);
+
+/**
+ * Lower case extension of path, including the dot, or an empty string
+ */
+std::string fileExtension(const std::string & path);
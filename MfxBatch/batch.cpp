@@ -0,0 +1,476 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+/**
+ * Apply a chain of OpenMfx effects to many mesh files, without any DCC.
+ *
+ * Usage: MfxBatch --plugin FILE.ofx [--effect NAME] [--param NAME=VALUE[,VALUE...]]...
+ *                 [--plugin ...] [--output-dir DIR] [--suffix TEXT] [--format obj|ply]
+ *                 [--jobs N] [--max-memory MB] [--log FILE] [--list FILE] [FILES...]
+ *
+ * Each --plugin starts a new stage of the chain, and the following --effect
+ * and --param options apply to it. Files are read from the command line and
+ * from --list, one path per line. Results are written to --output-dir, or
+ * next to the input with --suffix appended to the name (default "_mfx").
+ *
+ * Files are processed by --jobs workers, each with its own instance of every
+ * effect. A worker waits before loading a file until its estimated memory
+ * fits within --max-memory, so that a few huge files do not run at the same
+ * time. One line per file is appended to --log (CSV) as soon as it is done.
+ */
+
+#include "MeshIO.h"
+
+#include <MfxHost/LocalHost.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+// Memory needed to process a file, relative to the file size. Text files
+// are larger than the meshes they describe, and the output mesh of each
+// stage is about the size of the input.
+static constexpr double kMemoryPerFileByte = 4.0;
+
+struct stage_t {
+	std::string plugin_path;
+	std::string effect;
+	std::vector<std::pair<std::string, std::string>> params;
+	std::unique_ptr<PluginLibrary> library;
+	int plugin_index;
+};
+
+struct options_t {
+	std::vector<stage_t> stages;
+	std::vector<std::string> files;
+	std::string output_dir;
+	std::string suffix = "_mfx";
+	std::string format;
+	std::string log_path;
+	int jobs = 0;
+	double max_memory_mb = 4096;
+};
+
+struct file_result_t {
+	bool ok;
+	std::string error;
+	int input_point_count;
+	int input_face_count;
+	int output_point_count;
+	int output_face_count;
+	double read_ms;
+	double cook_ms;
+	double write_ms;
+};
+
+/**
+ * Counting semaphore over an amount of memory. Requests larger than the
+ * whole budget are clamped to it, so that they run alone instead of never.
+ */
+class MemoryBudget {
+public:
+	explicit MemoryBudget(size_t capacity)
+		: m_capacity(std::max<size_t>(1, capacity))
+		, m_used(0)
+	{}
+
+	size_t acquire(size_t amount) {
+		amount = std::min(amount, m_capacity);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_available.wait(lock, [&] { return m_used + amount <= m_capacity; });
+		m_used += amount;
+		return amount;
+	}
+
+	void release(size_t amount) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_used -= amount;
+		}
+		m_available.notify_all();
+	}
+
+private:
+	size_t m_capacity;
+	size_t m_used;
+	std::mutex m_mutex;
+	std::condition_variable m_available;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t file_size(const std::string & path)
+{
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 ? static_cast<size_t>(info.st_size) : 0;
+}
+
+static std::string output_path(const options_t & options, const std::string & input)
+{
+	size_t separator = input.find_last_of("/\\");
+	std::string directory = separator == std::string::npos ? "" : input.substr(0, separator + 1);
+	std::string name = separator == std::string::npos ? input : input.substr(separator + 1);
+	std::string extension = fileExtension(name);
+	std::string stem = name.substr(0, name.size() - extension.size());
+	if (!options.format.empty()) extension = "." + options.format;
+
+	if (options.output_dir.empty()) {
+		return directory + stem + options.suffix + extension;
+	}
+	std::string output_dir = options.output_dir;
+	if (output_dir.back() != '/' && output_dir.back() != '\\') output_dir += '/';
+	return output_dir + stem + extension;
+}
+
+/**
+ * Parse "1.5,2,3" into numbers, returns false if it is not a list of numbers
+ */
+static bool parse_numbers(const std::string & text, std::vector<double> & values)
+{
+	values.clear();
+	size_t begin = 0;
+	while (begin <= text.size()) {
+		size_t end = text.find(',', begin);
+		if (end == std::string::npos) end = text.size();
+		std::string item = text.substr(begin, end - begin);
+		char *parsed_end;
+		double value = strtod(item.c_str(), &parsed_end);
+		if (item.empty() || *parsed_end != '\0') return false;
+		values.push_back(value);
+		begin = end + 1;
+	}
+	return !values.empty();
+}
+
+static void apply_params(EffectInstance & effect, const stage_t & stage)
+{
+	for (const auto & param : stage.params) {
+		std::vector<double> values;
+		bool ok = parse_numbers(param.second, values)
+			? effect.setParam(param.first.c_str(), values)
+			: effect.setStringParam(param.first.c_str(), param.second);
+		if (!ok) {
+			throw std::runtime_error("Effect " + stage.effect + " has no parameter " + param.first + " accepting '" + param.second + "'");
+		}
+	}
+}
+
+/**
+ * Point the main input of effect to the main output of previous, without
+ * copy. All attributes are passed along.
+ */
+static void bind_stage(EffectInstance & effect, const OfxMeshStruct & previous)
+{
+	effect.inputMesh().shareFrom(previous);
+}
+
+static void bind_file(EffectInstance & effect, mesh_data_t & mesh)
+{
+	OfxMeshStruct & input = effect.inputMesh();
+	input.reset();
+	input.setCounts(
+		mesh.pointCount(), mesh.cornerCount(), mesh.faceCount(), true,
+		findConstantFaceSize(mesh.face_sizes.data(), mesh.faceCount()));
+	input.setAttributeData(
+		input.findAttribute(kOfxMeshAttribPoint, kOfxMeshAttribPointPosition),
+		mesh.positions.data(), 3 * sizeof(float));
+	input.setAttributeData(
+		input.findAttribute(kOfxMeshAttribCorner, kOfxMeshAttribCornerPoint),
+		mesh.corners.data(), sizeof(int));
+	input.setAttributeData(
+		input.findAttribute(kOfxMeshAttribFace, kOfxMeshAttribFaceSize),
+		mesh.face_sizes.data(), sizeof(int));
+}
+
+static mesh_view_t view_of(const OfxMeshStruct & mesh)
+{
+	auto data = [&mesh](const char *attachment, const char *name) {
+		host_attribute_t *attribute = mesh.findAttribute(attachment, name);
+		return nullptr == attribute ? nullptr : static_cast<const char*>(attribute->pointer(kOfxMeshAttribPropData));
+	};
+	auto stride = [&mesh](const char *attachment, const char *name) {
+		host_attribute_t *attribute = mesh.findAttribute(attachment, name);
+		return nullptr == attribute ? 0 : attribute->integer(kOfxMeshAttribPropStride);
+	};
+
+	mesh_view_t view;
+	view.point_count = mesh.pointCount();
+	view.corner_count = mesh.cornerCount();
+	view.face_count = mesh.faceCount();
+	view.position_data = data(kOfxMeshAttribPoint, kOfxMeshAttribPointPosition);
+	view.position_stride = stride(kOfxMeshAttribPoint, kOfxMeshAttribPointPosition);
+	view.corner_data = data(kOfxMeshAttribCorner, kOfxMeshAttribCornerPoint);
+	view.corner_stride = stride(kOfxMeshAttribCorner, kOfxMeshAttribCornerPoint);
+	view.face_size_data = data(kOfxMeshAttribFace, kOfxMeshAttribFaceSize);
+	view.face_size_stride = stride(kOfxMeshAttribFace, kOfxMeshAttribFaceSize);
+	view.constant_face_size = mesh.properties.integer(kOfxMeshPropConstantFaceSize, 0, -1);
+	if (view.constant_face_size > 0) {
+		view.face_size_data = nullptr;
+	}
+	if (nullptr == view.position_data || nullptr == view.corner_data || (nullptr == view.face_size_data && view.constant_face_size <= 0)) {
+		throw std::runtime_error("Output mesh is missing its positions or topology");
+	}
+	return view;
+}
+
+static file_result_t process_file(const options_t & options, std::vector<std::unique_ptr<EffectInstance>> & effects, const std::string & path)
+{
+	file_result_t result = {};
+	try {
+		auto start = std::chrono::steady_clock::now();
+		mesh_data_t mesh;
+		readMeshFile(path, mesh);
+		result.read_ms = milliseconds_since(start);
+		result.input_point_count = mesh.pointCount();
+		result.input_face_count = mesh.faceCount();
+
+		start = std::chrono::steady_clock::now();
+		for (size_t s = 0; s < effects.size(); ++s) {
+			if (s == 0) {
+				bind_file(*effects[s], mesh);
+			} else {
+				bind_stage(*effects[s], effects[s - 1]->outputMesh());
+			}
+			OfxStatus status = effects[s]->cook();
+			if (status != kOfxStatOK) {
+				throw std::runtime_error("Effect " + options.stages[s].effect + " failed with status " + std::to_string(status));
+			}
+		}
+		result.cook_ms = milliseconds_since(start);
+
+		start = std::chrono::steady_clock::now();
+		mesh_view_t output = view_of(effects.back()->outputMesh());
+		result.output_point_count = output.point_count;
+		result.output_face_count = output.face_count;
+		writeMeshFile(output_path(options, path), output);
+		result.write_ms = milliseconds_since(start);
+		result.ok = true;
+	}
+	catch (const std::exception & e) {
+		result.ok = false;
+		result.error = e.what();
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static std::string csv_escape(const std::string & text)
+{
+	if (text.find_first_of(",\"\n") == std::string::npos) return text;
+	std::string escaped = "\"";
+	for (char c : text) {
+		if (c == '"') escaped += '"';
+		escaped += c == '\n' ? ' ' : c;
+	}
+	return escaped + "\"";
+}
+
+static void usage(const char *program)
+{
+	fprintf(stderr,
+		"Usage: %s --plugin FILE.ofx [--effect NAME] [--param NAME=VALUE[,VALUE...]]...\n"
+		"          [--plugin ...] [--output-dir DIR] [--suffix TEXT] [--format obj|ply]\n"
+		"          [--jobs N] [--max-memory MB] [--log FILE] [--list FILE] [FILES...]\n",
+		program);
+}
+
+static bool parse_options(int argc, char **argv, options_t & options)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg.size() < 2 || arg.compare(0, 2, "--") != 0) {
+			options.files.push_back(arg);
+			continue;
+		}
+		if (i + 1 >= argc) return false;
+		std::string value = argv[++i];
+		if (arg == "--plugin") {
+			options.stages.emplace_back();
+			options.stages.back().plugin_path = value;
+		} else if (arg == "--effect" && !options.stages.empty()) {
+			options.stages.back().effect = value;
+		} else if (arg == "--param" && !options.stages.empty()) {
+			size_t equal = value.find('=');
+			if (equal == std::string::npos) return false;
+			options.stages.back().params.emplace_back(value.substr(0, equal), value.substr(equal + 1));
+		} else if (arg == "--output-dir") {
+			options.output_dir = value;
+		} else if (arg == "--suffix") {
+			options.suffix = value;
+		} else if (arg == "--format") {
+			if (value != "obj" && value != "ply") return false;
+			options.format = value;
+		} else if (arg == "--jobs") {
+			options.jobs = atoi(value.c_str());
+		} else if (arg == "--max-memory") {
+			options.max_memory_mb = atof(value.c_str());
+		} else if (arg == "--log") {
+			options.log_path = value;
+		} else if (arg == "--list") {
+			std::ifstream list(value);
+			if (!list) {
+				fprintf(stderr, "Could not open file list %s\n", value.c_str());
+				return false;
+			}
+			std::string line;
+			while (std::getline(list, line)) {
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				if (!line.empty()) options.files.push_back(line);
+			}
+		} else {
+			return false;
+		}
+	}
+	return !options.stages.empty();
+}
+
+int main(int argc, char **argv)
+{
+	options_t options;
+	if (!parse_options(argc, argv, options)) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (options.output_dir.empty() && options.suffix.empty()) {
+		fprintf(stderr, "Refusing to overwrite input files, set --output-dir or --suffix\n");
+		return EXIT_FAILURE;
+	}
+
+	int jobs = options.jobs > 0 ? options.jobs : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	jobs = std::max(1, std::min(jobs, static_cast<int>(options.files.size())));
+
+	// Load and describe everything up front, on this thread, and create one
+	// instance of each stage per worker
+	std::vector<std::vector<std::unique_ptr<EffectInstance>>> worker_effects(jobs);
+	try {
+		for (stage_t & stage : options.stages) {
+			stage.library.reset(new PluginLibrary(stage.plugin_path));
+			stage.plugin_index = stage.effect.empty() && stage.library->pluginCount() == 1
+				? 0
+				: stage.library->findPlugin(stage.effect);
+			if (stage.plugin_index < 0) {
+				throw std::runtime_error("No effect '" + stage.effect + "' in " + stage.plugin_path);
+			}
+			if (stage.effect.empty()) {
+				stage.effect = stage.library->plugin(stage.plugin_index)->pluginIdentifier;
+			}
+			stage.library->descriptor(stage.plugin_index);
+		}
+		for (auto & effects : worker_effects) {
+			for (const stage_t & stage : options.stages) {
+				effects.emplace_back(new EffectInstance(*stage.library, stage.plugin_index));
+				apply_params(*effects.back(), stage);
+			}
+		}
+	}
+	catch (const std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	FILE *log = nullptr;
+	if (!options.log_path.empty()) {
+		log = fopen(options.log_path.c_str(), "w");
+		if (nullptr == log) {
+			fprintf(stderr, "Could not open log file %s\n", options.log_path.c_str());
+			return EXIT_FAILURE;
+		}
+		fprintf(log, "file,status,input_points,input_faces,output_points,output_faces,read_ms,cook_ms,write_ms,error\n");
+	}
+
+	MemoryBudget budget(static_cast<size_t>(options.max_memory_mb * 1024 * 1024));
+	std::atomic<size_t> next_file(0);
+	std::mutex log_mutex;
+	int succeeded = 0, failed = 0;
+	double total_points = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	auto worker = [&](int worker_index) {
+		for (;;) {
+			size_t index = next_file.fetch_add(1);
+			if (index >= options.files.size()) break;
+			const std::string & path = options.files[index];
+
+			size_t reserved = budget.acquire(static_cast<size_t>(kMemoryPerFileByte * file_size(path)));
+			file_result_t result = process_file(options, worker_effects[worker_index], path);
+			budget.release(reserved);
+
+			std::lock_guard<std::mutex> lock(log_mutex);
+			if (result.ok) {
+				++succeeded;
+				total_points += result.input_point_count;
+			} else {
+				++failed;
+				fprintf(stderr, "%s\n", result.error.c_str());
+			}
+			if (nullptr != log) {
+				fprintf(log, "%s,%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%s\n",
+					csv_escape(path).c_str(), result.ok ? "ok" : "failed",
+					result.input_point_count, result.input_face_count,
+					result.output_point_count, result.output_face_count,
+					result.read_ms, result.cook_ms, result.write_ms,
+					csv_escape(result.error).c_str());
+				fflush(log);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int w = 1; w < jobs; ++w) {
+		threads.emplace_back(worker, w);
+	}
+	worker(0);
+	for (std::thread & t : threads) {
+		t.join();
+	}
+	double elapsed = milliseconds_since(start) * 1e-3;
+
+	if (nullptr != log) fclose(log);
+	fprintf(stderr, "%d files processed, %d failed, in %.2f s (%.2f files/s, %.2f Mpoints/s)\n",
+		succeeded, failed, elapsed,
+		elapsed > 0 ? succeeded / elapsed : 0.0,
+		elapsed > 0 ? total_points * 1e-6 / elapsed : 0.0);
+
+	// Instances must go before their libraries
+	worker_effects.clear();
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
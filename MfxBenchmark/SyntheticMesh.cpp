@@ -0,0 +1,229 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "SyntheticMesh.h"
+
+#include <MfxCommon/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+
+static constexpr int kGrain = 1 << 14;
+
+/**
+ * Deterministic noise in [-1, 1] from an integer, so that meshes can be
+ * generated in parallel and are the same across runs
+ */
+static float hash_noise(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return static_cast<float>(x) / 2147483648.0f - 1.0f;
+}
+
+/**
+ * Number of points along each side of a square grid of about point_count points
+ */
+static int grid_side(int point_count)
+{
+	return std::max(2, static_cast<int>(std::lround(std::sqrt(static_cast<double>(point_count)))));
+}
+
+/**
+ * Fill the selection with the faces whose first point has x < 0.5
+ */
+static void select_half(synthetic_mesh_t & mesh)
+{
+	int face_count = mesh.faceCount();
+	mesh.selection.resize(face_count);
+	std::vector<int> face_start(face_count + 1);
+	face_start[0] = 0;
+	for (int f = 0; f < face_count; ++f) {
+		face_start[f + 1] = face_start[f] + mesh.face_sizes[f];
+	}
+	parallelFor(0, face_count, kGrain, 0, [&](int b, int e) {
+		for (int f = b; f < e; ++f) {
+			int p = mesh.corners[face_start[f]];
+			mesh.selection[f] = mesh.positions[3 * static_cast<size_t>(p)] < 0.5f ? 1.0f : 0.0f;
+		}
+	});
+}
+
+/**
+ * Grid of side x side points, the z coordinate given by height(i, j)
+ */
+template <typename Height>
+static void make_grid_points(int side, float jitter, const Height & height, synthetic_mesh_t & mesh)
+{
+	mesh.positions.resize(3 * static_cast<size_t>(side) * side);
+	float step = 1.0f / (side - 1);
+	parallelFor(0, side, std::max(1, kGrain / side), 0, [&](int b, int e) {
+		for (int j = b; j < e; ++j) {
+			for (int i = 0; i < side; ++i) {
+				uint32_t p = static_cast<uint32_t>(j) * side + i;
+				float *out = &mesh.positions[3 * static_cast<size_t>(p)];
+				out[0] = (i + jitter * hash_noise(2 * p)) * step;
+				out[1] = (j + jitter * hash_noise(2 * p + 1)) * step;
+				out[2] = height(i * step, j * step, p);
+			}
+		}
+	});
+}
+
+void makeGrid(int point_count, synthetic_mesh_t & mesh)
+{
+	int side = grid_side(point_count);
+	int cells = side - 1;
+	mesh.name = "grid";
+	make_grid_points(side, 0.0f, [](float, float, uint32_t) { return 0.0f; }, mesh);
+
+	mesh.face_sizes.assign(static_cast<size_t>(cells) * cells, 4);
+	mesh.corners.resize(4 * static_cast<size_t>(cells) * cells);
+	parallelFor(0, cells, std::max(1, kGrain / cells), 0, [&](int b, int e) {
+		for (int j = b; j < e; ++j) {
+			for (int i = 0; i < cells; ++i) {
+				int p = j * side + i;
+				int *out = &mesh.corners[4 * (static_cast<size_t>(j) * cells + i)];
+				out[0] = p;
+				out[1] = p + 1;
+				out[2] = p + side + 1;
+				out[3] = p + side;
+			}
+		}
+	});
+	select_half(mesh);
+}
+
+void makeNoisyScan(int point_count, synthetic_mesh_t & mesh)
+{
+	int side = grid_side(point_count);
+	int cells = side - 1;
+	mesh.name = "scan";
+	make_grid_points(side, 0.3f, [](float x, float y, uint32_t p) {
+		return 0.1f * std::sin(6.0f * x) * std::cos(4.0f * y) + 0.002f * hash_noise(p ^ 0x9e3779b9U);
+	}, mesh);
+
+	mesh.face_sizes.assign(2 * static_cast<size_t>(cells) * cells, 3);
+	mesh.corners.resize(6 * static_cast<size_t>(cells) * cells);
+	parallelFor(0, cells, std::max(1, kGrain / cells), 0, [&](int b, int e) {
+		for (int j = b; j < e; ++j) {
+			for (int i = 0; i < cells; ++i) {
+				int p = j * side + i;
+				int *out = &mesh.corners[6 * (static_cast<size_t>(j) * cells + i)];
+				out[0] = p;
+				out[1] = p + 1;
+				out[2] = p + side + 1;
+				out[3] = p;
+				out[4] = p + side + 1;
+				out[5] = p + side;
+			}
+		}
+	});
+	select_half(mesh);
+}
+
+void makeTriangleSoup(int point_count, synthetic_mesh_t & mesh)
+{
+	// Each grid cell gives two triangles, so six points
+	int cells = std::max(1, static_cast<int>(std::lround(std::sqrt(point_count / 6.0))));
+	int side = cells + 1;
+	float step = 1.0f / cells;
+	// Far below the 1e-4 default merge threshold
+	float jitter = 1e-6f;
+	mesh.name = "soup";
+
+	size_t triangle_count = 2 * static_cast<size_t>(cells) * cells;
+	mesh.positions.resize(9 * triangle_count);
+	mesh.corners.resize(3 * triangle_count);
+	mesh.face_sizes.assign(triangle_count, 3);
+	parallelFor(0, cells, std::max(1, kGrain / cells), 0, [&](int b, int e) {
+		for (int j = b; j < e; ++j) {
+			for (int i = 0; i < cells; ++i) {
+				int p = j * side + i;
+				int grid_points[6] = { p, p + 1, p + side + 1, p, p + side + 1, p + side };
+				size_t first = 6 * (static_cast<size_t>(j) * cells + i);
+				for (int k = 0; k < 6; ++k) {
+					int q = grid_points[k];
+					uint32_t seed = static_cast<uint32_t>(3 * (first + k));
+					float *out = &mesh.positions[3 * (first + k)];
+					out[0] = (q % side) * step + jitter * hash_noise(seed);
+					out[1] = (q / side) * step + jitter * hash_noise(seed + 1);
+					out[2] = jitter * hash_noise(seed + 2);
+					mesh.corners[first + k] = static_cast<int>(first + k);
+				}
+			}
+		}
+	});
+	select_half(mesh);
+}
+
+/**
+ * Random permutation of [0, count), the same across runs
+ */
+static std::vector<int> shuffled_indices(int count, unsigned seed)
+{
+	std::vector<int> indices(count);
+	std::iota(indices.begin(), indices.end(), 0);
+	std::mt19937 rng(seed);
+	std::shuffle(indices.begin(), indices.end(), rng);
+	return indices;
+}
+
+void makeShuffledScan(int point_count, synthetic_mesh_t & mesh)
+{
+	synthetic_mesh_t scan;
+	makeNoisyScan(point_count, scan);
+	mesh.name = "shuffled";
+
+	int scan_point_count = scan.pointCount();
+	std::vector<int> new_index = shuffled_indices(scan_point_count, 1);
+	mesh.positions.resize(scan.positions.size());
+	parallelFor(0, scan_point_count, kGrain, 0, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			std::copy_n(&scan.positions[3 * static_cast<size_t>(i)], 3, &mesh.positions[3 * static_cast<size_t>(new_index[i])]);
+		}
+	});
+
+	// The scan only has triangles
+	int face_count = scan.faceCount();
+	std::vector<int> face_order = shuffled_indices(face_count, 2);
+	mesh.face_sizes.assign(face_count, 3);
+	mesh.corners.resize(scan.corners.size());
+	mesh.selection.resize(face_count);
+	parallelFor(0, face_count, kGrain, 0, [&](int b, int e) {
+		for (int f = b; f < e; ++f) {
+			size_t g = static_cast<size_t>(face_order[f]);
+			for (int k = 0; k < 3; ++k) {
+				mesh.corners[3 * static_cast<size_t>(f) + k] = new_index[scan.corners[3 * g + k]];
+			}
+			mesh.selection[f] = scan.selection[g];
+		}
+	});
+}
@@ -0,0 +1,66 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Mesh generated for benchmarks, in the layout expected by OpenMfx
+ */
+struct synthetic_mesh_t {
+	std::string name;
+	std::vector<float> positions; // xyz, 3 floats per point
+	std::vector<int> corners; // point index of each corner
+	std::vector<int> face_sizes;
+	std::vector<float> selection; // 1 for faces in the half x < 0.5, else 0
+
+	int pointCount() const { return static_cast<int>(positions.size() / 3); }
+	int cornerCount() const { return static_cast<int>(corners.size()); }
+	int faceCount() const { return static_cast<int>(face_sizes.size()); }
+};
+
+/**
+ * Flat regular grid of quads in [0,1]², with about point_count points
+ */
+void makeGrid(int point_count, synthetic_mesh_t & mesh);
+
+/**
+ * Triangulated height field on jittered samples, like a range scan
+ */
+void makeNoisyScan(int point_count, synthetic_mesh_t & mesh);
+
+/**
+ * Unwelded triangles, as exported by CAD tools, each corner having its own
+ * point. Points that should be shared are jittered by much less than the
+ * default RemoveDoubles threshold, so most of them get merged.
+ */
+void makeTriangleSoup(int point_count, synthetic_mesh_t & mesh);
+
+/**
+ * The noisy scan with its points and faces listed in random order, as in
+ * scans merged from several passes, where neighbours get distant indices
+ */
+void makeShuffledScan(int point_count, synthetic_mesh_t & mesh);
@@ -0,0 +1,766 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+/**
+ * Cook the plugins of this repository in a local host on synthetic meshes
+ * and report cook times, throughput and peak memory, as a table and as JSON.
+ *
+ * Usage: MfxBenchmark [--min-points N] [--max-points N] [--repeat N]
+ *                     [--filter TEXT] [--json FILE] [--bundle]
+ *                     [--cancel-after MS]
+ *
+ * Sizes go from 10K to 50M points, within [min-points, max-points] which is
+ * [10K, 1M] by default. --filter keeps the cases whose "plugin/mesh" name
+ * contains TEXT. --json - writes JSON to stdout and the table to stderr.
+ * --bundle cooks the effects of the MfxBundle plugin rather than those of
+ * the separate plugins. --cancel-after cooks each case once more, asking the
+ * host to abort MS milliseconds into the cook, and reports how long the
+ * plugin took to return after the request.
+ *
+ * Before cooking, it reports the time taken to load and describe all the
+ * effects, from the separate plugins and from the bundle.
+ *
+ * For each mesh, the "Order" cases then cook RemoveDoubles with each output
+ * order, and time what comes downstream on its output: an Extrude, and a walk
+ * over the corners reading their point as a renderer does.
+ */
+
+#include "SyntheticMesh.h"
+
+#include <MfxHost/LocalHost.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Memory
+
+/**
+ * Reset the peak resident set size so that the next reading only covers what
+ * happens from now on. Only Linux supports this, elsewhere peaks are process
+ * wide and this returns false.
+ */
+static bool reset_peak_rss()
+{
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	if (nullptr == f) return false;
+	bool ok = fputs("5", f) >= 0;
+	return fclose(f) == 0 && ok;
+#else
+	return false;
+#endif
+}
+
+static double peak_rss_mb()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return -1;
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#elif defined(__linux__)
+	FILE *f = fopen("/proc/self/status", "r");
+	if (nullptr == f) return -1;
+	char line[256];
+	double kb = -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (0 == strncmp(line, "VmHWM:", 6)) {
+			kb = atof(line + 6);
+			break;
+		}
+	}
+	fclose(f);
+	return kb < 0 ? -1 : kb / 1024.0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+	// Bytes on macOS
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+#endif
+}
+
+static double current_rss_mb()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return -1;
+	return counters.WorkingSetSize / (1024.0 * 1024.0);
+#elif defined(__linux__)
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (nullptr == f) return -1;
+	long size = 0, resident = -1;
+	if (fscanf(f, "%ld %ld", &size, &resident) != 2) resident = -1;
+	fclose(f);
+	return resident < 0 ? -1 : resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+#else
+	return -1;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark cases
+
+struct plugin_case_t {
+	const char *name;
+	const char *effect; // name of the effect in the plugin
+	const char *path;
+	void (*setup)(EffectInstance & effect);
+};
+
+struct mesh_case_t {
+	const char *name;
+	void (*make)(int point_count, synthetic_mesh_t & mesh);
+};
+
+struct result_t {
+	std::string plugin;
+	std::string mesh;
+	int point_count;
+	int corner_count;
+	int face_count;
+	int output_point_count;
+	int output_corner_count;
+	int output_face_count;
+	OfxStatus status;
+	std::vector<double> cook_ms;
+	double rss_before_mb;
+	double peak_rss_mb;
+	bool peak_is_local;
+	// Time from the abort request to the end of the cancelled cook, or -1 if
+	// the cook ended first or cancellation was not measured
+	double cancel_ms;
+	OfxStatus cancel_status;
+
+	double minMs() const { return *std::min_element(cook_ms.begin(), cook_ms.end()); }
+	double meanMs() const {
+		double sum = 0;
+		for (double t : cook_ms) sum += t;
+		return sum / cook_ms.size();
+	}
+	double medianMs() const {
+		std::vector<double> sorted = cook_ms;
+		std::sort(sorted.begin(), sorted.end());
+		size_t n = sorted.size();
+		return n % 2 == 1 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+	}
+	double pointsPerSecond() const {
+		double ms = medianMs();
+		return ms > 0 ? point_count / (ms * 1e-3) : 0;
+	}
+};
+
+static void setup_translate(EffectInstance & effect)
+{
+	effect.setParam("translation", { 1.0, 2.0, 3.0 });
+}
+
+static void setup_transform(EffectInstance & effect)
+{
+	effect.setParam("translation", { 1.0, 2.0, 3.0 });
+	effect.setParam("rotation", { 10.0, 20.0, 30.0 });
+	effect.setParam("scale", { 1.0, 2.0, 0.5 });
+}
+
+static void setup_extrude(EffectInstance & effect)
+{
+	effect.setParam("distance", { 0.1 });
+}
+
+static void setup_remove_doubles(EffectInstance & effect)
+{
+	effect.setParam("threshold", { 1e-4 });
+}
+
+static void setup_remove_doubles_tiled(EffectInstance & effect)
+{
+	// Tiles of about 500K points
+	effect.setParam("threshold", { 1e-4 });
+	effect.setParam("search_memory", { 32 });
+}
+
+static const plugin_case_t kPlugins[] = {
+	{ "Translate", "Translate", MFX_TRANSLATE_PLUGIN, setup_translate },
+	{ "Transform", "Translate", MFX_TRANSLATE_PLUGIN, setup_transform },
+	{ "Extrude", "Extrude", MFX_EXTRUDE_PLUGIN, setup_extrude },
+	{ "RemoveDoubles", "RemoveDoubles", MFX_REMOVE_DOUBLES_PLUGIN, setup_remove_doubles },
+	{ "RemoveDoublesTiled", "RemoveDoubles", MFX_REMOVE_DOUBLES_PLUGIN, setup_remove_doubles_tiled },
+};
+
+static const mesh_case_t kMeshes[] = {
+	{ "grid", makeGrid },
+	{ "scan", makeNoisyScan },
+	{ "soup", makeTriangleSoup },
+	{ "shuffled", makeShuffledScan },
+};
+
+static const int kSizes[] = { 10000, 100000, 1000000, 10000000, 50000000 };
+
+#ifdef MFX_BUNDLE_PLUGIN
+static const char *kBundlePath = MFX_BUNDLE_PLUGIN;
+#else
+static const char *kBundlePath = nullptr;
+#endif
+
+/**
+ * Index of the effect called name in library, which is either the bundle or
+ * the plugin that only holds this effect
+ */
+static int find_effect(const PluginLibrary & library, const char *name)
+{
+	int index = library.findPlugin(name);
+	if (index < 0 && library.pluginCount() == 1) index = 0;
+	return index;
+}
+
+static const plugin_case_t *find_plugin_case(const char *name)
+{
+	for (const plugin_case_t & plugin : kPlugins) {
+		if (0 == strcmp(plugin.name, name)) return &plugin;
+	}
+	return nullptr;
+}
+
+/**
+ * Point the main input of effect to the buffers of mesh, without copy
+ */
+static void bind_input(EffectInstance & effect, synthetic_mesh_t & mesh)
+{
+	OfxMeshStruct & input = effect.inputMesh();
+	input.reset();
+	input.setCounts(
+		mesh.pointCount(), mesh.cornerCount(), mesh.faceCount(), true,
+		findConstantFaceSize(mesh.face_sizes.data(), mesh.faceCount()));
+	input.setAttributeData(
+		input.findAttribute(kOfxMeshAttribPoint, kOfxMeshAttribPointPosition),
+		mesh.positions.data(), 3 * sizeof(float));
+	input.setAttributeData(
+		input.findAttribute(kOfxMeshAttribCorner, kOfxMeshAttribCornerPoint),
+		mesh.corners.data(), sizeof(int));
+	input.setAttributeData(
+		input.findAttribute(kOfxMeshAttribFace, kOfxMeshAttribFaceSize),
+		mesh.face_sizes.data(), sizeof(int));
+	host_attribute_t *selection = input.defineAttribute(kOfxMeshAttribFace, "selection", 1, kOfxMeshAttribTypeFloat, nullptr);
+	input.setAttributeData(selection, mesh.selection.data(), sizeof(float));
+}
+
+/**
+ * Cook effect, asking the host to abort after delay_ms, and return the time
+ * from this request to the end of the cook, or -1 if the cook ended before.
+ */
+static double measure_cancel(EffectInstance & effect, double delay_ms, OfxStatus & status)
+{
+	using clock = std::chrono::steady_clock;
+	std::mutex mutex;
+	std::condition_variable cooked;
+	bool done = false;
+	bool requested = false;
+	clock::time_point request_time;
+	clock::time_point deadline = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(delay_ms));
+
+	std::thread timer([&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (cooked.wait_until(lock, deadline, [&]() { return done; })) return;
+		request_time = clock::now();
+		requested = true;
+		effect.handle().abort_requested = true;
+	});
+
+	status = effect.cook();
+	clock::time_point end = clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+	}
+	cooked.notify_one();
+	timer.join();
+	effect.handle().abort_requested = false;
+
+	if (!requested || request_time > end) return -1;
+	return std::chrono::duration<double, std::milli>(end - request_time).count();
+}
+
+static result_t run_case(const plugin_case_t & plugin, PluginLibrary & library, synthetic_mesh_t & mesh, int repeat, double cancel_after_ms)
+{
+	result_t result = {};
+	result.plugin = plugin.name;
+	result.mesh = mesh.name;
+	result.point_count = mesh.pointCount();
+	result.corner_count = mesh.cornerCount();
+	result.face_count = mesh.faceCount();
+
+	EffectInstance effect(library, find_effect(library, plugin.effect));
+	bind_input(effect, mesh);
+	plugin.setup(effect);
+
+	result.rss_before_mb = current_rss_mb();
+	result.peak_is_local = reset_peak_rss();
+	for (int i = 0; i < repeat; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		result.status = effect.cook();
+		auto end = std::chrono::steady_clock::now();
+		result.cook_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		if (result.status != kOfxStatOK) break;
+	}
+	result.peak_rss_mb = peak_rss_mb();
+
+	const OfxMeshStruct & output = effect.outputMesh();
+	result.output_point_count = output.pointCount();
+	result.output_corner_count = output.cornerCount();
+	result.output_face_count = output.faceCount();
+
+	result.cancel_ms = -1;
+	result.cancel_status = kOfxStatOK;
+	if (cancel_after_ms >= 0 && result.status == kOfxStatOK) {
+		result.cancel_ms = measure_cancel(effect, cancel_after_ms, result.cancel_status);
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Output order
+
+struct order_result_t {
+	std::string mesh;
+	int point_count;
+	int output_order; // value of the output_order parameter of RemoveDoubles
+	OfxStatus status;
+	double remove_ms; // cook of RemoveDoubles
+	double extrude_ms; // cook of Extrude on its output
+	double walk_ms; // read of the point of each output corner
+};
+
+static const int kOutputOrders[] = { 0, 1, 2 };
+static const char *kOutputOrderNames[] = { "input", "points", "faces" };
+
+// Written by walk_corners_ms() so that its loop is not optimized out
+static volatile double s_walk_sum = 0;
+
+/**
+ * Read the position of the point of every corner, in order, as a renderer
+ * or the next modifier does, and return the time it took
+ */
+static double walk_corners_ms(const OfxMeshStruct & mesh)
+{
+	const host_attribute_t *positions = mesh.findAttribute(kOfxMeshAttribPoint, kOfxMeshAttribPointPosition);
+	const host_attribute_t *corners = mesh.findAttribute(kOfxMeshAttribCorner, kOfxMeshAttribCornerPoint);
+	const char *position_data = static_cast<const char*>(positions->pointer(kOfxMeshAttribPropData));
+	const char *corner_data = static_cast<const char*>(corners->pointer(kOfxMeshAttribPropData));
+	size_t position_stride = static_cast<size_t>(positions->integer(kOfxMeshAttribPropStride));
+	size_t corner_stride = static_cast<size_t>(corners->integer(kOfxMeshAttribPropStride));
+
+	auto start = std::chrono::steady_clock::now();
+	double sum = 0;
+	for (int c = 0; c < mesh.cornerCount(); ++c) {
+		int p = *reinterpret_cast<const int*>(corner_data + c * corner_stride);
+		const float *xyz = reinterpret_cast<const float*>(position_data + p * position_stride);
+		sum += xyz[0] + xyz[1] + xyz[2];
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	s_walk_sum = sum;
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static order_result_t run_order_case(PluginLibrary & remove_library, PluginLibrary & extrude_library, synthetic_mesh_t & mesh, int output_order, int repeat)
+{
+	order_result_t result = {};
+	result.mesh = mesh.name;
+	result.point_count = mesh.pointCount();
+	result.output_order = output_order;
+	result.remove_ms = result.extrude_ms = result.walk_ms = -1;
+
+	EffectInstance remove(remove_library, find_effect(remove_library, "RemoveDoubles"));
+	bind_input(remove, mesh);
+	setup_remove_doubles(remove);
+	remove.setParam("output_order", { static_cast<double>(output_order) });
+
+	EffectInstance extrude(extrude_library, find_effect(extrude_library, "Extrude"));
+	setup_extrude(extrude);
+
+	for (int i = 0; i < repeat; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		result.status = remove.cook();
+		auto end = std::chrono::steady_clock::now();
+		if (result.status != kOfxStatOK) return result;
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		result.remove_ms = i == 0 ? ms : std::min(result.remove_ms, ms);
+	}
+
+	extrude.inputMesh().shareFrom(remove.outputMesh());
+	for (int i = 0; i < repeat; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		result.status = extrude.cook();
+		auto end = std::chrono::steady_clock::now();
+		if (result.status != kOfxStatOK) return result;
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		result.extrude_ms = i == 0 ? ms : std::min(result.extrude_ms, ms);
+
+		double walk_ms = walk_corners_ms(remove.outputMesh());
+		result.walk_ms = i == 0 ? walk_ms : std::min(result.walk_ms, walk_ms);
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Startup
+
+struct startup_result_t {
+	std::string build;
+	int library_count;
+	int effect_count;
+	std::vector<double> load_ms; // load and describe, one value per repetition
+	double rss_mb; // resident memory added by the loaded libraries
+
+	double firstMs() const { return load_ms.front(); }
+	double minMs() const { return *std::min_element(load_ms.begin(), load_ms.end()); }
+};
+
+/**
+ * Open the libraries at paths, then load and describe each of their effects,
+ * as a host does on startup, and unload them. This is repeated since only the
+ * first run pays for reading the binaries from disk.
+ */
+static startup_result_t measure_startup(const char *build, const std::vector<std::string> & paths, int repeat)
+{
+	startup_result_t result = {};
+	result.build = build;
+	result.library_count = static_cast<int>(paths.size());
+	for (int i = 0; i < repeat; ++i) {
+		double rss_before = current_rss_mb();
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::unique_ptr<PluginLibrary>> libraries;
+		int effect_count = 0;
+		for (const std::string & path : paths) {
+			libraries.emplace_back(new PluginLibrary(path));
+			for (int p = 0; p < libraries.back()->pluginCount(); ++p) {
+				libraries.back()->descriptor(p);
+				++effect_count;
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+		result.load_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		result.effect_count = effect_count;
+		if (i == 0) result.rss_mb = current_rss_mb() - rss_before;
+	}
+	return result;
+}
+
+static void print_startup(FILE *out, const startup_result_t & r)
+{
+	fprintf(out, "startup %-9s %d libraries, %d effects: first %.2f ms, min %.2f ms, +%.1f MB\n",
+		r.build.c_str(), r.library_count, r.effect_count, r.firstMs(), r.minMs(), r.rss_mb);
+	fflush(out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reporting
+
+static void print_header(FILE *out)
+{
+	fprintf(out, "%-18s %-8s %10s %10s %10s %10s %10s %10s\n",
+		"plugin", "mesh", "points", "min ms", "median ms", "Mpts/s", "peak MB", "out pts");
+}
+
+static void print_result(FILE *out, const result_t & r)
+{
+	if (r.status != kOfxStatOK) {
+		fprintf(out, "%-18s %-8s %10d   cook failed with status %d\n", r.plugin.c_str(), r.mesh.c_str(), r.point_count, r.status);
+		return;
+	}
+	fprintf(out, "%-18s %-8s %10d %10.2f %10.2f %10.2f %10.1f %10d\n",
+		r.plugin.c_str(), r.mesh.c_str(), r.point_count,
+		r.minMs(), r.medianMs(), r.pointsPerSecond() * 1e-6, r.peak_rss_mb, r.output_point_count);
+	if (r.cancel_ms >= 0) {
+		fprintf(out, "%-20s cancelled in %.2f ms (status %d)\n", "", r.cancel_ms, r.cancel_status);
+	}
+	fflush(out);
+}
+
+static void print_order_header(FILE *out)
+{
+	fprintf(out, "%-18s %-8s %10s %10s %10s %10s\n",
+		"order", "mesh", "points", "remove ms", "extrude ms", "walk ms");
+}
+
+static void print_order_result(FILE *out, const order_result_t & r)
+{
+	if (r.status != kOfxStatOK) {
+		fprintf(out, "%-18s %-8s %10d   cook failed with status %d\n", kOutputOrderNames[r.output_order], r.mesh.c_str(), r.point_count, r.status);
+		return;
+	}
+	fprintf(out, "%-18s %-8s %10d %10.2f %10.2f %10.2f\n",
+		kOutputOrderNames[r.output_order], r.mesh.c_str(), r.point_count, r.remove_ms, r.extrude_ms, r.walk_ms);
+}
+
+static void write_json(FILE *out, const std::vector<startup_result_t> & startup, const std::vector<result_t> & results, const std::vector<order_result_t> & order_results, int repeat, double cancel_after_ms)
+{
+	fprintf(out, "{\n");
+	fprintf(out, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(out, "  \"repeat\": %d,\n", repeat);
+	if (cancel_after_ms >= 0) {
+		fprintf(out, "  \"cancel_after_ms\": %.4f,\n", cancel_after_ms);
+	}
+	fprintf(out, "  \"startup\": [");
+	for (size_t i = 0; i < startup.size(); ++i) {
+		const startup_result_t & r = startup[i];
+		fprintf(out, "%s\n    {\n", i == 0 ? "" : ",");
+		fprintf(out, "      \"build\": \"%s\",\n", r.build.c_str());
+		fprintf(out, "      \"library_count\": %d,\n", r.library_count);
+		fprintf(out, "      \"effect_count\": %d,\n", r.effect_count);
+		fprintf(out, "      \"load_ms\": [");
+		for (size_t k = 0; k < r.load_ms.size(); ++k) {
+			fprintf(out, "%s%.4f", k == 0 ? "" : ", ", r.load_ms[k]);
+		}
+		fprintf(out, "],\n");
+		fprintf(out, "      \"rss_mb\": %.2f\n", r.rss_mb);
+		fprintf(out, "    }");
+	}
+	fprintf(out, "\n  ],\n");
+	fprintf(out, "  \"results\": [");
+	for (size_t i = 0; i < results.size(); ++i) {
+		const result_t & r = results[i];
+		fprintf(out, "%s\n    {\n", i == 0 ? "" : ",");
+		// Names are identifiers chosen in this file, they need no escaping
+		fprintf(out, "      \"plugin\": \"%s\",\n", r.plugin.c_str());
+		fprintf(out, "      \"mesh\": \"%s\",\n", r.mesh.c_str());
+		fprintf(out, "      \"point_count\": %d,\n", r.point_count);
+		fprintf(out, "      \"corner_count\": %d,\n", r.corner_count);
+		fprintf(out, "      \"face_count\": %d,\n", r.face_count);
+		fprintf(out, "      \"status\": %d,\n", r.status);
+		fprintf(out, "      \"output_point_count\": %d,\n", r.output_point_count);
+		fprintf(out, "      \"output_corner_count\": %d,\n", r.output_corner_count);
+		fprintf(out, "      \"output_face_count\": %d,\n", r.output_face_count);
+		fprintf(out, "      \"cook_ms\": [");
+		for (size_t k = 0; k < r.cook_ms.size(); ++k) {
+			fprintf(out, "%s%.4f", k == 0 ? "" : ", ", r.cook_ms[k]);
+		}
+		fprintf(out, "],\n");
+		fprintf(out, "      \"cook_ms_min\": %.4f,\n", r.minMs());
+		fprintf(out, "      \"cook_ms_median\": %.4f,\n", r.medianMs());
+		fprintf(out, "      \"cook_ms_mean\": %.4f,\n", r.meanMs());
+		fprintf(out, "      \"points_per_second\": %.1f,\n", r.pointsPerSecond());
+		fprintf(out, "      \"rss_before_mb\": %.2f,\n", r.rss_before_mb);
+		fprintf(out, "      \"peak_rss_mb\": %.2f,\n", r.peak_rss_mb);
+		fprintf(out, "      \"peak_rss_is_per_case\": %s,\n", r.peak_is_local ? "true" : "false");
+		if (r.cancel_ms >= 0) {
+			fprintf(out, "      \"cancel_ms\": %.4f,\n", r.cancel_ms);
+			fprintf(out, "      \"cancel_status\": %d\n", r.cancel_status);
+		}
+		else {
+			fprintf(out, "      \"cancel_ms\": null\n");
+		}
+		fprintf(out, "    }");
+	}
+	fprintf(out, "\n  ],\n");
+	fprintf(out, "  \"output_order\": [");
+	for (size_t i = 0; i < order_results.size(); ++i) {
+		const order_result_t & r = order_results[i];
+		fprintf(out, "%s\n    {\n", i == 0 ? "" : ",");
+		fprintf(out, "      \"mesh\": \"%s\",\n", r.mesh.c_str());
+		fprintf(out, "      \"point_count\": %d,\n", r.point_count);
+		fprintf(out, "      \"output_order\": \"%s\",\n", kOutputOrderNames[r.output_order]);
+		fprintf(out, "      \"status\": %d,\n", r.status);
+		fprintf(out, "      \"remove_ms\": %.4f,\n", r.remove_ms);
+		fprintf(out, "      \"extrude_ms\": %.4f,\n", r.extrude_ms);
+		fprintf(out, "      \"walk_ms\": %.4f\n", r.walk_ms);
+		fprintf(out, "    }");
+	}
+	fprintf(out, "\n  ]\n}\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "Usage: %s [--min-points N] [--max-points N] [--repeat N] [--filter TEXT] [--json FILE] [--bundle] [--cancel-after MS]\n", program);
+}
+
+int main(int argc, char **argv)
+{
+	int min_points = 10000;
+	int max_points = 1000000;
+	int repeat = 3;
+	std::string filter;
+	std::string json_path;
+	bool bundle = false;
+	double cancel_after_ms = -1;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--bundle") {
+			bundle = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (arg == "--min-points") min_points = atoi(argv[++i]);
+		else if (arg == "--max-points") max_points = atoi(argv[++i]);
+		else if (arg == "--repeat") repeat = std::max(1, atoi(argv[++i]));
+		else if (arg == "--filter") filter = argv[++i];
+		else if (arg == "--json") json_path = argv[++i];
+		else if (arg == "--cancel-after") cancel_after_ms = std::max(0.0, atof(argv[++i]));
+		else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (bundle && nullptr == kBundlePath) {
+		fprintf(stderr, "MfxBundle was not built (MFX_BUILD_BUNDLE is off)\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE *table = json_path == "-" ? stderr : stdout;
+
+	std::vector<startup_result_t> startup;
+	std::vector<std::shared_ptr<PluginLibrary>> libraries;
+	try {
+		std::vector<std::string> separate_paths;
+		for (const plugin_case_t & plugin : kPlugins) {
+			if (std::find(separate_paths.begin(), separate_paths.end(), plugin.path) == separate_paths.end()) {
+				separate_paths.push_back(plugin.path);
+			}
+		}
+		startup.push_back(measure_startup("separate", separate_paths, repeat));
+		print_startup(table, startup.back());
+		if (nullptr != kBundlePath) {
+			startup.push_back(measure_startup("bundle", { kBundlePath }, repeat));
+			print_startup(table, startup.back());
+		}
+		fprintf(table, "\n");
+
+		if (bundle) {
+			// All cases share the library, as effects of a bundle do in a host
+			std::shared_ptr<PluginLibrary> library(new PluginLibrary(kBundlePath));
+			for (size_t p = 0; p < sizeof(kPlugins) / sizeof(kPlugins[0]); ++p) {
+				libraries.push_back(library);
+			}
+		}
+		else {
+			// Cases of the same plugin share its library
+			for (size_t p = 0; p < sizeof(kPlugins) / sizeof(kPlugins[0]); ++p) {
+				size_t same = 0;
+				while (same < p && 0 != strcmp(kPlugins[same].path, kPlugins[p].path)) ++same;
+				libraries.push_back(same < p ? libraries[same] : std::make_shared<PluginLibrary>(kPlugins[p].path));
+			}
+		}
+	}
+	catch (const std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	std::vector<result_t> results;
+	std::vector<order_result_t> order_results;
+	bool failed = false;
+	print_header(table);
+	for (const mesh_case_t & mesh_case : kMeshes) {
+		for (int size : kSizes) {
+			if (size < min_points || size > max_points) continue;
+
+			bool order = (std::string("Order/") + mesh_case.name).find(filter) != std::string::npos;
+			bool any = order;
+			for (const plugin_case_t & plugin : kPlugins) {
+				any = any || (std::string(plugin.name) + "/" + mesh_case.name).find(filter) != std::string::npos;
+			}
+			if (!any) continue;
+
+			synthetic_mesh_t mesh;
+			mesh_case.make(size, mesh);
+
+			for (size_t p = 0; p < libraries.size(); ++p) {
+				const plugin_case_t & plugin = kPlugins[p];
+				if ((std::string(plugin.name) + "/" + mesh_case.name).find(filter) == std::string::npos) continue;
+				try {
+					results.push_back(run_case(plugin, *libraries[p], mesh, repeat, cancel_after_ms));
+				}
+				catch (const std::exception & e) {
+					fprintf(stderr, "%s on %s: %s\n", plugin.name, mesh_case.name, e.what());
+					failed = true;
+					continue;
+				}
+				print_result(table, results.back());
+				failed = failed || results.back().status != kOfxStatOK;
+			}
+
+			if (order) {
+				PluginLibrary & remove_library = *libraries[find_plugin_case("RemoveDoubles") - kPlugins];
+				PluginLibrary & extrude_library = *libraries[find_plugin_case("Extrude") - kPlugins];
+				try {
+					for (int output_order : kOutputOrders) {
+						order_results.push_back(run_order_case(remove_library, extrude_library, mesh, output_order, repeat));
+						failed = failed || order_results.back().status != kOfxStatOK;
+					}
+				}
+				catch (const std::exception & e) {
+					fprintf(stderr, "Order on %s: %s\n", mesh_case.name, e.what());
+					failed = true;
+				}
+			}
+		}
+	}
+
+	if (!order_results.empty()) {
+		fprintf(table, "\n");
+		print_order_header(table);
+		for (const order_result_t & r : order_results) {
+			print_order_result(table, r);
+		}
+		fflush(table);
+	}
+
+	if (!json_path.empty()) {
+		FILE *out = json_path == "-" ? stdout : fopen(json_path.c_str(), "w");
+		if (nullptr == out) {
+			fprintf(stderr, "Could not open %s\n", json_path.c_str());
+			return EXIT_FAILURE;
+		}
+		write_json(out, startup, results, order_results, repeat, cancel_after_ms);
+		if (out != stdout) fclose(out);
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
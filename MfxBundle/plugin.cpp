@@ -0,0 +1,44 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+/**
+ * All the effects of this repository registered by a single plugin binary.
+ * Hosts then load and describe one library instead of one per effect, and
+ * the effects share a single copy of the SDK and of MfxCommon, whose state
+ * (CPU dispatch, profiling) is only set up when an effect first cooks.
+ */
+
+#include <MfxTranslate/TranslateEffect.h>
+#include <MfxExtrude/ExtrudeEffect.h>
+#include <MfxRemoveDoubles/RemoveDoublesEffect.h>
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxRegister>
+
+///////////////////////////////////////////////////////////////////////////////
+
+MfxRegister(
+	TranslateEffect,
+	ExtrudeEffect,
+	RemoveDoublesEffect
+);
@@ -0,0 +1,47 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxEffect>
+
+/**
+ * Make an output attribute point to the buffer of an input attribute rather
+ * than own a copy of it, for attributes that an effect leaves untouched.
+ * This must be called before allocating the output mesh. Returns false when
+ * the host refuses to forward, in which case the caller must fall back to
+ * copying the attribute once the output is allocated.
+ */
+inline bool forwardAttribute(MfxAttribute & output, const MfxAttribute & input)
+{
+	try {
+		output.ForwardFrom(input);
+	}
+	catch (const MfxSuiteException &) {
+		return false;
+	}
+	MfxAttributeProps props;
+	output.FetchProperties(props);
+	return !props.isOwner;
+}
@@ -0,0 +1,244 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "Parallel.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+/**
+ * Typed view over count elements of N components of type T separated by
+ * stride bytes, which is how mesh attributes are laid out. T is const for
+ * read-only views, and N is 0 when the component count is only known at
+ * runtime. view[i] points to the components of element i.
+ *
+ * Loops over views are written once for both layouts: the primitives below
+ * test once per call whether all their views are packed (stride equal to
+ * the element size) and then run a loop compiled for that case, where the
+ * stride is a constant the compiler can vectorize with.
+ */
+template <typename T, int N = 1>
+class AttributeView {
+public:
+	using value_type = T;
+	using Byte = typename std::conditional<std::is_const<T>::value, const char, char>::type;
+	static constexpr int kComponentCount = N;
+
+	/**
+	 * Iterates over elements, yielding pointers to their components
+	 */
+	class iterator {
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T*;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T**;
+		using reference = T*;
+
+		iterator(Byte *data, int stride) : m_data(data), m_stride(stride) {}
+		T *operator*() const { return reinterpret_cast<T*>(m_data); }
+		T *operator[](difference_type n) const { return *(*this + n); }
+		iterator & operator++() { m_data += m_stride; return *this; }
+		iterator & operator--() { m_data -= m_stride; return *this; }
+		iterator operator++(int) { iterator it = *this; ++*this; return it; }
+		iterator operator--(int) { iterator it = *this; --*this; return it; }
+		iterator & operator+=(difference_type n) { m_data += m_stride * n; return *this; }
+		iterator & operator-=(difference_type n) { m_data -= m_stride * n; return *this; }
+		iterator operator+(difference_type n) const { iterator it = *this; return it += n; }
+		iterator operator-(difference_type n) const { iterator it = *this; return it -= n; }
+		difference_type operator-(const iterator & other) const { return (m_data - other.m_data) / m_stride; }
+		bool operator==(const iterator & other) const { return m_data == other.m_data; }
+		bool operator!=(const iterator & other) const { return m_data != other.m_data; }
+		bool operator<(const iterator & other) const { return m_data < other.m_data; }
+
+	private:
+		Byte *m_data;
+		difference_type m_stride;
+	};
+
+	AttributeView()
+		: m_data(nullptr), m_stride(0), m_count(0), m_component_count(N)
+	{}
+
+	AttributeView(Byte *data, int stride, int count, int component_count = N)
+		: m_data(data), m_stride(stride), m_count(count), m_component_count(N > 0 ? N : component_count)
+	{}
+
+	/**
+	 * View of count packed elements, e.g. held by a std::vector<T>
+	 */
+	static AttributeView packed(T *data, int count, int component_count = N) {
+		int element_size = static_cast<int>(sizeof(T)) * (N > 0 ? N : component_count);
+		return AttributeView(reinterpret_cast<Byte*>(data), element_size, count, component_count);
+	}
+
+	/**
+	 * Read-only view of the same elements
+	 */
+	operator AttributeView<const T, N>() const {
+		return AttributeView<const T, N>(m_data, m_stride, m_count, m_component_count);
+	}
+
+	T *operator[](int i) const {
+		return reinterpret_cast<T*>(m_data + static_cast<size_t>(m_stride) * i);
+	}
+
+	/**
+	 * Element i, computed with the stride of packed elements when packed is
+	 * std::true_type. Used by the primitives after testing isPacked().
+	 */
+	T *element(int i, std::true_type) const {
+		return reinterpret_cast<T*>(m_data) + static_cast<size_t>(componentCount()) * i;
+	}
+
+	T *element(int i, std::false_type) const {
+		return (*this)[i];
+	}
+
+	Byte *data() const { return m_data; }
+	int stride() const { return m_stride; }
+	int size() const { return m_count; }
+	bool empty() const { return m_count == 0; }
+	int componentCount() const { return N > 0 ? N : m_component_count; }
+	int elementSize() const { return static_cast<int>(sizeof(T)) * componentCount(); }
+	bool isPacked() const { return m_stride == elementSize(); }
+
+	iterator begin() const { return iterator(m_data, m_stride); }
+	iterator end() const { return iterator(m_data + static_cast<size_t>(m_stride) * m_count, m_stride); }
+
+	/**
+	 * View of elements [begin, end)
+	 */
+	AttributeView slice(int begin, int end) const {
+		return AttributeView(m_data + static_cast<size_t>(m_stride) * begin, m_stride, end - begin, m_component_count);
+	}
+
+private:
+	Byte *m_data;
+	int m_stride;
+	int m_count;
+	int m_component_count;
+};
+
+/**
+ * View over the data and stride of an attribute, e.g. MfxAttributeProps
+ */
+template <typename T, int N = 1, typename Props>
+AttributeView<T, N> attributeView(const Props & props, int count, int component_count = N)
+{
+	return AttributeView<T, N>(props.data, props.stride, count, component_count);
+}
+
+// Elements are processed in parallel by ranges of at least this many
+static constexpr int kAttributeGrain = 1 << 14;
+
+/**
+ * Call body(begin, end, packed) over ranges of [0, count) in parallel, with
+ * packed being std::true_type if all views are packed and std::false_type
+ * otherwise, so that body is compiled for each layout.
+ */
+template <typename Body, typename SrcView, typename DstView>
+void forEachPackedRange(int count, int thread_count, const SrcView & src, const DstView & dst, const Body & body)
+{
+	if (src.isPacked() && dst.isPacked()) {
+		parallelFor(0, count, kAttributeGrain, thread_count, [&](int b, int e) { body(b, e, std::true_type()); });
+	}
+	else {
+		parallelFor(0, count, kAttributeGrain, thread_count, [&](int b, int e) { body(b, e, std::false_type()); });
+	}
+}
+
+/**
+ * dst[i] = src[i] for all elements of dst
+ */
+template <typename SrcView, typename DstView>
+void copyAttribute(const SrcView & src, const DstView & dst, int thread_count = 0)
+{
+	if (src.isPacked() && dst.isPacked()) {
+		size_t element_size = static_cast<size_t>(dst.elementSize());
+		parallelFor(0, dst.size(), kAttributeGrain, thread_count, [&](int b, int e) {
+			memcpy(dst[b], src[b], element_size * (e - b));
+		});
+		return;
+	}
+	forEachPackedRange(dst.size(), thread_count, src, dst, [&](int b, int e, auto packed) {
+		int n = dst.componentCount();
+		for (int i = b; i < e; ++i) {
+			const auto *s = src.element(i, packed);
+			auto *d = dst.element(i, packed);
+			for (int k = 0; k < n; ++k) {
+				d[k] = s[k];
+			}
+		}
+	});
+}
+
+/**
+ * dst[i] = src[sources[i]] for all elements of dst
+ */
+template <typename SrcView, typename DstView>
+void gatherAttribute(const SrcView & src, const DstView & dst, const int *sources, int thread_count = 0)
+{
+	forEachPackedRange(dst.size(), thread_count, src, dst, [&](int b, int e, auto packed) {
+		int n = dst.componentCount();
+		for (int i = b; i < e; ++i) {
+			const auto *s = src.element(sources[i], packed);
+			auto *d = dst.element(i, packed);
+			for (int k = 0; k < n; ++k) {
+				d[k] = s[k];
+			}
+		}
+	});
+}
+
+/**
+ * Call fn(src[i], dst[i]) for all elements of dst, e.g. to convert or
+ * transform an attribute. fn receives pointers to the components.
+ */
+template <typename SrcView, typename DstView, typename Fn>
+void transformAttribute(const SrcView & src, const DstView & dst, const Fn & fn, int thread_count = 0)
+{
+	forEachPackedRange(dst.size(), thread_count, src, dst, [&](int b, int e, auto packed) {
+		for (int i = b; i < e; ++i) {
+			fn(src.element(i, packed), dst.element(i, packed));
+		}
+	});
+}
+
+/**
+ * Copy count elements of element_size bytes between strided buffers, for
+ * code that moves attributes without looking at their type
+ */
+inline void copyElements(const char *src, int src_stride, char *dst, int dst_stride, int element_size, int count, int thread_count = 0)
+{
+	copyAttribute(
+		AttributeView<const char, 0>(src, src_stride, count, element_size),
+		AttributeView<char, 0>(dst, dst_stride, count, element_size),
+		thread_count
+	);
+}
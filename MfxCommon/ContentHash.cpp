@@ -0,0 +1,117 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "ContentHash.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ull;
+static constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4full;
+static constexpr uint64_t kPrime3 = 0x165667b19e3779f9ull;
+// Elements are hashed by blocks of about this many bytes
+static constexpr int kBlockSize = 1 << 16;
+
+static inline uint64_t rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t value)
+{
+	return rotl(acc + value * kPrime2, 31) * kPrime1;
+}
+
+static inline uint64_t load64(const unsigned char *p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed)
+{
+	const unsigned char *p = static_cast<const unsigned char*>(data);
+	const unsigned char *end = p + size;
+
+	uint64_t lanes[4] = {
+		seed + kPrime1 + kPrime2,
+		seed + kPrime2,
+		seed,
+		seed - kPrime1,
+	};
+	for (; end - p >= 32; p += 32) {
+		for (int k = 0; k < 4; ++k) {
+			lanes[k] = hash_round(lanes[k], load64(p + 8 * k));
+		}
+	}
+
+	uint64_t hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+	hash += static_cast<uint64_t>(size);
+	for (; end - p >= 8; p += 8) {
+		hash = rotl(hash ^ hash_round(0, load64(p)), 27) * kPrime1 + kPrime3;
+	}
+	for (; p < end; ++p) {
+		hash = rotl(hash ^ (*p * kPrime3), 11) * kPrime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t hashStrided(const char *data, int stride, int element_size, int count, uint64_t seed, int thread_count)
+{
+	if (count <= 0 || element_size <= 0) return hashBytes(nullptr, 0, seed);
+
+	int block_elements = std::max(1, kBlockSize / element_size);
+	int block_count = (count + block_elements - 1) / block_elements;
+	std::vector<uint64_t> block_hashes(block_count);
+
+	parallelFor(0, block_count, 4, thread_count, [&](int b, int e) {
+		std::vector<char> packed;
+		for (int block = b; block < e; ++block) {
+			int first = block * block_elements;
+			int n = std::min(block_elements, count - first);
+			const char *src = data + static_cast<size_t>(stride) * first;
+			if (stride == element_size) {
+				block_hashes[block] = hashBytes(src, static_cast<size_t>(n) * element_size);
+				continue;
+			}
+			// Interleaved attribute, pack its elements first
+			packed.resize(static_cast<size_t>(n) * element_size);
+			for (int i = 0; i < n; ++i) {
+				memcpy(packed.data() + static_cast<size_t>(element_size) * i, src + static_cast<size_t>(stride) * i, element_size);
+			}
+			block_hashes[block] = hashBytes(packed.data(), packed.size());
+		}
+	});
+
+	return hashBytes(block_hashes.data(), block_hashes.size() * sizeof(uint64_t), hashCombine(seed, static_cast<uint64_t>(count)));
+}
@@ -0,0 +1,55 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fast non cryptographic 64-bit hash of size bytes, meant to detect whether a
+ * buffer changed between two cooks. Bytes are consumed 32 at a time by four
+ * independent lanes, which compilers turn into vector code.
+ */
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+/**
+ * Hash count elements of element_size bytes separated by stride bytes, e.g.
+ * a mesh attribute. Blocks of elements are hashed in parallel on up to
+ * thread_count threads (0 for all cores) and the result does not depend on
+ * the number of threads.
+ */
+uint64_t hashStrided(const char *data, int stride, int element_size, int count, uint64_t seed = 0, int thread_count = 0);
+
+/**
+ * Mix value into hash, to combine several hashes or scalar parameters
+ */
+inline uint64_t hashCombine(uint64_t hash, uint64_t value)
+{
+	hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
@@ -0,0 +1,104 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "CookProgress.h"
+
+#include <algorithm>
+#include <chrono>
+
+static thread_local CookProgress *t_current_progress = nullptr;
+
+static int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count();
+}
+
+CookProgress::CookProgress()
+	: m_previous(t_current_progress)
+	, m_cancelled(false)
+	, m_done(0)
+	, m_cook_thread(std::this_thread::get_id())
+	, m_next_poll_ns(now_ns() + kPollInterval)
+	, m_stage_begin(0)
+	, m_stage_end(0)
+	, m_stage_work(0)
+{
+	t_current_progress = this;
+}
+
+CookProgress::~CookProgress()
+{
+	t_current_progress = m_previous;
+}
+
+CookProgress *CookProgress::current()
+{
+	return t_current_progress;
+}
+
+CookProgress *CookProgress::makeCurrent(CookProgress *progress)
+{
+	CookProgress *previous = t_current_progress;
+	t_current_progress = progress;
+	return previous;
+}
+
+void CookProgress::beginStage(double end, int64_t work)
+{
+	m_stage_begin = m_stage_end;
+	m_stage_end = std::max(m_stage_begin, std::min(end, 1.0));
+	m_stage_work = work;
+	m_done.store(0, std::memory_order_relaxed);
+}
+
+bool CookProgress::checkpoint(int64_t work)
+{
+	if (work != 0) m_done.fetch_add(work, std::memory_order_relaxed);
+	if (cancelled()) return true;
+
+	// Task threads only see the flag set by the cook thread
+	if (std::this_thread::get_id() != m_cook_thread) return false;
+	int64_t now = now_ns();
+	if (now < m_next_poll_ns) return false;
+	m_next_poll_ns = now + kPollInterval;
+	if (poll(progress())) cancel();
+	return cancelled();
+}
+
+double CookProgress::progress() const
+{
+	double fraction = 1;
+	if (m_stage_work > 0) {
+		fraction = std::min(1.0, static_cast<double>(m_done.load(std::memory_order_relaxed)) / m_stage_work);
+	}
+	return m_stage_begin + (m_stage_end - m_stage_begin) * fraction;
+}
+
+bool CookProgress::poll(double progress)
+{
+	(void)progress;
+	return false;
+}
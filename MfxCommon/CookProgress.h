@@ -0,0 +1,153 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "RuntimeApi.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/**
+ * Progress report and cooperative cancellation of cooks, shared by the
+ * plugins. An effect opens a CookProgress for the duration of a cook and
+ * splits it into stages with cookStage(). Long loops call cookCheckpoint()
+ * every kCheckpointGrain elements or so, from any thread, to report the work
+ * they did and learn whether the cook was cancelled. Once it is, they stop
+ * early, leaving an output that is incomplete but safe to read, and the
+ * effect checks cookCancelled() between phases to give up.
+ *
+ * A checkpoint costs an atomic add, plus a clock read on the thread that
+ * opened the progress. Only that thread asks the host whether to abort, at
+ * most every kPollInterval, as hosts need not support being called from
+ * other threads. The threads running tasks of the cook only read the
+ * cancelled flag, and all of them stop within a few milliseconds of a
+ * cancellation, since the cook thread runs tasks of its own parallel calls.
+ *
+ * This base class only gets cancelled by cancel(), e.g. from a test or a
+ * timer. HostProgress (HostProgress.h) polls an OpenMfx host.
+ */
+#if defined(_MSC_VER)
+// The private members need no export, only the methods
+#  pragma warning(push)
+#  pragma warning(disable: 4251)
+#endif
+class MFX_RUNTIME_API CookProgress {
+public:
+	CookProgress();
+	virtual ~CookProgress();
+	CookProgress(const CookProgress &) = delete;
+	CookProgress & operator=(const CookProgress &) = delete;
+
+	/**
+	 * Progress of the cook running on the calling thread, also set while
+	 * running a task issued by this cook, or nullptr
+	 */
+	static CookProgress *current();
+
+	/**
+	 * Make progress the one of the calling thread and return the previous
+	 * one, used by the task scheduler
+	 */
+	static CookProgress *makeCurrent(CookProgress *progress);
+
+	/**
+	 * Start the next stage of the cook, going from the end of the previous
+	 * one to end, in [0, 1], once work units have been reported. Must not be
+	 * called while loops of the cook are running.
+	 */
+	void beginStage(double end, int64_t work);
+
+	/**
+	 * Report work units done in the current stage and return whether the
+	 * cook was cancelled, polling the host if it is time to and this is the
+	 * thread that opened the progress.
+	 */
+	bool checkpoint(int64_t work);
+
+	/**
+	 * Cancel the cook, from any thread
+	 */
+	void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+	bool cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+	/**
+	 * Fraction of the cook done so far, in [0, 1]
+	 */
+	double progress() const;
+
+public:
+	// Minimum time between two polls of the host, in nanoseconds
+	static constexpr int64_t kPollInterval = 10000000;
+
+protected:
+	/**
+	 * Tell the host the progress of the cook and return true if it asks to
+	 * abort. Only called from the thread that opened the progress.
+	 */
+	virtual bool poll(double progress);
+
+private:
+	CookProgress *m_previous;
+	std::atomic<bool> m_cancelled;
+	std::atomic<int64_t> m_done; // work done in the current stage
+	std::thread::id m_cook_thread;
+	int64_t m_next_poll_ns; // only used by the cook thread
+	double m_stage_begin;
+	double m_stage_end;
+	int64_t m_stage_work;
+};
+#if defined(_MSC_VER)
+#  pragma warning(pop)
+#endif
+
+/**
+ * Elements processed by a loop between two checkpoints, a power of two
+ */
+static constexpr int kCheckpointGrain = 1 << 12;
+
+/**
+ * Start the next stage of the current cook, see CookProgress::beginStage()
+ */
+inline void cookStage(double end, int64_t work)
+{
+	CookProgress *progress = CookProgress::current();
+	if (nullptr != progress) progress->beginStage(end, work);
+}
+
+/**
+ * Report work done in the current cook and return whether it was cancelled
+ */
+inline bool cookCheckpoint(int64_t work)
+{
+	CookProgress *progress = CookProgress::current();
+	return nullptr != progress && progress->checkpoint(work);
+}
+
+inline bool cookCancelled()
+{
+	return cookCheckpoint(0);
+}
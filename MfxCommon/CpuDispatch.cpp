@@ -0,0 +1,131 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "CpuDispatch.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MFX_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef MFX_X86
+
+static void cpuid(int leaf, int subleaf, uint32_t regs[4])
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuidex(info, leaf, subleaf);
+	for (int i = 0; i < 4; ++i) regs[i] = static_cast<uint32_t>(info[i]);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/**
+ * Register state components the OS saves on context switches (XCR0)
+ */
+static uint64_t xgetbv0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+static IsaLevel detect_isa_level()
+{
+	uint32_t regs[4];
+	cpuid(0, 0, regs);
+	if (regs[0] < 7) return IsaLevel::Baseline;
+
+	cpuid(1, 0, regs);
+	bool fma = (regs[2] & (1u << 12)) != 0;
+	bool osxsave = (regs[2] & (1u << 27)) != 0;
+	bool avx = (regs[2] & (1u << 28)) != 0;
+	if (!osxsave || !avx || !fma) return IsaLevel::Baseline;
+
+	// The OS must save the ymm registers, and for AVX-512 the opmask and zmm
+	uint64_t xcr0 = xgetbv0();
+	bool os_avx = (xcr0 & 0x6) == 0x6;
+	bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+	if (!os_avx) return IsaLevel::Baseline;
+
+	cpuid(7, 0, regs);
+	bool avx2 = (regs[1] & (1u << 5)) != 0;
+	bool avx512f = (regs[1] & (1u << 16)) != 0;
+	bool avx512dq = (regs[1] & (1u << 17)) != 0;
+	bool avx512bw = (regs[1] & (1u << 30)) != 0;
+	bool avx512vl = (regs[1] & (1u << 31)) != 0;
+	if (!avx2) return IsaLevel::Baseline;
+	if (os_avx512 && avx512f && avx512dq && avx512bw && avx512vl) return IsaLevel::AVX512;
+	return IsaLevel::AVX2;
+}
+
+#else // MFX_X86
+
+static IsaLevel detect_isa_level()
+{
+	return IsaLevel::Baseline;
+}
+
+#endif // MFX_X86
+
+static IsaLevel detect_capped_isa_level()
+{
+	IsaLevel level = detect_isa_level();
+	const char *cap = getenv("MFX_MAX_ISA");
+	if (nullptr == cap) return level;
+	if (0 == strcmp(cap, "baseline")) return IsaLevel::Baseline;
+	if (0 == strcmp(cap, "avx2") && level > IsaLevel::AVX2) return IsaLevel::AVX2;
+	return level;
+}
+
+IsaLevel cpuIsaLevel()
+{
+	static const IsaLevel level = detect_capped_isa_level();
+	return level;
+}
+
+const char *isaLevelName(IsaLevel level)
+{
+	switch (level) {
+	case IsaLevel::AVX2:
+		return "avx2";
+	case IsaLevel::AVX512:
+		return "avx512";
+	default:
+		return "baseline";
+	}
+}
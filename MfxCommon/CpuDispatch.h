@@ -0,0 +1,120 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+/**
+ * Runtime selection among copies of a kernel compiled for several instruction
+ * set levels. Sources listed as DISPATCH_SRC of add_openmfx_plugin or
+ * add_openmfx_effect (see cmake/utils.cmake) are built once per level with
+ * MFX_ISA set to the level name, and name their kernels with MFX_ISA_NAME():
+ *
+ *   // Kernels.h
+ *   MFX_DECLARE_ISA_VARIANTS(void, scale, (float *data, int count, float s));
+ *
+ *   // Kernels.cpp, compiled once per level
+ *   void MFX_ISA_NAME(scale)(float *data, int count, float s) { ... }
+ *
+ *   // Caller.cpp, compiled once
+ *   MFX_DEFINE_ISA_DISPATCH(scale_kernel, scale)
+ *   ...
+ *   scale_kernel()(data, count, 2.0f);
+ *
+ * Everything else in a dispatched source must have internal linkage, and it
+ * must not instantiate templates or inline functions from headers (including
+ * the standard library) since the linker could then keep the copy built for
+ * a level the CPU does not support.
+ */
+
+enum class IsaLevel {
+	Baseline, // x86-64 (SSE2), or whatever the compiler targets by default
+	AVX2, // AVX2 and FMA
+	AVX512, // AVX-512 F, VL, BW and DQ
+};
+
+/**
+ * Highest level supported by both the CPU and the OS, capped by the
+ * MFX_MAX_ISA environment variable ("baseline", "avx2" or "avx512") if it is
+ * set. Detected on first call.
+ */
+IsaLevel cpuIsaLevel();
+
+const char *isaLevelName(IsaLevel level);
+
+/**
+ * Return the variant for the highest level that is supported and has been
+ * compiled in (i.e. is not null).
+ */
+template <typename Fn>
+Fn selectIsaVariant(Fn baseline, Fn avx2, Fn avx512)
+{
+	IsaLevel level = cpuIsaLevel();
+	if (level >= IsaLevel::AVX512 && nullptr != avx512) return avx512;
+	if (level >= IsaLevel::AVX2 && nullptr != avx2) return avx2;
+	return baseline;
+}
+
+#define MFX_ISA_CONCAT_(name, level) name##_##level
+#define MFX_ISA_CONCAT(name, level) MFX_ISA_CONCAT_(name, level)
+
+/**
+ * Name of the variant of a kernel built for the current level
+ */
+#define MFX_ISA_NAME(name) MFX_ISA_CONCAT(name, MFX_ISA)
+
+#define MFX_DECLARE_ISA_VARIANTS(ret, name, params) \
+	ret name##_baseline params; \
+	ret name##_avx2 params; \
+	ret name##_avx512 params
+
+#ifdef MFX_HAS_ISA_AVX2
+#define MFX_ISA_VARIANT_AVX2(name) name##_avx2
+#else
+#define MFX_ISA_VARIANT_AVX2(name) static_cast<decltype(&name##_baseline)>(nullptr)
+#endif
+
+#ifdef MFX_HAS_ISA_AVX512
+#define MFX_ISA_VARIANT_AVX512(name) name##_avx512
+#else
+#define MFX_ISA_VARIANT_AVX512(name) static_cast<decltype(&name##_baseline)>(nullptr)
+#endif
+
+/**
+ * Pointer to the best variant of a kernel declared with
+ * MFX_DECLARE_ISA_VARIANTS
+ */
+#define MFX_ISA_SELECT(name) \
+	selectIsaVariant(&name##_baseline, MFX_ISA_VARIANT_AVX2(name), MFX_ISA_VARIANT_AVX512(name))
+
+/**
+ * Define a function called getter that returns the best variant of a kernel.
+ * The variant is picked on the first call rather than when the plugin is
+ * loaded, so that loading and describing stays cheap.
+ */
+#define MFX_DEFINE_ISA_DISPATCH(getter, name) \
+	static decltype(&name##_baseline) getter() \
+	{ \
+		static const auto kernel = MFX_ISA_SELECT(name); \
+		return kernel; \
+	}
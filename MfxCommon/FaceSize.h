@@ -0,0 +1,54 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <type_traits>
+
+/**
+ * Meshes whose faces all have the same number of corners, such as triangle
+ * and quad meshes, say so with kOfxMeshPropConstantFaceSize. Their face size
+ * attribute is then neither read nor written, and face f covers corners
+ * [f * size, (f + 1) * size).
+ *
+ * Call fn(face_size) with face_size a std::integral_constant holding 3 or 4
+ * when constant_face_size is one of them, so that the body of fn is compiled
+ * once for triangles and once for quads with a face size known at compile
+ * time, and with 0 otherwise, meaning that the size is read for each face.
+ */
+template <typename Fn>
+void dispatchFaceSize(int constant_face_size, const Fn & fn)
+{
+	switch (constant_face_size) {
+	case 3:
+		fn(std::integral_constant<int, 3>());
+		break;
+	case 4:
+		fn(std::integral_constant<int, 4>());
+		break;
+	default:
+		fn(std::integral_constant<int, 0>());
+		break;
+	}
+}
@@ -0,0 +1,84 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "CookProgress.h"
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxEffect>
+
+#if __has_include(<ofxProgress.h>)
+#include <ofxProgress.h>
+#endif
+
+/**
+ * Progress of a cook polling an OpenMfx host, through the abort function of
+ * the mesh effect suite. If the host also provides the OpenFX progress suite,
+ * the progress is shown there and its cancel button aborts the cook. Both
+ * suites are only called from the thread that cooks, see CookProgress.
+ */
+class HostProgress : public CookProgress {
+public:
+	HostProgress(const MfxHost & host, OfxMeshEffectHandle instance, const char *label)
+		: m_mesh_effect_suite(host.meshEffectSuite)
+		, m_instance(instance)
+	{
+#ifdef kOfxProgressSuite
+		m_progress_suite = static_cast<const OfxProgressSuiteV1*>(host.host->fetchSuite(host.host->host, kOfxProgressSuite, 1));
+		if (nullptr != m_progress_suite) {
+			m_progress_suite->progressStart(m_instance, label);
+		}
+#else
+		(void)label;
+#endif // kOfxProgressSuite
+	}
+
+	~HostProgress() override {
+#ifdef kOfxProgressSuite
+		if (nullptr != m_progress_suite) {
+			m_progress_suite->progressEnd(m_instance);
+		}
+#endif // kOfxProgressSuite
+	}
+
+protected:
+	bool poll(double progress) override {
+		bool abort = nullptr != m_mesh_effect_suite->abort && 0 != m_mesh_effect_suite->abort(m_instance);
+#ifdef kOfxProgressSuite
+		if (nullptr != m_progress_suite) {
+			abort |= m_progress_suite->progressUpdate(m_instance, progress) == kOfxStatReplyNo;
+		}
+#else
+		(void)progress;
+#endif // kOfxProgressSuite
+		return abort;
+	}
+
+private:
+	const OfxMeshEffectSuiteV1 *m_mesh_effect_suite;
+	OfxMeshEffectHandle m_instance;
+#ifdef kOfxProgressSuite
+	const OfxProgressSuiteV1 *m_progress_suite;
+#endif // kOfxProgressSuite
+};
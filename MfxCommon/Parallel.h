@@ -0,0 +1,174 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Number of threads used when a caller passes a thread count <= 0, see
+ * threadCap()
+ */
+inline int defaultThreadCount()
+{
+	return threadCap();
+}
+
+/**
+ * Thread count to use for a call given thread_count, which is capped by
+ * threadCap() so that hosts and effect parameters keep control over it
+ */
+inline int resolveThreadCount(int thread_count)
+{
+	int cap = threadCap();
+	return thread_count <= 0 ? cap : std::min(thread_count, cap);
+}
+
+/**
+ * Number of chunks to split count items into so that each thread gets one
+ * chunk and no chunk is smaller than grain_size (except when count is).
+ */
+inline int chunkCount(int count, int grain_size, int thread_count)
+{
+	int max_chunks = std::max(1, count / std::max(1, grain_size));
+	return std::max(1, std::min(resolveThreadCount(thread_count), max_chunks));
+}
+
+/**
+ * First item of the given chunk when [0, count) is split into chunk_count
+ * contiguous chunks of nearly equal size. The end of a chunk is the begin of
+ * the next one.
+ */
+inline int chunkBegin(int count, int chunk_count, int chunk)
+{
+	return static_cast<int>(static_cast<int64_t>(count) * chunk / chunk_count);
+}
+
+/**
+ * Call body(chunk) for each chunk in [0, chunk_count), as tasks of the shared
+ * scheduler (see TaskScheduler.h). The calling thread takes part, and chunks
+ * must not wait for each other.
+ */
+template <typename Body>
+void parallelForChunks(int chunk_count, const Body & body)
+{
+	if (chunk_count <= 1) {
+		if (chunk_count == 1) body(0);
+		return;
+	}
+	runTasks(chunk_count, [](void *context, int chunk) {
+		(*static_cast<const Body*>(context))(chunk);
+	}, const_cast<Body*>(&body));
+}
+
+/**
+ * Call body(begin, end) on contiguous sub-ranges covering [begin, end).
+ * Ranges smaller than two grains run inline on the calling thread.
+ */
+template <typename Body>
+void parallelFor(int begin, int end, int grain_size, int thread_count, const Body & body)
+{
+	int count = end - begin;
+	if (count <= 0) return;
+	int chunk_count = chunkCount(count, grain_size, thread_count);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		body(begin + chunkBegin(count, chunk_count, chunk), begin + chunkBegin(count, chunk_count, chunk + 1));
+	});
+}
+
+/**
+ * Reduce [begin, end) by calling map(b, e) on contiguous sub-ranges and
+ * folding their results with combine(a, b), starting from identity. Results
+ * are folded in range order, so the result does not depend on the number of
+ * threads as long as combine is associative.
+ */
+template <typename T, typename Map, typename Combine>
+T parallelReduce(int begin, int end, int grain_size, int thread_count, const T & identity, const Map & map, const Combine & combine)
+{
+	int count = end - begin;
+	if (count <= 0) return identity;
+	int chunk_count = chunkCount(count, grain_size, thread_count);
+	std::vector<T> chunk_results(chunk_count, identity);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		chunk_results[chunk] = map(begin + chunkBegin(count, chunk_count, chunk), begin + chunkBegin(count, chunk_count, chunk + 1));
+	});
+	T result = identity;
+	for (const T & r : chunk_results) {
+		result = combine(result, r);
+	}
+	return result;
+}
+
+/**
+ * In place exclusive prefix sum of values[0:count], returns the total. Runs
+ * in two passes over chunks, summing chunks then offsetting them.
+ */
+template <typename T>
+T parallelExclusiveScan(T *values, int count, int thread_count)
+{
+	int chunk_count = chunkCount(count, 1 << 16, thread_count);
+	std::vector<T> chunk_sums(chunk_count + 1, T(0));
+	parallelForChunks(chunk_count, [&](int chunk) {
+		T sum = T(0);
+		int end = chunkBegin(count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(count, chunk_count, chunk); i < end; ++i) {
+			sum += values[i];
+		}
+		chunk_sums[chunk + 1] = sum;
+	});
+	for (int c = 0; c < chunk_count; ++c) {
+		chunk_sums[c + 1] += chunk_sums[c];
+	}
+	parallelForChunks(chunk_count, [&](int chunk) {
+		T sum = chunk_sums[chunk];
+		int end = chunkBegin(count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(count, chunk_count, chunk); i < end; ++i) {
+			T v = values[i];
+			values[i] = sum;
+			sum += v;
+		}
+	});
+	return chunk_sums[chunk_count];
+}
+
+/**
+ * Run a and b, concurrently if parallel is true.
+ */
+template <typename A, typename B>
+void parallelInvoke(bool parallel, const A & a, const B & b)
+{
+	if (!parallel) {
+		a();
+		b();
+		return;
+	}
+	parallelForChunks(2, [&](int task) {
+		if (task == 0) a();
+		else b();
+	});
+}
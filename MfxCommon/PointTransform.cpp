@@ -0,0 +1,239 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "PointTransform.h"
+#include "PointTransformKernels.h"
+#include "AttributeView.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+using PointView = AttributeView<float, 3>;
+using ConstPointView = AttributeView<const float, 3>;
+
+static constexpr int kGrain = 1 << 16;
+
+static void translate_strided(const ConstPointView & src, const PointView & dst, const float t[3])
+{
+	for (int i = 0; i < dst.size(); ++i) {
+		const float *p = src[i];
+		float *q = dst[i];
+		float x = p[0] + t[0], y = p[1] + t[1], z = p[2] + t[2];
+		q[0] = x;
+		q[1] = y;
+		q[2] = z;
+	}
+}
+
+MFX_DEFINE_ISA_DISPATCH(translate_packed, translatePackedPoints)
+
+void translatePoints(
+	const char *src, int src_stride,
+	char *dst, int dst_stride,
+	int count, const double translation[3],
+	int thread_count)
+{
+	const float t[3] = {
+		static_cast<float>(translation[0]),
+		static_cast<float>(translation[1]),
+		static_cast<float>(translation[2])
+	};
+	ConstPointView input(src, src_stride, count);
+	PointView output(dst, dst_stride, count);
+	bool packed = input.isPacked() && output.isPacked();
+	auto translate_packed_kernel = translate_packed();
+
+	parallelFor(0, count, kGrain, thread_count, [&](int b, int e) {
+		if (packed) {
+			translate_packed_kernel(input[b], output[b], e - b, t);
+		}
+		else {
+			translate_strided(input.slice(b, e), output.slice(b, e), t);
+		}
+	});
+}
+
+affine_transform_t trsTransform(const double translation[3], const double rotation[3], const double scale[3])
+{
+	const double degrees = 3.14159265358979323846 / 180.0;
+	double cx = std::cos(rotation[0] * degrees), sx = std::sin(rotation[0] * degrees);
+	double cy = std::cos(rotation[1] * degrees), sy = std::sin(rotation[1] * degrees);
+	double cz = std::cos(rotation[2] * degrees), sz = std::sin(rotation[2] * degrees);
+
+	// Rz * Ry * Rx
+	const double r[9] = {
+		cy * cz, sx * sy * cz - cx * sz, cx * sy * cz + sx * sz,
+		cy * sz, sx * sy * sz + cx * cz, cx * sy * sz - sx * cz,
+		-sy, sx * cy, cx * cy
+	};
+
+	affine_transform_t transform;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			transform.linear[3 * i + j] = r[3 * i + j] * scale[j];
+		}
+		transform.translation[i] = translation[i];
+	}
+	return transform;
+}
+
+bool isTranslation(const affine_transform_t & transform)
+{
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (transform.linear[3 * i + j] != (i == j ? 1.0 : 0.0)) return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * The transform as three rows of four floats, the last column being the
+ * translation
+ */
+static void affine_matrix(const affine_transform_t & transform, float m[12])
+{
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			m[4 * i + j] = static_cast<float>(transform.linear[3 * i + j]);
+		}
+		m[4 * i + 3] = static_cast<float>(transform.translation[i]);
+	}
+}
+
+/**
+ * Inverse transpose of the linear part of transform, up to a positive factor
+ * since normals are normalized anyway. This is the cofactor matrix, negated
+ * when the transform flips orientation, which unlike the inverse also exists
+ * for flattening transforms. It is scaled to a largest coefficient of 1 so
+ * that tiny scales do not underflow.
+ */
+static void normal_matrix(const affine_transform_t & transform, float n[9])
+{
+	const double *a = transform.linear;
+	double c[9] = {
+		a[4] * a[8] - a[5] * a[7], a[5] * a[6] - a[3] * a[8], a[3] * a[7] - a[4] * a[6],
+		a[2] * a[7] - a[1] * a[8], a[0] * a[8] - a[2] * a[6], a[1] * a[6] - a[0] * a[7],
+		a[1] * a[5] - a[2] * a[4], a[2] * a[3] - a[0] * a[5], a[0] * a[4] - a[1] * a[3]
+	};
+	double det = a[0] * c[0] + a[1] * c[1] + a[2] * c[2];
+	double max_coefficient = 0.0;
+	for (int k = 0; k < 9; ++k) {
+		max_coefficient = std::max(max_coefficient, std::abs(c[k]));
+	}
+	double factor = max_coefficient > 0.0 ? 1.0 / max_coefficient : 1.0;
+	if (det < 0.0) factor = -factor;
+	for (int k = 0; k < 9; ++k) {
+		n[k] = static_cast<float>(c[k] * factor);
+	}
+}
+
+MFX_DEFINE_ISA_DISPATCH(transform_packed, transformPackedPoints)
+
+// Strided buffers are staged through packed blocks of this many points, so
+// that they go through the same kernel
+static constexpr int kStagingPoints = 1024;
+
+using WeightView = AttributeView<const float>;
+
+static void transform_strided(
+	const ConstPointView & src, const PointView & dst, const WeightView & weights,
+	const ConstPointView & normal_src, const PointView & normal_dst,
+	const float m[12], const float n[9])
+{
+	auto kernel = transform_packed();
+	float points[3 * kStagingPoints], normals[3 * kStagingPoints], packed_weights[kStagingPoints];
+	bool has_points = !src.empty();
+	bool has_weights = !weights.empty();
+	bool has_normals = !normal_src.empty();
+	int count = std::max(src.size(), normal_src.size());
+
+	for (int b = 0; b < count; b += kStagingPoints) {
+		int e = std::min(count, b + kStagingPoints);
+		PointView point_block = PointView::packed(points, e - b);
+		PointView normal_block = PointView::packed(normals, e - b);
+		if (has_points) copyAttribute(src.slice(b, e), point_block, 1);
+		if (has_weights) copyAttribute(weights.slice(b, e), AttributeView<float>::packed(packed_weights, e - b), 1);
+		if (has_normals) copyAttribute(normal_src.slice(b, e), normal_block, 1);
+		kernel(
+			has_points ? points : nullptr, points,
+			has_weights ? packed_weights : nullptr,
+			has_normals ? normals : nullptr, normals,
+			e - b, m, n);
+		if (has_points) copyAttribute(point_block, dst.slice(b, e), 1);
+		if (has_normals) copyAttribute(normal_block, normal_dst.slice(b, e), 1);
+	}
+}
+
+void transformPoints(const point_transform_buffers_t & buffers, int count, const affine_transform_t & transform, int thread_count)
+{
+	bool has_points = nullptr != buffers.src;
+	bool has_weights = nullptr != buffers.weights;
+	bool has_normals = nullptr != buffers.normal_src;
+
+	// Moving points without turning them is a translation, which has a
+	// cheaper kernel
+	if (isTranslation(transform) && !has_weights) {
+		if (has_points) {
+			translatePoints(buffers.src, buffers.src_stride, buffers.dst, buffers.dst_stride, count, transform.translation, thread_count);
+		}
+		if (has_normals && buffers.normal_src != buffers.normal_dst) {
+			copyElements(buffers.normal_src, buffers.normal_src_stride, buffers.normal_dst, buffers.normal_dst_stride, 3 * sizeof(float), count, thread_count);
+		}
+		return;
+	}
+
+	float m[12], n[9];
+	affine_matrix(transform, m);
+	normal_matrix(transform, n);
+
+	ConstPointView input = has_points ? ConstPointView(buffers.src, buffers.src_stride, count) : ConstPointView();
+	PointView output = has_points ? PointView(buffers.dst, buffers.dst_stride, count) : PointView();
+	WeightView weights = has_weights ? WeightView(buffers.weights, buffers.weight_stride, count) : WeightView();
+	ConstPointView normal_input = has_normals ? ConstPointView(buffers.normal_src, buffers.normal_src_stride, count) : ConstPointView();
+	PointView normal_output = has_normals ? PointView(buffers.normal_dst, buffers.normal_dst_stride, count) : PointView();
+	bool packed =
+		(!has_points || (input.isPacked() && output.isPacked()))
+		&& (!has_weights || weights.isPacked())
+		&& (!has_normals || (normal_input.isPacked() && normal_output.isPacked()));
+	auto transform_packed_kernel = transform_packed();
+
+	parallelFor(0, count, kGrain, thread_count, [&](int b, int e) {
+		if (packed) {
+			transform_packed_kernel(
+				has_points ? input[b] : nullptr, has_points ? output[b] : nullptr,
+				has_weights ? weights[b] : nullptr,
+				has_normals ? normal_input[b] : nullptr, has_normals ? normal_output[b] : nullptr,
+				e - b, m, n);
+		}
+		else {
+			transform_strided(
+				has_points ? input.slice(b, e) : ConstPointView(), has_points ? output.slice(b, e) : PointView(),
+				has_weights ? weights.slice(b, e) : WeightView(),
+				has_normals ? normal_input.slice(b, e) : ConstPointView(), has_normals ? normal_output.slice(b, e) : PointView(),
+				m, n);
+		}
+	});
+}
@@ -0,0 +1,96 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+/**
+ * Write src[i] + translation to dst[i] for count points made of three
+ * floats, src and dst being separated by their respective strides in bytes.
+ * src and dst may be the same buffer. Packed buffers (12 byte stride) take a
+ * vectorized path, built for several instruction sets and picked at runtime
+ * (see CpuDispatch.h), and large counts are split across up to thread_count
+ * threads (0 for all cores).
+ */
+void translatePoints(
+	const char *src, int src_stride,
+	char *dst, int dst_stride,
+	int count, const double translation[3],
+	int thread_count = 0);
+
+/**
+ * Affine transform of 3D points, p' = linear * p + translation, the linear
+ * part being stored row major
+ */
+struct affine_transform_t {
+	double linear[9];
+	double translation[3];
+};
+
+/**
+ * Transform that scales, then rotates by Euler angles in degrees, around X
+ * then Y then Z, then translates
+ */
+affine_transform_t trsTransform(const double translation[3], const double rotation[3], const double scale[3]);
+
+/**
+ * Whether the linear part of transform is exactly the identity, in which case
+ * translatePoints() does the same job
+ */
+bool isTranslation(const affine_transform_t & transform);
+
+/**
+ * Buffers that transformPoints() reads and writes, each one made of count
+ * elements separated by a stride in bytes. Buffers left null are skipped, e.g.
+ * src and dst to only transform normals.
+ */
+struct point_transform_buffers_t {
+	const char *src = nullptr;
+	int src_stride = 0;
+	char *dst = nullptr;
+	int dst_stride = 0;
+
+	// One float per point, 0 to leave the point where it is, 1 to move it all
+	// the way
+	const char *weights = nullptr;
+	int weight_stride = 0;
+
+	// Point normals, three floats each, transformed in the same pass
+	const char *normal_src = nullptr;
+	int normal_src_stride = 0;
+	char *normal_dst = nullptr;
+	int normal_dst_stride = 0;
+};
+
+/**
+ * Apply transform to count points, and to their normals if buffers has some.
+ * Normals are multiplied by the inverse transpose of the linear part, so that
+ * they stay orthogonal to the surface under non uniform scaling, and are
+ * normalized, unless transform is a mere translation, which copies them
+ * as they are. Weights blend each point and its normal between their input and
+ * transformed values. Sources and destinations may be the same buffers.
+ * Packed buffers take a vectorized path that handles points and normals in a
+ * single pass, and large counts are split across up to thread_count threads
+ * (0 for all cores).
+ */
+void transformPoints(const point_transform_buffers_t & buffers, int count, const affine_transform_t & transform, int thread_count = 0);
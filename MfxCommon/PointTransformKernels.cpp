@@ -0,0 +1,193 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "PointTransformKernels.h"
+
+#include <math.h>
+
+// Points are processed by blocks of 16, so that a block is a whole number of
+// vectors at every level and the translation repeats as a fixed pattern.
+// Plain loops over a block are vectorized by the compiler for the level this
+// file is built for. Blocks go through a local copy, which tells the compiler
+// that writing dst cannot change src even when they are the same buffer.
+
+static constexpr int kBlockPoints = 16;
+static constexpr int kBlockFloats = 3 * kBlockPoints;
+
+void MFX_ISA_NAME(translatePackedPoints)(const float *src, float *dst, int count, const float t[3])
+{
+	float pattern[kBlockFloats];
+	for (int j = 0; j < kBlockFloats; ++j) {
+		pattern[j] = t[j % 3];
+	}
+
+	int block_end = count - count % kBlockPoints;
+	float block[kBlockFloats];
+	for (int i = 0; i < block_end; i += kBlockPoints) {
+		const float *p = src + 3 * static_cast<long long>(i);
+		float *q = dst + 3 * static_cast<long long>(i);
+		for (int j = 0; j < kBlockFloats; ++j) {
+			block[j] = p[j];
+		}
+		for (int j = 0; j < kBlockFloats; ++j) {
+			q[j] = block[j] + pattern[j];
+		}
+	}
+
+	for (int i = block_end; i < count; ++i) {
+		const float *p = src + 3 * static_cast<long long>(i);
+		float *q = dst + 3 * static_cast<long long>(i);
+		float x = p[0] + t[0], y = p[1] + t[1], z = p[2] + t[2];
+		q[0] = x;
+		q[1] = y;
+		q[2] = z;
+	}
+}
+
+/**
+ * Split a block of packed points into one array per coordinate
+ */
+static void load_block(const float *p, float x[], float y[], float z[])
+{
+	for (int j = 0; j < kBlockPoints; ++j) {
+		x[j] = p[3 * j];
+		y[j] = p[3 * j + 1];
+		z[j] = p[3 * j + 2];
+	}
+}
+
+static void store_block(const float x[], const float y[], const float z[], float *q)
+{
+	for (int j = 0; j < kBlockPoints; ++j) {
+		q[3 * j] = x[j];
+		q[3 * j + 1] = y[j];
+		q[3 * j + 2] = z[j];
+	}
+}
+
+/**
+ * Scale vectors to unit length. A tiny bias rather than a test for zero, which
+ * would keep the loop from being vectorized, leaves null vectors null.
+ */
+static void normalize_block(float x[], float y[], float z[])
+{
+	for (int j = 0; j < kBlockPoints; ++j) {
+		float length2 = x[j] * x[j] + y[j] * y[j] + z[j] * z[j];
+		float s = 1.0f / sqrtf(length2 + 1e-30f);
+		x[j] *= s;
+		y[j] *= s;
+		z[j] *= s;
+	}
+}
+
+/**
+ * Move x, y, z weights[j] of the way to tx, ty, tz, writing to the latter
+ */
+static void blend_block(const float x[], const float y[], const float z[], const float weights[], float tx[], float ty[], float tz[])
+{
+	for (int j = 0; j < kBlockPoints; ++j) {
+		tx[j] = x[j] + weights[j] * (tx[j] - x[j]);
+		ty[j] = y[j] + weights[j] * (ty[j] - y[j]);
+		tz[j] = z[j] + weights[j] * (tz[j] - z[j]);
+	}
+}
+
+static void transform_block(const float *src, float *dst, const float *weights, const float *normal_src, float *normal_dst, const float m[12], const float n[9])
+{
+	float x[kBlockPoints], y[kBlockPoints], z[kBlockPoints];
+	float tx[kBlockPoints], ty[kBlockPoints], tz[kBlockPoints];
+
+	if (nullptr != src) {
+		load_block(src, x, y, z);
+		for (int j = 0; j < kBlockPoints; ++j) {
+			tx[j] = m[0] * x[j] + m[1] * y[j] + m[2] * z[j] + m[3];
+			ty[j] = m[4] * x[j] + m[5] * y[j] + m[6] * z[j] + m[7];
+			tz[j] = m[8] * x[j] + m[9] * y[j] + m[10] * z[j] + m[11];
+		}
+		if (nullptr != weights) {
+			blend_block(x, y, z, weights, tx, ty, tz);
+		}
+		store_block(tx, ty, tz, dst);
+	}
+
+	if (nullptr != normal_src) {
+		load_block(normal_src, x, y, z);
+		for (int j = 0; j < kBlockPoints; ++j) {
+			tx[j] = n[0] * x[j] + n[1] * y[j] + n[2] * z[j];
+			ty[j] = n[3] * x[j] + n[4] * y[j] + n[5] * z[j];
+			tz[j] = n[6] * x[j] + n[7] * y[j] + n[8] * z[j];
+		}
+		normalize_block(tx, ty, tz);
+		if (nullptr != weights) {
+			blend_block(x, y, z, weights, tx, ty, tz);
+			normalize_block(tx, ty, tz);
+		}
+		store_block(tx, ty, tz, normal_dst);
+	}
+}
+
+static const float *offset_or_null(const float *p, long long offset)
+{
+	return nullptr != p ? p + offset : nullptr;
+}
+
+static float *offset_or_null(float *p, long long offset)
+{
+	return nullptr != p ? p + offset : nullptr;
+}
+
+void MFX_ISA_NAME(transformPackedPoints)(const float *src, float *dst, const float *weights, const float *normal_src, float *normal_dst, int count, const float m[12], const float n[9])
+{
+	int block_end = count - count % kBlockPoints;
+	for (int i = 0; i < block_end; i += kBlockPoints) {
+		long long offset = 3 * static_cast<long long>(i);
+		transform_block(
+			offset_or_null(src, offset), offset_or_null(dst, offset),
+			offset_or_null(weights, i),
+			offset_or_null(normal_src, offset), offset_or_null(normal_dst, offset),
+			m, n);
+	}
+
+	// The last points go through a block padded with zeros
+	int tail = count - block_end;
+	if (tail == 0) return;
+	long long offset = 3 * static_cast<long long>(block_end);
+	float points[kBlockFloats] = {}, normals[kBlockFloats] = {}, tail_weights[kBlockPoints] = {};
+	for (int j = 0; j < 3 * tail; ++j) {
+		if (nullptr != src) points[j] = src[offset + j];
+		if (nullptr != normal_src) normals[j] = normal_src[offset + j];
+	}
+	for (int j = 0; j < tail; ++j) {
+		if (nullptr != weights) tail_weights[j] = weights[block_end + j];
+	}
+	transform_block(
+		nullptr != src ? points : nullptr, points,
+		nullptr != weights ? tail_weights : nullptr,
+		nullptr != normal_src ? normals : nullptr, normals,
+		m, n);
+	for (int j = 0; j < 3 * tail; ++j) {
+		if (nullptr != src) dst[offset + j] = points[j];
+		if (nullptr != normal_src) normal_dst[offset + j] = normals[j];
+	}
+}
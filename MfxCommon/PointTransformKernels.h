@@ -0,0 +1,44 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "CpuDispatch.h"
+
+/**
+ * Write src[i] + t for count packed points made of three floats. src and dst
+ * may be the same buffer. Compiled once per instruction set level, see
+ * CpuDispatch.h.
+ */
+MFX_DECLARE_ISA_VARIANTS(void, translatePackedPoints, (const float *src, float *dst, int count, const float t[3]));
+
+/**
+ * Write m * src[i] to dst[i] for count packed points, m being an affine
+ * transform stored as three rows of four floats, and the normal matrix n
+ * (3x3, row major) times normal_src[i], normalized, to normal_dst[i]. If
+ * weights is not null, each point only moves by weights[i] of the way and its
+ * normal turns by as much. src or normal_src may be null to skip positions or
+ * normals. Sources and destinations may be the same buffers.
+ */
+MFX_DECLARE_ISA_VARIANTS(void, transformPackedPoints, (const float *src, float *dst, const float *weights, const float *normal_src, float *normal_dst, int count, const float m[12], const float n[9]));
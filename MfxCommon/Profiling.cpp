@@ -0,0 +1,222 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "Profiling.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+static thread_local CookProfile *t_current_profile = nullptr;
+
+static int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count();
+}
+
+/**
+ * Page faults of the process so far, and its peak resident set size in bytes
+ */
+static void read_memory_usage(int64_t & page_faults, int64_t & peak_rss)
+{
+	page_faults = 0;
+	peak_rss = 0;
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		page_faults = static_cast<int64_t>(counters.PageFaultCount);
+		peak_rss = static_cast<int64_t>(counters.PeakWorkingSetSize);
+	}
+#else
+	struct rusage usage;
+	if (0 == getrusage(RUSAGE_SELF, &usage)) {
+		page_faults = static_cast<int64_t>(usage.ru_minflt) + static_cast<int64_t>(usage.ru_majflt);
+#ifdef __APPLE__
+		peak_rss = static_cast<int64_t>(usage.ru_maxrss);
+#else
+		peak_rss = static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+#endif
+}
+
+static ProfileMode read_profile_mode()
+{
+	const char *value = getenv("MFX_PROFILE");
+	if (nullptr == value || value[0] == '\0' || 0 == strcmp(value, "0")) return ProfileMode::Off;
+	if (0 == strcmp(value, "trace")) return ProfileMode::Trace;
+	return ProfileMode::Summary;
+}
+
+ProfileMode profileMode()
+{
+	static const ProfileMode mode = read_profile_mode();
+	return mode;
+}
+
+CookProfile *CookProfile::current()
+{
+	return t_current_profile;
+}
+
+CookProfile::CookProfile(const char *effect_name)
+	: m_effect_name(effect_name)
+	, m_mode(profileMode())
+	, m_previous(nullptr)
+	, m_depth(0)
+	, m_begin_ns(0)
+	, m_end_ns(0)
+	, m_begin_page_faults(0)
+{
+	if (m_mode == ProfileMode::Off) return;
+	m_previous = t_current_profile;
+	t_current_profile = this;
+	int64_t peak_rss;
+	read_memory_usage(m_begin_page_faults, peak_rss);
+	m_begin_ns = now_ns();
+}
+
+CookProfile::~CookProfile()
+{
+	if (m_mode == ProfileMode::Off) return;
+	m_end_ns = now_ns();
+	t_current_profile = m_previous;
+	// Page faults mostly come from first touching newly allocated memory
+	int64_t page_faults, peak_rss;
+	read_memory_usage(page_faults, peak_rss);
+	addCounter("page faults", page_faults - m_begin_page_faults);
+	addCounter("peak rss", peak_rss);
+	if (m_mode == ProfileMode::Summary) {
+		writeSummary();
+	} else {
+		writeTrace();
+	}
+}
+
+int CookProfile::beginPhase(const char *name)
+{
+	m_phases.push_back(phase_t{ name, now_ns(), 0, m_depth++ });
+	return static_cast<int>(m_phases.size()) - 1;
+}
+
+void CookProfile::endPhase(int phase)
+{
+	m_phases[phase].end_ns = now_ns();
+	--m_depth;
+}
+
+void CookProfile::addCounter(const char *name, int64_t value)
+{
+	for (counter_t & counter : m_counters) {
+		if (counter.name == name || 0 == strcmp(counter.name, name)) {
+			counter.value += value;
+			return;
+		}
+	}
+	m_counters.push_back(counter_t{ name, value });
+}
+
+void CookProfile::writeSummary() const
+{
+	std::string line = "[MfxProfile] ";
+	line += m_effect_name;
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), ": %.3f ms", (m_end_ns - m_begin_ns) * 1e-6);
+	line += buffer;
+	for (const phase_t & phase : m_phases) {
+		line += " | ";
+		line.append(2 * static_cast<size_t>(phase.depth), '>');
+		snprintf(buffer, sizeof(buffer), "%s %.3f ms", phase.name, (phase.end_ns - phase.begin_ns) * 1e-6);
+		line += buffer;
+	}
+	for (const counter_t & counter : m_counters) {
+		snprintf(buffer, sizeof(buffer), " | %s=%lld", counter.name, static_cast<long long>(counter.value));
+		line += buffer;
+	}
+	line += "\n";
+	fputs(line.c_str(), stderr);
+}
+
+void CookProfile::writeTrace() const
+{
+	const char *path = getenv("MFX_PROFILE_OUTPUT");
+	if (nullptr == path || path[0] == '\0') path = "mfx_trace.json";
+
+	int pid = static_cast<int>(getpid());
+	unsigned long long tid = static_cast<unsigned long long>(std::hash<std::thread::id>()(std::this_thread::get_id()) % 1000000);
+	char buffer[512];
+	std::string events;
+
+	// The whole cook, with counters as arguments
+	std::string args;
+	for (const counter_t & counter : m_counters) {
+		snprintf(buffer, sizeof(buffer), "%s\"%s\":%lld", args.empty() ? "" : ",", counter.name, static_cast<long long>(counter.value));
+		args += buffer;
+	}
+	snprintf(buffer, sizeof(buffer),
+		"{\"name\":\"%s\",\"cat\":\"cook\",\"ph\":\"X\",\"pid\":%d,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+		m_effect_name, pid, tid, m_begin_ns * 1e-3, (m_end_ns - m_begin_ns) * 1e-3);
+	events += buffer;
+	events += args + "}},\n";
+
+	for (const phase_t & phase : m_phases) {
+		snprintf(buffer, sizeof(buffer),
+			"{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":%d,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f},\n",
+			phase.name, pid, tid, phase.begin_ns * 1e-3, (phase.end_ns - phase.begin_ns) * 1e-3);
+		events += buffer;
+	}
+
+	// Cooks running concurrently in this plugin write one after the other,
+	// each in a single call so that other writers do not interleave.
+	static std::mutex file_mutex;
+	std::lock_guard<std::mutex> lock(file_mutex);
+	FILE *file = fopen(path, "ab");
+	if (nullptr == file) return;
+	fseek(file, 0, SEEK_END);
+	if (ftell(file) == 0) {
+		events = "[\n" + events;
+	}
+	fwrite(events.data(), 1, events.size(), file);
+	fclose(file);
+}
@@ -0,0 +1,142 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Instrumentation of cooks, shared by the plugins. A CookProfile covers one
+ * cook, ProfileScope times a phase of it and profileCounter() accumulates a
+ * named count. It is all off unless the MFX_PROFILE environment variable is
+ * set, in which case it costs a branch per scope or counter:
+ *
+ *   MFX_PROFILE=summary  one line per cook on stderr, with phase times and
+ *                        counters
+ *   MFX_PROFILE=trace    Chrome trace events (chrome://tracing, Perfetto)
+ *                        appended to MFX_PROFILE_OUTPUT, or mfx_trace.json
+ *
+ * Every cook also reports the page faults of the process while it ran and
+ * the peak resident set size of the process, in bytes.
+ *
+ * The trace file is a JSON array left open, as allowed by the trace event
+ * format, so that several plugins and processes can append to it.
+ */
+enum class ProfileMode {
+	Off,
+	Summary,
+	Trace,
+};
+
+/**
+ * Mode set by the environment, read once
+ */
+ProfileMode profileMode();
+
+class CookProfile {
+public:
+	/**
+	 * effect_name must outlive the profile, names of phases and counters
+	 * must be string literals.
+	 */
+	explicit CookProfile(const char *effect_name);
+	~CookProfile();
+	CookProfile(const CookProfile &) = delete;
+	CookProfile & operator=(const CookProfile &) = delete;
+
+	/**
+	 * Profile of the cook running on the calling thread, or nullptr when
+	 * profiling is off. Worker threads have none, they report to the cook
+	 * thread instead.
+	 */
+	static CookProfile *current();
+
+	int beginPhase(const char *name);
+	void endPhase(int phase);
+	void addCounter(const char *name, int64_t value);
+
+private:
+	struct phase_t {
+		const char *name;
+		int64_t begin_ns;
+		int64_t end_ns;
+		int depth;
+	};
+
+	struct counter_t {
+		const char *name;
+		int64_t value;
+	};
+
+	void writeSummary() const;
+	void writeTrace() const;
+
+private:
+	const char *m_effect_name;
+	ProfileMode m_mode;
+	CookProfile *m_previous;
+	int m_depth;
+	int64_t m_begin_ns;
+	int64_t m_end_ns;
+	int64_t m_begin_page_faults;
+	std::vector<phase_t> m_phases;
+	std::vector<counter_t> m_counters;
+};
+
+/**
+ * Time the enclosing scope, or until stop(), as a phase of the current cook
+ */
+class ProfileScope {
+public:
+	explicit ProfileScope(const char *name)
+		: m_profile(CookProfile::current())
+		, m_phase(nullptr == m_profile ? -1 : m_profile->beginPhase(name))
+	{}
+
+	~ProfileScope() { stop(); }
+
+	ProfileScope(const ProfileScope &) = delete;
+	ProfileScope & operator=(const ProfileScope &) = delete;
+
+	void stop() {
+		if (nullptr != m_profile) {
+			m_profile->endPhase(m_phase);
+			m_profile = nullptr;
+		}
+	}
+
+private:
+	CookProfile *m_profile;
+	int m_phase;
+};
+
+/**
+ * Add value to a counter of the current cook
+ */
+inline void profileCounter(const char *name, int64_t value)
+{
+	CookProfile *profile = CookProfile::current();
+	if (nullptr != profile) profile->addCounter(name, value);
+}
@@ -0,0 +1,96 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "Parallel.h"
+#include "ScratchArena.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * Stable LSD radix sort of (key, value) pairs by the key_bits lowest bits of
+ * their unsigned integer keys. Both arrays are sorted in place, and pairs
+ * with equal keys keep their relative order. The temporary copies of both
+ * arrays are allocated from arena when it is not null.
+ */
+template <typename Key, typename Value>
+void radixSort(Key *keys, Value *values, int count, int key_bits, int thread_count = 0, ScratchArena *arena = nullptr)
+{
+	constexpr int kBits = 11;
+	constexpr int kBuckets = 1 << kBits;
+	constexpr int kGrain = 1 << 16;
+
+	if (count <= 1 || key_bits <= 0) return;
+
+	ScratchVector<Key> keys_tmp(count, Key(), arena);
+	ScratchVector<Value> values_tmp(count, Value(), arena);
+	int chunk_count = chunkCount(count, kGrain, thread_count);
+	std::vector<int> histograms(static_cast<size_t>(chunk_count) * kBuckets);
+
+	Key *src_keys = keys, *dst_keys = keys_tmp.data();
+	Value *src_values = values, *dst_values = values_tmp.data();
+	for (int shift = 0; shift < key_bits; shift += kBits) {
+		std::fill(histograms.begin(), histograms.end(), 0);
+		parallelForChunks(chunk_count, [&](int chunk) {
+			int *hist = &histograms[static_cast<size_t>(chunk) * kBuckets];
+			int end = chunkBegin(count, chunk_count, chunk + 1);
+			for (int i = chunkBegin(count, chunk_count, chunk); i < end; ++i) {
+				++hist[(src_keys[i] >> shift) & (kBuckets - 1)];
+			}
+		});
+
+		// Digit major, chunk minor, so that the sort is stable
+		int sum = 0;
+		for (int d = 0; d < kBuckets; ++d) {
+			for (int c = 0; c < chunk_count; ++c) {
+				int & h = histograms[static_cast<size_t>(c) * kBuckets + d];
+				int n = h;
+				h = sum;
+				sum += n;
+			}
+		}
+
+		parallelForChunks(chunk_count, [&](int chunk) {
+			int *offset = &histograms[static_cast<size_t>(chunk) * kBuckets];
+			int end = chunkBegin(count, chunk_count, chunk + 1);
+			for (int i = chunkBegin(count, chunk_count, chunk); i < end; ++i) {
+				int j = offset[(src_keys[i] >> shift) & (kBuckets - 1)]++;
+				dst_keys[j] = src_keys[i];
+				dst_values[j] = src_values[i];
+			}
+		});
+
+		std::swap(src_keys, dst_keys);
+		std::swap(src_values, dst_values);
+	}
+
+	if (src_keys != keys) {
+		parallelFor(0, count, kGrain, thread_count, [&](int b, int e) {
+			std::copy(src_keys + b, src_keys + e, keys + b);
+			std::copy(src_values + b, src_values + e, values + b);
+		});
+	}
+}
@@ -0,0 +1,43 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+
+#pragma once
+
+/**
+ * MfxRuntime is the shared library holding the state that all the plugins
+ * loaded in a process must share, namely the pool of worker threads
+ * (TaskScheduler.h) and the cook running on each thread (CookProgress.h).
+ * Linking it statically into each plugin binary would give each one its
+ * own copy. MFX_RUNTIME_API marks what it exports.
+ */
+#if defined(_WIN32)
+#  if defined(MFX_RUNTIME_BUILD)
+#    define MFX_RUNTIME_API __declspec(dllexport)
+#  else
+#    define MFX_RUNTIME_API __declspec(dllimport)
+#  endif
+#else
+#  define MFX_RUNTIME_API __attribute__((visibility("default")))
+#endif
@@ -0,0 +1,122 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "ScratchArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+static size_t align_up(size_t size)
+{
+	return (size + ScratchArena::kAlignment - 1) & ~(ScratchArena::kAlignment - 1);
+}
+
+ScratchArena::~ScratchArena()
+{
+	release();
+}
+
+void ScratchArena::reset()
+{
+	m_top = 0;
+	m_current = 0;
+	if (m_chunks.size() > 1) {
+		size_t peak = m_peak;
+		release();
+		addChunk(peak);
+	}
+	m_peak = 0;
+}
+
+void ScratchArena::release()
+{
+	for (const chunk_t & chunk : m_chunks) {
+		free(chunk.storage);
+	}
+	m_chunks.clear();
+	m_current = 0;
+	m_top = 0;
+}
+
+size_t ScratchArena::capacity() const
+{
+	return m_chunks.empty() ? 0 : m_chunks.back().base + m_chunks.back().size;
+}
+
+void ScratchArena::addChunk(size_t size)
+{
+	// Chunks at least double the capacity, so that a cook adds few of them
+	size = align_up(std::max(std::max(size, capacity()), kMinChunkSize));
+	char *storage = static_cast<char*>(malloc(size + kAlignment));
+	if (nullptr == storage) throw std::bad_alloc();
+	char *data = storage + (kAlignment - reinterpret_cast<uintptr_t>(storage) % kAlignment) % kAlignment;
+	m_chunks.push_back(chunk_t{ storage, data, size, capacity() });
+}
+
+void *ScratchArena::allocate(size_t size)
+{
+	size = align_up(std::max<size_t>(size, 1));
+	for (;;) {
+		if (m_current < m_chunks.size()) {
+			// The end of a chunk that is too small is skipped
+			const chunk_t & chunk = m_chunks[m_current];
+			size_t offset = std::max(m_top, chunk.base) - chunk.base;
+			if (offset + size <= chunk.size) {
+				m_top = chunk.base + offset + size;
+				m_peak = std::max(m_peak, m_top);
+				return chunk.data + offset;
+			}
+			if (m_current + 1 < m_chunks.size()) {
+				++m_current;
+				continue;
+			}
+		}
+		addChunk(size);
+		m_current = m_chunks.size() - 1;
+	}
+}
+
+void ScratchArena::deallocate(void *p, size_t size)
+{
+	if (m_current >= m_chunks.size()) return;
+	// Only the top of the stack is given back, the rest waits for a
+	// rewind() or reset()
+	const chunk_t & chunk = m_chunks[m_current];
+	size = align_up(std::max<size_t>(size, 1));
+	if (m_top >= chunk.base + size && static_cast<char*>(p) == chunk.data + (m_top - chunk.base - size)) {
+		m_top -= size;
+	}
+}
+
+void ScratchArena::rewind(size_t mark)
+{
+	assert(mark <= m_top);
+	m_top = mark;
+	while (m_current > 0 && m_chunks[m_current].base > mark) {
+		--m_current;
+	}
+}
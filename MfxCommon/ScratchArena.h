@@ -0,0 +1,144 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Stack allocator for the scratch memory of a cook, meant to be kept from
+ * one cook to the next so that large temporary arrays stop going back and
+ * forth to the system. Allocations are carved out of large chunks, freeing
+ * the most recent allocation gives its memory back, and rewind() drops
+ * everything allocated after a mark() at once, so arrays whose lifetimes do
+ * not overlap share the same memory.
+ *
+ * When a cook needs more than the arena holds, new chunks are added, and
+ * reset() then merges them into a single chunk as large as the peak usage
+ * of that cook, so that the next cook of the same size runs from memory
+ * that is already mapped.
+ *
+ * An arena is used by one thread at a time.
+ */
+class ScratchArena {
+public:
+	ScratchArena() = default;
+	~ScratchArena();
+	ScratchArena(const ScratchArena &) = delete;
+	ScratchArena & operator=(const ScratchArena &) = delete;
+
+	/**
+	 * Start a new cook, all previous allocations must have been freed
+	 */
+	void reset();
+
+	/**
+	 * Free all chunks, e.g. when an instance goes idle
+	 */
+	void release();
+
+	void *allocate(size_t size);
+	void deallocate(void *p, size_t size);
+
+	size_t mark() const { return m_top; }
+	void rewind(size_t mark);
+
+	/**
+	 * Total size of the chunks, in bytes
+	 */
+	size_t capacity() const;
+
+	int chunkCount() const { return static_cast<int>(m_chunks.size()); }
+
+	/**
+	 * Largest number of bytes allocated at once since the last reset()
+	 */
+	size_t peakUsage() const { return m_peak; }
+
+public:
+	// Allocations are aligned on cache lines
+	static constexpr size_t kAlignment = 64;
+	static constexpr size_t kMinChunkSize = 1 << 20;
+
+private:
+	struct chunk_t {
+		char *storage; // as returned by malloc
+		char *data; // storage aligned on kAlignment
+		size_t size;
+		size_t base; // offset of the chunk in the stack
+	};
+
+	void addChunk(size_t size);
+
+private:
+	std::vector<chunk_t> m_chunks;
+	// Chunk that holds the top of the stack
+	size_t m_current = 0;
+	// Top of the stack, chunks being laid end to end
+	size_t m_top = 0;
+	size_t m_peak = 0;
+};
+
+/**
+ * Standard allocator drawing from a ScratchArena, or from the heap when the
+ * arena is null, so that containers can be given an arena optionally.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	ArenaAllocator(ScratchArena *arena = nullptr) : m_arena(arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> & other) : m_arena(other.arena()) {}
+
+	T *allocate(size_t n) {
+		size_t size = n * sizeof(T);
+		return static_cast<T*>(nullptr == m_arena ? ::operator new(size) : m_arena->allocate(size));
+	}
+
+	void deallocate(T *p, size_t n) {
+		if (nullptr == m_arena) {
+			::operator delete(p);
+		}
+		else {
+			m_arena->deallocate(p, n * sizeof(T));
+		}
+	}
+
+	ScratchArena *arena() const { return m_arena; }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U> & other) const { return m_arena == other.arena(); }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U> & other) const { return m_arena != other.arena(); }
+
+private:
+	ScratchArena *m_arena;
+};
+
+template <typename T>
+using ScratchVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,291 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "TaskScheduler.h"
+#include "CookProgress.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Cap of the innermost ThreadCapScope, or of the group whose task is being
+// run by this thread; 0 when there is none
+static thread_local int t_thread_cap = 0;
+
+static int read_process_thread_cap()
+{
+	const char *value = getenv("MFX_THREADS");
+	int cap = nullptr == value ? 0 : atoi(value);
+	if (cap > 0) return cap;
+	unsigned int n = std::thread::hardware_concurrency();
+	return n == 0 ? 1 : static_cast<int>(n);
+}
+
+static int process_thread_cap()
+{
+	static const int cap = read_process_thread_cap();
+	return cap;
+}
+
+int threadCap()
+{
+	int cap = process_thread_cap();
+	return t_thread_cap > 0 ? std::min(cap, t_thread_cap) : cap;
+}
+
+ThreadCapScope::ThreadCapScope(int thread_cap)
+	: m_previous(t_thread_cap)
+{
+	if (thread_cap > 0) t_thread_cap = thread_cap;
+}
+
+ThreadCapScope::~ThreadCapScope()
+{
+	t_thread_cap = m_previous;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/**
+ * Slot of the table of task groups. Slots belong to the scheduler and are
+ * never freed, so any thread may look at any slot at any time. users counts
+ * the threads looking at a slot, and its owner only lets it be reused once
+ * they are gone. The other fields are written by the owner while the slot
+ * is inactive, and only read by other threads once it is active.
+ */
+struct group_slot_t {
+	std::atomic<bool> busy{ false }; // owned by a call to runTasks()
+	std::atomic<bool> active{ false }; // tasks may be claimed
+	std::atomic<int> users{ 0 };
+	std::atomic<int> next{ 0 }; // next task to claim
+	std::atomic<int> done{ 0 }; // number of finished tasks
+	void (*fn)(void *context, int task) = nullptr;
+	void *context = nullptr;
+	int task_count = 0;
+	int thread_cap = 0;
+	CookProgress *progress = nullptr;
+};
+
+class Scheduler {
+public:
+	static Scheduler & instance() {
+		static Scheduler scheduler(process_thread_cap() - 1);
+		return scheduler;
+	}
+
+	void run(int task_count, void (*fn)(void *context, int task), void *context);
+
+private:
+	explicit Scheduler(int worker_count);
+	~Scheduler();
+
+	group_slot_t *acquireSlot();
+
+	/**
+	 * Claim and run a task of the group of an active slot, the caller being
+	 * one of its users. Returns false if all its tasks are already claimed.
+	 */
+	bool runTask(group_slot_t & slot);
+
+	/**
+	 * Run one task of any active group but except, returns false if there
+	 * was none to claim.
+	 */
+	bool helpOthers(const group_slot_t *except);
+
+	void wakeWorkers();
+	void workerLoop();
+
+private:
+	static constexpr int kMaxGroups = 256;
+	// Rounds of looking for work before an idle worker goes to sleep
+	static constexpr int kSpinRounds = 64;
+
+	group_slot_t m_slots[kMaxGroups];
+	// Slots [0, m_slot_limit) have been used at least once, others are not scanned
+	std::atomic<int> m_slot_limit{ 0 };
+	// Incremented when a group is published, to wake sleeping workers
+	std::atomic<unsigned int> m_generation{ 0 };
+	std::atomic<int> m_sleeping{ 0 };
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stop;
+	std::vector<std::thread> m_workers;
+};
+
+Scheduler::Scheduler(int worker_count)
+	: m_stop(false)
+{
+	m_workers.reserve(std::max(0, worker_count));
+	for (int i = 0; i < worker_count; ++i) {
+		m_workers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+Scheduler::~Scheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread & worker : m_workers) {
+		worker.join();
+	}
+}
+
+group_slot_t *Scheduler::acquireSlot()
+{
+	for (int i = 0; i < kMaxGroups; ++i) {
+		group_slot_t & slot = m_slots[i];
+		if (slot.busy.load(std::memory_order_relaxed) || slot.busy.exchange(true, std::memory_order_acquire)) continue;
+		int limit = m_slot_limit.load();
+		while (limit < i + 1 && !m_slot_limit.compare_exchange_weak(limit, i + 1)) {}
+		return &slot;
+	}
+	return nullptr;
+}
+
+bool Scheduler::runTask(group_slot_t & slot)
+{
+	if (slot.next.load(std::memory_order_relaxed) >= slot.task_count) return false;
+	int task = slot.next.fetch_add(1, std::memory_order_relaxed);
+	if (task >= slot.task_count) return false;
+
+	// Nested parallel calls of the task get the cap of its group, and
+	// checkpoints report to the cook that issued it
+	int previous_cap = t_thread_cap;
+	t_thread_cap = slot.thread_cap;
+	CookProgress *previous_progress = CookProgress::makeCurrent(slot.progress);
+	slot.fn(slot.context, task);
+	CookProgress::makeCurrent(previous_progress);
+	t_thread_cap = previous_cap;
+
+	slot.done.fetch_add(1, std::memory_order_release);
+	return true;
+}
+
+bool Scheduler::helpOthers(const group_slot_t *except)
+{
+	int limit = m_slot_limit.load(std::memory_order_acquire);
+	for (int i = 0; i < limit; ++i) {
+		group_slot_t & slot = m_slots[i];
+		if (&slot == except || !slot.active.load(std::memory_order_relaxed)) continue;
+		slot.users.fetch_add(1);
+		bool ran = slot.active.load() && runTask(slot);
+		slot.users.fetch_sub(1, std::memory_order_release);
+		if (ran) return true;
+	}
+	return false;
+}
+
+void Scheduler::wakeWorkers()
+{
+	m_generation.fetch_add(1);
+	if (m_sleeping.load() > 0) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_wake.notify_all();
+	}
+}
+
+void Scheduler::workerLoop()
+{
+	int idle_rounds = 0;
+	for (;;) {
+		unsigned int generation = m_generation.load();
+		if (helpOthers(nullptr)) {
+			idle_rounds = 0;
+			continue;
+		}
+		if (++idle_rounds < kSpinRounds) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_stop) return;
+		m_sleeping.fetch_add(1);
+		m_wake.wait(lock, [&]() { return m_stop || m_generation.load() != generation; });
+		m_sleeping.fetch_sub(1);
+		if (m_stop) return;
+		idle_rounds = 0;
+	}
+}
+
+void Scheduler::run(int task_count, void (*fn)(void *context, int task), void *context)
+{
+	group_slot_t *slot = acquireSlot();
+	if (nullptr == slot) {
+		// Too many groups at once, the caller runs this one alone
+		for (int task = 0; task < task_count; ++task) {
+			fn(context, task);
+		}
+		return;
+	}
+
+	slot->fn = fn;
+	slot->context = context;
+	slot->task_count = task_count;
+	slot->thread_cap = threadCap();
+	slot->progress = CookProgress::current();
+	slot->next.store(0, std::memory_order_relaxed);
+	slot->done.store(0, std::memory_order_relaxed);
+	slot->active.store(true);
+	wakeWorkers();
+
+	while (runTask(*slot)) {}
+
+	// Tasks claimed by other threads may still be running. Rather than
+	// blocking, run tasks of other groups meanwhile.
+	while (slot->done.load(std::memory_order_acquire) < task_count) {
+		if (!helpOthers(slot)) std::this_thread::yield();
+	}
+
+	slot->active.store(false);
+	while (slot->users.load() != 0) {
+		std::this_thread::yield();
+	}
+	slot->busy.store(false, std::memory_order_release);
+}
+
+} // anonymous namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+void runTasks(int task_count, void (*fn)(void *context, int task), void *context)
+{
+	if (task_count <= 1 || threadCap() <= 1) {
+		for (int task = 0; task < task_count; ++task) {
+			fn(context, task);
+		}
+		return;
+	}
+	Scheduler::instance().run(task_count, fn, context);
+}
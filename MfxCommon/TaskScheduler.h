@@ -0,0 +1,73 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "RuntimeApi.h"
+
+/**
+ * Process wide pool of worker threads behind the primitives of Parallel.h,
+ * living in the MfxRuntime shared library so that all the plugin binaries
+ * loaded in a process, and all their effects and instances, share it and
+ * concurrent cooks do not oversubscribe the machine.
+ *
+ * Each parallel call publishes a task group of task_count tasks. The calling
+ * thread runs tasks of its own group, and idle workers steal tasks from any
+ * active group. While a caller waits for the last tasks of its group to be
+ * finished by other threads, it helps with the tasks of other groups rather
+ * than blocking, so nested parallel calls and concurrent cooks cannot
+ * starve each other. Workers are started on the first parallel call, and
+ * sleep when there is nothing to do.
+ */
+
+/**
+ * Call fn(context, task) for each task in [0, task_count) and return once
+ * they are all done. Tasks may run in any order, concurrently or not, so
+ * they must not wait for each other.
+ */
+MFX_RUNTIME_API void runTasks(int task_count, void (*fn)(void *context, int task), void *context);
+
+/**
+ * Max number of threads a parallel call started from the calling thread may
+ * use: the number of hardware threads, or the MFX_THREADS environment
+ * variable if set, further capped by the innermost ThreadCapScope active on
+ * this thread or on the thread that issued the task running on it.
+ */
+MFX_RUNTIME_API int threadCap();
+
+/**
+ * Cap the number of threads used by parallel calls made by the current
+ * thread, and by the tasks they spawn, until the end of the scope, e.g. from
+ * a "threads" parameter of an effect. A cap <= 0 leaves the current one.
+ */
+class MFX_RUNTIME_API ThreadCapScope {
+public:
+	explicit ThreadCapScope(int thread_cap);
+	~ThreadCapScope();
+	ThreadCapScope(const ThreadCapScope &) = delete;
+	ThreadCapScope & operator=(const ThreadCapScope &) = delete;
+
+private:
+	int m_previous;
+};
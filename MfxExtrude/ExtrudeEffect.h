@@ -0,0 +1,207 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019 - 2022 -- Élie Michel <elie.michel@exppad.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "Extrusion.h"
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxEffect>
+
+#include <MfxCommon/AttributeForwarding.h>
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/HostProgress.h>
+#include <MfxCommon/Profiling.h>
+#include <MfxCommon/TaskScheduler.h>
+
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+class ExtrudeEffect : public MfxEffect {
+public:
+	const char* GetName() override
+	{ return "Extrude"; }
+
+protected:
+	OfxStatus Describe(OfxMeshEffectHandle descriptor) override {
+		AddInput(kOfxMeshMainInput)
+			.RequestAttribute(
+				MfxAttributeAttachment::Face,
+				"selection",
+				1,
+				MfxAttributeType::Float,
+				MfxAttributeSemantic::Weight,
+				false
+			);
+		AddInput(kOfxMeshMainOutput);
+
+		AddParam("face_index", 0)
+			.Label("Face Index (when no selection)");
+
+		AddParam("distance", 1.0)
+			.Label("Distance");
+
+		AddParam("threads", 0)
+			.Label("Threads (0: all, as allowed by MFX_THREADS)")
+			.Range(0, 1024);
+
+		return kOfxStatOK;
+	}
+
+	OfxStatus Cook(OfxMeshEffectHandle instance) override {
+		CookProfile profile(GetName());
+		HostProgress progress(host(), instance, GetName());
+		ThreadCapScope thread_cap(GetParam<int>("threads").GetValue());
+		profileCounter("threads", threadCap());
+
+		ProfileScope fetch_scope("fetch");
+		MfxMesh inputMesh = GetInput(kOfxMeshMainInput).GetMesh();
+		MfxMesh outputMesh = GetInput(kOfxMeshMainOutput).GetMesh();
+
+		int face_index = GetParam<int>("face_index").GetValue();
+		double distance = GetParam<double>("distance").GetValue();
+
+		MfxMeshProps inputMeshProps;
+		inputMesh.FetchProperties(inputMeshProps);
+		int faceCount = inputMeshProps.faceCount;
+		fetch_scope.stop();
+
+		// 1. Selected faces, from the "selection" face attribute if the host
+		// provides one, otherwise the single face at face_index
+		ProfileScope selection_scope("selection");
+		cookStage(0.2, 0);
+		std::vector<uint8_t> selected(faceCount, 0);
+		if (inputMesh.HasFaceAttribute("selection")) {
+			MfxAttributeProps selectionProps;
+			inputMesh.GetFaceAttribute("selection").FetchProperties(selectionProps);
+			AttributeView<uint8_t> selection = AttributeView<uint8_t>::packed(selected.data(), faceCount);
+			switch (selectionProps.type) {
+			case MfxAttributeType::Float:
+				transformAttribute(attributeView<const float>(selectionProps, faceCount), selection, [](const float *w, uint8_t *s) { *s = *w > 0.5f; });
+				break;
+			case MfxAttributeType::Int:
+				transformAttribute(attributeView<const int>(selectionProps, faceCount), selection, [](const int *w, uint8_t *s) { *s = *w != 0; });
+				break;
+			case MfxAttributeType::UByte:
+				transformAttribute(attributeView<const uint8_t>(selectionProps, faceCount), selection, [](const uint8_t *w, uint8_t *s) { *s = *w != 0; });
+				break;
+			default:
+				break;
+			}
+		} else if (face_index >= 0 && face_index < faceCount) {
+			selected[face_index] = 1;
+		}
+		selection_scope.stop();
+
+		MfxAttribute inputPoints = inputMesh.GetCornerAttribute(kOfxMeshAttribCornerPoint);
+		MfxAttribute outputPoints = outputMesh.GetCornerAttribute(kOfxMeshAttribCornerPoint);
+		MfxAttribute inputFaces = inputMesh.GetFaceAttribute(kOfxMeshAttribFaceSize);
+		MfxAttribute outputFaces = outputMesh.GetFaceAttribute(kOfxMeshAttribFaceSize);
+
+		// Faces of triangle and quad meshes may all have constantFaceSize
+		// corners, and then the face size attribute is not read
+		int constantFaceSize = inputMeshProps.constantFaceSize;
+		MfxAttributeProps inputPos, inputCornerPoints, inputFaceSizes = {};
+		inputMesh.GetPointAttribute(kOfxMeshAttribPointPosition).FetchProperties(inputPos);
+		inputPoints.FetchProperties(inputCornerPoints);
+		if (constantFaceSize <= 0) {
+			inputFaces.FetchProperties(inputFaceSizes);
+		}
+
+		// 2. Adjacency of the selection and output element counts
+		if (cookCancelled()) return cancelCook(inputMesh, outputMesh);
+		ProfileScope adjacency_scope("adjacency");
+		cookStage(0.6, 0);
+		Extrusion extrusion;
+		extrusion.count(
+			inputPos.data, inputPos.stride, inputMeshProps.pointCount,
+			inputCornerPoints.data, inputCornerPoints.stride, inputMeshProps.cornerCount,
+			inputFaceSizes.data, inputFaceSizes.stride, faceCount,
+			selected.data(), constantFaceSize
+		);
+		adjacency_scope.stop();
+		profileCounter("side faces", extrusion.outputFaceCount() - faceCount);
+		profileCounter("duplicated points", extrusion.outputPointCount() - inputMeshProps.pointCount);
+		if (cookCancelled()) return cancelCook(inputMesh, outputMesh);
+		cookStage(1.0, 0);
+
+		MfxAttributeProps outputPos;
+		if (extrusion.isIdentity()) {
+			// Nothing to extrude, topology is forwarded rather than copied
+			bool forwardedPoints = forwardAttribute(outputPoints, inputPoints);
+			bool forwardedFaces = constantFaceSize > 0 || forwardAttribute(outputFaces, inputFaces);
+
+			ProfileScope allocate_scope("allocate");
+			outputMesh.Allocate(inputMeshProps.pointCount, inputMeshProps.cornerCount, faceCount, inputMeshProps.noLooseEdge, constantFaceSize);
+			allocate_scope.stop();
+
+			ProfileScope fill_scope("fill");
+			outputMesh.GetPointAttribute(kOfxMeshAttribPointPosition).FetchProperties(outputPos);
+			int pointCount = inputMeshProps.pointCount;
+			copyAttribute(attributeView<const float, 3>(inputPos, pointCount), attributeView<float, 3>(outputPos, pointCount));
+
+			if (!forwardedPoints) {
+				outputPoints.CopyFrom(inputPoints, 0, inputMeshProps.cornerCount);
+			}
+			if (!forwardedFaces) {
+				outputFaces.CopyFrom(inputFaces, 0, faceCount);
+			}
+		} else {
+			// 3. Allocate the output once, then fill it with parallel passes
+			ProfileScope allocate_scope("allocate");
+			int outputConstantFaceSize = extrusion.outputConstantFaceSize();
+			outputMesh.Allocate(extrusion.outputPointCount(), extrusion.outputCornerCount(), extrusion.outputFaceCount(), inputMeshProps.noLooseEdge, outputConstantFaceSize);
+
+			MfxAttributeProps outputCornerPoints, outputFaceSizes = {};
+			outputMesh.GetPointAttribute(kOfxMeshAttribPointPosition).FetchProperties(outputPos);
+			outputPoints.FetchProperties(outputCornerPoints);
+			if (outputConstantFaceSize <= 0) {
+				outputFaces.FetchProperties(outputFaceSizes);
+			}
+			allocate_scope.stop();
+
+			ProfileScope fill_scope("fill");
+			extrusion.writePoints(outputPos.data, outputPos.stride, static_cast<float>(distance));
+			extrusion.writeCorners(outputCornerPoints.data, outputCornerPoints.stride);
+			if (outputConstantFaceSize <= 0) {
+				extrusion.writeFaceSizes(outputFaceSizes.data, outputFaceSizes.stride);
+			}
+		}
+
+		ProfileScope release_scope("release");
+		inputMesh.Release();
+		outputMesh.Release();
+		return kOfxStatOK;
+	}
+
+private:
+	/**
+	 * Give up a cancelled cook, releasing both meshes like a complete one
+	 */
+	OfxStatus cancelCook(MfxMesh & inputMesh, MfxMesh & outputMesh) {
+		inputMesh.Release();
+		outputMesh.Release();
+		return kOfxStatFailed;
+	}
+};
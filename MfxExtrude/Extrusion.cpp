@@ -0,0 +1,360 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "Extrusion.h"
+
+#include <MfxCommon/FaceSize.h>
+#include <MfxCommon/Parallel.h>
+#include <MfxCommon/RadixSort.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+static constexpr int kPointGrain = 1 << 16;
+static constexpr int kFaceGrain = 1 << 14;
+
+enum PointFlag : uint8_t {
+	kUsedBySelected = 1,
+	kUsedByUnselected = 2,
+	kOnSelectionBoundary = 4,
+};
+
+/**
+ * Number of bits needed to store any value in [0, count)
+ */
+static int bit_count(int count)
+{
+	int bits = 1;
+	while (bits < 31 && (1 << bits) < count) {
+		++bits;
+	}
+	return bits;
+}
+
+Extrusion::Extrusion(int thread_count)
+	: m_thread_count(resolveThreadCount(thread_count))
+	, m_selected(nullptr)
+	, m_point_count(0)
+	, m_corner_count(0)
+	, m_face_count(0)
+	, m_constant_face_size(-1)
+	, m_duplicated_point_count(0)
+	, m_side_face_count(0)
+{}
+
+void Extrusion::count(
+	const char *position_data, int position_stride, int point_count,
+	const char *corner_data, int corner_stride, int corner_count,
+	const char *face_size_data, int face_size_stride, int face_count,
+	const uint8_t *selected, int constant_face_size)
+{
+	m_positions = AttributeView<const float, 3>(position_data, position_stride, point_count);
+	m_corners = AttributeView<const int>(corner_data, corner_stride, corner_count);
+	m_selected = selected;
+	m_point_count = point_count;
+	m_corner_count = corner_count;
+	m_face_count = face_count;
+	m_constant_face_size = constant_face_size;
+	int threads = m_thread_count;
+
+	// Faces of constant size start at implicit offsets
+	if (constant_face_size > 0) {
+		m_face_start.clear();
+	}
+	else {
+		m_face_start.resize(face_count + 1);
+		copyAttribute(
+			AttributeView<const int>(face_size_data, face_size_stride, face_count),
+			AttributeView<int>::packed(m_face_start.data(), face_count),
+			threads
+		);
+		m_face_start[face_count] = parallelExclusiveScan(m_face_start.data(), face_count, threads);
+	}
+
+	// List selected faces and their corners
+	std::vector<int> selected_rank(face_count);
+	parallelFor(0, face_count, kFaceGrain, threads, [&](int b, int e) {
+		for (int f = b; f < e; ++f) {
+			selected_rank[f] = selected[f] ? 1 : 0;
+		}
+	});
+	int selected_count = parallelExclusiveScan(selected_rank.data(), face_count, threads);
+	m_selected_faces.resize(selected_count);
+	m_selected_corner_start.resize(selected_count + 1);
+	parallelFor(0, face_count, kFaceGrain, threads, [&](int b, int e) {
+		for (int f = b; f < e; ++f) {
+			if (!selected[f]) continue;
+			int s = selected_rank[f];
+			m_selected_faces[s] = f;
+			m_selected_corner_start[s] = faceStart(f + 1) - faceStart(f);
+		}
+	});
+	selected_rank = std::vector<int>();
+	int selected_corner_count = parallelExclusiveScan(m_selected_corner_start.data(), selected_count, threads);
+	m_selected_corner_start[selected_count] = selected_corner_count;
+
+	m_side_face.clear();
+	m_cap_point.clear();
+	m_moved_points.clear();
+	m_moved_directions.clear();
+	m_duplicated_point_count = 0;
+	m_side_face_count = 0;
+	if (selected_count == 0) return;
+
+	// Edge structure of the selection: sorting the undirected edges of the
+	// selected faces groups together the corners that share an edge, and
+	// edges that appear only once bound the selection
+	int point_bits = bit_count(point_count);
+	{
+		std::vector<uint64_t> edge_keys(selected_corner_count);
+		std::vector<int> edge_corners(selected_corner_count);
+		parallelFor(0, selected_count, kFaceGrain, threads, [&](int b, int e) {
+			for (int s = b; s < e; ++s) {
+				int begin = faceStart(m_selected_faces[s]);
+				int size = m_selected_corner_start[s + 1] - m_selected_corner_start[s];
+				for (int j = 0; j < size; ++j) {
+					uint64_t p0 = static_cast<uint64_t>(cornerPoint(begin + j));
+					uint64_t p1 = static_cast<uint64_t>(cornerPoint(begin + (j + 1) % size));
+					int k = m_selected_corner_start[s] + j;
+					edge_keys[k] = (std::min(p0, p1) << point_bits) | std::max(p0, p1);
+					edge_corners[k] = k;
+				}
+			}
+		});
+		radixSort(edge_keys.data(), edge_corners.data(), selected_corner_count, 2 * point_bits, threads);
+
+		m_side_face.resize(selected_corner_count);
+		parallelFor(0, selected_corner_count, kPointGrain, threads, [&](int b, int e) {
+			for (int i = b; i < e; ++i) {
+				bool single =
+					(i == 0 || edge_keys[i] != edge_keys[i - 1]) &&
+					(i == selected_corner_count - 1 || edge_keys[i] != edge_keys[i + 1]);
+				m_side_face[edge_corners[i]] = single ? 1 : 0;
+			}
+		});
+	}
+	std::vector<uint8_t> is_side(m_side_face.begin(), m_side_face.end());
+	m_side_face_count = parallelExclusiveScan(m_side_face.data(), selected_corner_count, threads);
+	parallelFor(0, selected_corner_count, kPointGrain, threads, [&](int b, int e) {
+		for (int k = b; k < e; ++k) {
+			if (!is_side[k]) m_side_face[k] = -1;
+		}
+	});
+
+	// Classify points
+	std::unique_ptr<std::atomic<uint8_t>[]> flags(new std::atomic<uint8_t>[point_count]);
+	parallelFor(0, point_count, kPointGrain, threads, [&](int b, int e) {
+		for (int p = b; p < e; ++p) {
+			flags[p].store(0, std::memory_order_relaxed);
+		}
+	});
+	dispatchFaceSize(constant_face_size, [&](auto face_size) {
+		constexpr int kFaceSize = decltype(face_size)::value;
+		parallelFor(0, face_count, kFaceGrain, threads, [&](int b, int e) {
+			for (int f = b; f < e; ++f) {
+				uint8_t flag = selected[f] ? kUsedBySelected : kUsedByUnselected;
+				int begin = kFaceSize > 0 ? f * kFaceSize : faceStart(f);
+				int end = kFaceSize > 0 ? begin + kFaceSize : faceStart(f + 1);
+				for (int c = begin; c < end; ++c) {
+					flags[cornerPoint(c)].fetch_or(flag, std::memory_order_relaxed);
+				}
+			}
+		});
+	});
+	parallelFor(0, selected_count, kFaceGrain, threads, [&](int b, int e) {
+		for (int s = b; s < e; ++s) {
+			int begin = faceStart(m_selected_faces[s]);
+			int size = m_selected_corner_start[s + 1] - m_selected_corner_start[s];
+			for (int j = 0; j < size; ++j) {
+				if (!is_side[m_selected_corner_start[s] + j]) continue;
+				flags[cornerPoint(begin + j)].fetch_or(kOnSelectionBoundary, std::memory_order_relaxed);
+				flags[cornerPoint(begin + (j + 1) % size)].fetch_or(kOnSelectionBoundary, std::memory_order_relaxed);
+			}
+		}
+	});
+
+	// Points of the selection that something else still holds on to are
+	// duplicated, appended after the input points
+	m_cap_point.resize(point_count);
+	parallelFor(0, point_count, kPointGrain, threads, [&](int b, int e) {
+		for (int p = b; p < e; ++p) {
+			uint8_t flag = flags[p].load(std::memory_order_relaxed);
+			m_cap_point[p] = (flag & kUsedBySelected) && (flag & (kUsedByUnselected | kOnSelectionBoundary)) ? 1 : 0;
+		}
+	});
+	m_duplicated_point_count = parallelExclusiveScan(m_cap_point.data(), point_count, threads);
+	parallelFor(0, point_count, kPointGrain, threads, [&](int b, int e) {
+		for (int p = b; p < e; ++p) {
+			uint8_t flag = flags[p].load(std::memory_order_relaxed);
+			if (!(flag & kUsedBySelected)) m_cap_point[p] = -1;
+			else if (flag & (kUsedByUnselected | kOnSelectionBoundary)) m_cap_point[p] += point_count;
+			else m_cap_point[p] = p;
+		}
+	});
+	flags.reset();
+
+	// Face normals (Newell's method, robust to non planar faces)
+	std::vector<float> face_normals(3 * static_cast<size_t>(selected_count));
+	parallelFor(0, selected_count, kFaceGrain, threads, [&](int b, int e) {
+		for (int s = b; s < e; ++s) {
+			int begin = faceStart(m_selected_faces[s]);
+			int size = m_selected_corner_start[s + 1] - m_selected_corner_start[s];
+			float n[3] = { 0, 0, 0 };
+			for (int j = 0; j < size; ++j) {
+				const float *u = position(cornerPoint(begin + j));
+				const float *v = position(cornerPoint(begin + (j + 1) % size));
+				n[0] += (u[1] - v[1]) * (u[2] + v[2]);
+				n[1] += (u[2] - v[2]) * (u[0] + v[0]);
+				n[2] += (u[0] - v[0]) * (u[1] + v[1]);
+			}
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			float scale = length > 0 ? 1 / length : 0;
+			for (int k = 0; k < 3; ++k) {
+				face_normals[3 * static_cast<size_t>(s) + k] = n[k] * scale;
+			}
+		}
+	});
+
+	// Group selected corners by point. The sort is stable so the normals
+	// of each point are summed in face order, whatever the thread count.
+	std::vector<uint32_t> corner_points(selected_corner_count);
+	std::vector<int> corner_faces(selected_corner_count);
+	parallelFor(0, selected_count, kFaceGrain, threads, [&](int b, int e) {
+		for (int s = b; s < e; ++s) {
+			int begin = faceStart(m_selected_faces[s]);
+			for (int k = m_selected_corner_start[s]; k < m_selected_corner_start[s + 1]; ++k) {
+				corner_points[k] = static_cast<uint32_t>(cornerPoint(begin + k - m_selected_corner_start[s]));
+				corner_faces[k] = s;
+			}
+		}
+	});
+	radixSort(corner_points.data(), corner_faces.data(), selected_corner_count, point_bits, threads);
+
+	std::vector<int> group_start(selected_corner_count);
+	parallelFor(0, selected_corner_count, kPointGrain, threads, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			group_start[i] = i == 0 || corner_points[i] != corner_points[i - 1];
+		}
+	});
+	int group_count = parallelExclusiveScan(group_start.data(), selected_corner_count, threads);
+	m_moved_points.resize(group_count);
+	m_moved_directions.resize(3 * static_cast<size_t>(group_count));
+	parallelFor(0, selected_corner_count, kPointGrain, threads, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			if (i != 0 && corner_points[i] == corner_points[i - 1]) continue;
+			float d[3] = { 0, 0, 0 };
+			for (int j = i; j < selected_corner_count && corner_points[j] == corner_points[i]; ++j) {
+				const float *n = &face_normals[3 * static_cast<size_t>(corner_faces[j])];
+				d[0] += n[0];
+				d[1] += n[1];
+				d[2] += n[2];
+			}
+			float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			float scale = length > 0 ? 1 / length : 0;
+			int g = group_start[i];
+			m_moved_points[g] = static_cast<int>(corner_points[i]);
+			for (int k = 0; k < 3; ++k) {
+				m_moved_directions[3 * static_cast<size_t>(g) + k] = d[k] * scale;
+			}
+		}
+	});
+}
+
+void Extrusion::writePoints(char *dst, int dst_stride, float distance) const
+{
+	AttributeView<float, 3> output(dst, dst_stride, outputPointCount());
+	copyAttribute(m_positions, output.slice(0, m_point_count), m_thread_count);
+
+	int moved_count = static_cast<int>(m_moved_points.size());
+	parallelFor(0, moved_count, kPointGrain, m_thread_count, [&](int b, int e) {
+		for (int g = b; g < e; ++g) {
+			int p = m_moved_points[g];
+			const float *in = position(p);
+			const float *d = &m_moved_directions[3 * static_cast<size_t>(g)];
+			float *out = output[m_cap_point[p]];
+			for (int k = 0; k < 3; ++k) {
+				out[k] = in[k] + distance * d[k];
+			}
+		}
+	});
+}
+
+void Extrusion::writeCorners(char *dst, int dst_stride) const
+{
+	AttributeView<int> output(dst, dst_stride, outputCornerCount());
+
+	// Faces keep their corners, selected ones are moved to the cap points
+	dispatchFaceSize(m_constant_face_size, [&](auto face_size) {
+		constexpr int kFaceSize = decltype(face_size)::value;
+		parallelFor(0, m_face_count, kFaceGrain, m_thread_count, [&](int b, int e) {
+			for (int f = b; f < e; ++f) {
+				bool is_selected = m_selected[f] != 0;
+				int begin = kFaceSize > 0 ? f * kFaceSize : faceStart(f);
+				int end = kFaceSize > 0 ? begin + kFaceSize : faceStart(f + 1);
+				for (int c = begin; c < end; ++c) {
+					int p = cornerPoint(c);
+					*output[c] = is_selected ? m_cap_point[p] : p;
+				}
+			}
+		});
+	});
+
+	// Side quads, oriented consistently with the selected face they border
+	int selected_count = static_cast<int>(m_selected_faces.size());
+	parallelFor(0, selected_count, kFaceGrain, m_thread_count, [&](int b, int e) {
+		for (int s = b; s < e; ++s) {
+			int begin = faceStart(m_selected_faces[s]);
+			int size = m_selected_corner_start[s + 1] - m_selected_corner_start[s];
+			for (int j = 0; j < size; ++j) {
+				int side = m_side_face[m_selected_corner_start[s] + j];
+				if (side < 0) continue;
+				int p0 = cornerPoint(begin + j);
+				int p1 = cornerPoint(begin + (j + 1) % size);
+				int quad[4] = { p0, p1, m_cap_point[p1], m_cap_point[p0] };
+				int out = m_corner_count + 4 * side;
+				for (int k = 0; k < 4; ++k) {
+					*output[out + k] = quad[k];
+				}
+			}
+		}
+	});
+}
+
+void Extrusion::writeFaceSizes(char *dst, int dst_stride) const
+{
+	AttributeView<int> output(dst, dst_stride, outputFaceCount());
+	parallelFor(0, m_face_count, kFaceGrain, m_thread_count, [&](int b, int e) {
+		for (int f = b; f < e; ++f) {
+			*output[f] = faceStart(f + 1) - faceStart(f);
+		}
+	});
+	parallelFor(m_face_count, m_face_count + m_side_face_count, kFaceGrain, m_thread_count, [&](int b, int e) {
+		for (int f = b; f < e; ++f) {
+			*output[f] = 4;
+		}
+	});
+}
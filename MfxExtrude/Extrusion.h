@@ -0,0 +1,125 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <MfxCommon/AttributeView.h>
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Extrudes regions of selected faces along their normals. Selected faces are
+ * moved by a given distance to become the caps of the extrusion, and a quad
+ * is added along each edge bounding the selection. Points of the selection
+ * that are still used by the rest of the mesh are duplicated, the others are
+ * moved in place.
+ *
+ * Like MeshCompaction in RemoveDoubles, this first counts the output
+ * elements so that the output mesh is allocated once, then each output
+ * attribute is filled by an independent parallel pass. Input buffers are read
+ * again by the write passes so they must outlive them.
+ */
+class Extrusion {
+public:
+	explicit Extrusion(int thread_count = 0);
+
+	/**
+	 * Build the edge structure of the selection and count the output
+	 * elements. selected holds one flag per face. If constant_face_size is
+	 * positive, all faces have this many corners and face_size_data is not
+	 * read, it may be null.
+	 */
+	void count(
+		const char *position_data, int position_stride, int point_count,
+		const char *corner_data, int corner_stride, int corner_count,
+		const char *face_size_data, int face_size_stride, int face_count,
+		const uint8_t *selected, int constant_face_size = -1);
+
+	/**
+	 * True when no face is selected, so the output is the input mesh
+	 */
+	bool isIdentity() const { return m_selected_faces.empty(); }
+
+	int outputPointCount() const { return m_point_count + m_duplicated_point_count; }
+	int outputCornerCount() const { return m_corner_count + 4 * m_side_face_count; }
+	int outputFaceCount() const { return m_face_count + m_side_face_count; }
+
+	/**
+	 * Size of all output faces when the input faces have a constant size
+	 * and the side quads, if any, have the same, -1 otherwise
+	 */
+	int outputConstantFaceSize() const {
+		return isIdentity() || m_constant_face_size == 4 ? m_constant_face_size : -1;
+	}
+
+	void writePoints(char *dst, int dst_stride, float distance) const;
+	void writeCorners(char *dst, int dst_stride) const;
+	void writeFaceSizes(char *dst, int dst_stride) const;
+
+private:
+	int cornerPoint(int corner) const {
+		return *m_corners[corner];
+	}
+
+	const float *position(int point) const {
+		return m_positions[point];
+	}
+
+	int faceStart(int face) const {
+		return m_constant_face_size > 0 ? face * m_constant_face_size : m_face_start[face];
+	}
+
+private:
+	int m_thread_count;
+
+	AttributeView<const float, 3> m_positions;
+	AttributeView<const int> m_corners;
+	const uint8_t *m_selected;
+	int m_point_count;
+	int m_corner_count;
+	int m_face_count;
+	int m_constant_face_size;
+
+	// First corner of each face, face_count + 1 elements, empty when faces
+	// have a constant size
+	std::vector<int> m_face_start;
+	// Indices of the selected faces
+	std::vector<int> m_selected_faces;
+	// First selected corner of each selected face, in the list of the
+	// corners of selected faces only
+	std::vector<int> m_selected_corner_start;
+	// For each selected corner, index of the side face built on the edge
+	// that starts at this corner, or -1 if the edge is inside the selection
+	std::vector<int> m_side_face;
+	// Output index of the cap copy of each point, -1 for unselected points
+	std::vector<int> m_cap_point;
+	// Points of the selection, and the direction they are moved along
+	std::vector<int> m_moved_points;
+	std::vector<float> m_moved_directions;
+
+	int m_duplicated_point_count;
+	int m_side_face_count;
+};
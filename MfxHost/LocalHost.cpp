@@ -0,0 +1,233 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "LocalHost.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+typedef int (*OfxGetNumberOfPluginsFunc)(void);
+typedef OfxPlugin *(*OfxGetPluginFunc)(int nth);
+
+static const void *fetchSuite(OfxPropertySetHandle host, const char *suiteName, int suiteVersion)
+{
+	if (suiteVersion != 1) return nullptr;
+	if (0 == strcmp(suiteName, kOfxPropertySuite)) return getPropertySuite();
+	if (0 == strcmp(suiteName, kOfxParameterSuite)) return getParameterSuite();
+	if (0 == strcmp(suiteName, kOfxMeshEffectSuite)) return getMeshEffectSuite();
+	return nullptr;
+}
+
+OfxHost *getLocalHost()
+{
+	static OfxPropertySetStruct properties;
+	static OfxHost host = { nullptr, nullptr };
+	if (nullptr == host.host) {
+		properties.setString(kOfxPropName, 0, "MfxPlugins local host");
+		host.host = &properties;
+		host.fetchSuite = fetchSuite;
+	}
+	return &host;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Dynamic libraries
+
+static void *open_library(const std::string & path)
+{
+#ifdef _WIN32
+	return static_cast<void*>(LoadLibraryA(path.c_str()));
+#else
+	// Without a slash, dlopen would look in the system library paths only
+	std::string local_path = path.find('/') == std::string::npos ? "./" + path : path;
+	return dlopen(local_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void *find_symbol(void *handle, const char *name)
+{
+#ifdef _WIN32
+	return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(handle), name));
+#else
+	return dlsym(handle, name);
+#endif
+}
+
+static void close_library(void *handle)
+{
+#ifdef _WIN32
+	FreeLibrary(static_cast<HMODULE>(handle));
+#else
+	dlclose(handle);
+#endif
+}
+
+static std::string library_error()
+{
+#ifdef _WIN32
+	return "error code " + std::to_string(GetLastError());
+#else
+	const char *message = dlerror();
+	return nullptr == message ? "unknown error" : message;
+#endif
+}
+
+static bool succeeded(OfxStatus status)
+{
+	return status == kOfxStatOK || status == kOfxStatReplyDefault;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PluginLibrary
+
+PluginLibrary::PluginLibrary(const std::string & path)
+	: m_path(path)
+	, m_handle(open_library(path))
+{
+	if (nullptr == m_handle) {
+		throw std::runtime_error("Could not load plugin library '" + path + "': " + library_error());
+	}
+
+	auto getNumberOfPlugins = reinterpret_cast<OfxGetNumberOfPluginsFunc>(find_symbol(m_handle, "OfxGetNumberOfPlugins"));
+	auto getPlugin = reinterpret_cast<OfxGetPluginFunc>(find_symbol(m_handle, "OfxGetPlugin"));
+	if (nullptr == getNumberOfPlugins || nullptr == getPlugin) {
+		close_library(m_handle);
+		throw std::runtime_error("'" + path + "' is not an OpenFX plugin library");
+	}
+
+	int count = getNumberOfPlugins();
+	for (int i = 0; i < count; ++i) {
+		OfxPlugin *plugin = getPlugin(i);
+		if (nullptr == plugin || 0 != strcmp(plugin->pluginApi, kOfxMeshEffectPluginApi)) {
+			// Not a mesh effect, not something this host can run
+			continue;
+		}
+		plugin->setHost(getLocalHost());
+		m_plugins.push_back(plugin);
+	}
+	m_descriptors.resize(m_plugins.size());
+}
+
+PluginLibrary::~PluginLibrary()
+{
+	for (size_t i = 0; i < m_plugins.size(); ++i) {
+		if (m_descriptors[i]) {
+			m_plugins[i]->mainEntry(kOfxActionUnload, nullptr, nullptr, nullptr);
+		}
+	}
+	m_descriptors.clear();
+	close_library(m_handle);
+}
+
+int PluginLibrary::findPlugin(const std::string & identifier) const
+{
+	for (int i = 0; i < pluginCount(); ++i) {
+		if (identifier == m_plugins[i]->pluginIdentifier) return i;
+	}
+	return -1;
+}
+
+const OfxMeshEffectStruct & PluginLibrary::descriptor(int index)
+{
+	if (index < 0 || index >= pluginCount()) {
+		throw std::runtime_error("Invalid plugin index " + std::to_string(index) + " in '" + m_path + "'");
+	}
+	if (!m_descriptors[index]) {
+		OfxPlugin *plugin = m_plugins[index];
+		if (!succeeded(plugin->mainEntry(kOfxActionLoad, nullptr, nullptr, nullptr))) {
+			throw std::runtime_error(std::string("Could not load plugin ") + plugin->pluginIdentifier);
+		}
+		std::unique_ptr<OfxMeshEffectStruct> descriptor(new OfxMeshEffectStruct);
+		if (!succeeded(plugin->mainEntry(kOfxActionDescribe, descriptor.get(), nullptr, nullptr))) {
+			plugin->mainEntry(kOfxActionUnload, nullptr, nullptr, nullptr);
+			throw std::runtime_error(std::string("Could not describe plugin ") + plugin->pluginIdentifier);
+		}
+		m_descriptors[index] = std::move(descriptor);
+	}
+	return *m_descriptors[index];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// EffectInstance
+
+EffectInstance::EffectInstance(PluginLibrary & library, int plugin_index)
+	: m_plugin(nullptr)
+{
+	m_instance.copyDescriptor(library.descriptor(plugin_index));
+	m_plugin = library.plugin(plugin_index);
+	if (!succeeded(m_plugin->mainEntry(kOfxActionCreateInstance, &m_instance, nullptr, nullptr))) {
+		throw std::runtime_error(std::string("Could not create an instance of ") + m_plugin->pluginIdentifier);
+	}
+}
+
+EffectInstance::~EffectInstance()
+{
+	m_plugin->mainEntry(kOfxActionDestroyInstance, &m_instance, nullptr, nullptr);
+}
+
+OfxMeshStruct & EffectInstance::inputMesh(const char *name)
+{
+	OfxMeshInputStruct *input = m_instance.findInput(name);
+	if (nullptr == input) {
+		throw std::runtime_error(std::string("Effect ") + m_plugin->pluginIdentifier + " has no input " + name);
+	}
+	return input->mesh;
+}
+
+const OfxMeshStruct & EffectInstance::outputMesh() const
+{
+	OfxMeshInputStruct *output = m_instance.findInput(kOfxMeshMainOutput);
+	if (nullptr == output) {
+		throw std::runtime_error(std::string("Effect ") + m_plugin->pluginIdentifier + " has no output");
+	}
+	return output->mesh;
+}
+
+bool EffectInstance::setParam(const char *name, const std::vector<double> & values)
+{
+	OfxParamStruct *param = m_instance.param_set.find(name);
+	if (nullptr == param || param->values.size() != values.size()) return false;
+	param->values = values;
+	return true;
+}
+
+bool EffectInstance::setStringParam(const char *name, const std::string & value)
+{
+	OfxParamStruct *param = m_instance.param_set.find(name);
+	if (nullptr == param || param->type != kOfxParamTypeString) return false;
+	param->string_value = value;
+	return true;
+}
+
+OfxStatus EffectInstance::cook()
+{
+	return m_plugin->mainEntry(kOfxMeshEffectActionCook, &m_instance, nullptr, nullptr);
+}
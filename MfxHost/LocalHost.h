@@ -0,0 +1,114 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "MeshEffect.h"
+
+#include <ofxCore.h>
+#include <ofxMeshEffect.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal OpenMfx host running plugins in the current process, without any
+ * DCC. It implements the property, parameter and mesh effect suites, keeps
+ * meshes in plain buffers and lets the caller feed inputs without copy. It is
+ * meant for benchmarks and command line tools, so parameters are not animated
+ * and there is no UI related behavior.
+ */
+
+/**
+ * The OfxHost handed to the plugins
+ */
+OfxHost *getLocalHost();
+
+/**
+ * A loaded .ofx binary. Errors are reported as std::runtime_error.
+ * Effect instances created from it must be destroyed before it is.
+ */
+class PluginLibrary {
+public:
+	explicit PluginLibrary(const std::string & path);
+	~PluginLibrary();
+	PluginLibrary(const PluginLibrary &) = delete;
+	PluginLibrary & operator=(const PluginLibrary &) = delete;
+
+	const std::string & path() const { return m_path; }
+	int pluginCount() const { return static_cast<int>(m_plugins.size()); }
+	OfxPlugin *plugin(int index) const { return m_plugins[index]; }
+
+	/**
+	 * Index of the plugin with the given identifier, or -1
+	 */
+	int findPlugin(const std::string & identifier) const;
+
+	/**
+	 * Descriptor of a plugin, loading and describing it on first call
+	 */
+	const OfxMeshEffectStruct & descriptor(int index);
+
+private:
+	std::string m_path;
+	void *m_handle;
+	std::vector<OfxPlugin*> m_plugins;
+	// Null until the plugin is loaded and described
+	std::vector<std::unique_ptr<OfxMeshEffectStruct>> m_descriptors;
+};
+
+/**
+ * An instance of one of the effects of a PluginLibrary. Input meshes are
+ * set up by the caller, typically pointing attributes to its own buffers,
+ * and the output mesh stays readable after cook() until the next cook.
+ */
+class EffectInstance {
+public:
+	EffectInstance(PluginLibrary & library, int plugin_index);
+	~EffectInstance();
+	EffectInstance(const EffectInstance &) = delete;
+	EffectInstance & operator=(const EffectInstance &) = delete;
+
+	/**
+	 * Mesh of the input called name, throws if the effect has no such input
+	 */
+	OfxMeshStruct & inputMesh(const char *name = kOfxMeshMainInput);
+	const OfxMeshStruct & outputMesh() const;
+
+	/**
+	 * Set the value of a parameter, returns false if there is no parameter
+	 * with this name and a matching number of components.
+	 */
+	bool setParam(const char *name, const std::vector<double> & values);
+	bool setStringParam(const char *name, const std::string & value);
+
+	OfxStatus cook();
+
+	OfxMeshEffectStruct & handle() { return m_instance; }
+
+private:
+	OfxPlugin *m_plugin;
+	OfxMeshEffectStruct m_instance;
+};
@@ -0,0 +1,562 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "MeshEffect.h"
+
+#include <cstdarg>
+#include <cstring>
+
+///////////////////////////////////////////////////////////////////////////////
+// Parameters
+
+int OfxParamStruct::componentCount(const std::string & type)
+{
+	if (type == kOfxParamTypeInteger || type == kOfxParamTypeDouble ||
+		type == kOfxParamTypeBoolean || type == kOfxParamTypeChoice) {
+		return 1;
+	}
+	if (type == kOfxParamTypeInteger2D || type == kOfxParamTypeDouble2D) {
+		return 2;
+	}
+	if (type == kOfxParamTypeInteger3D || type == kOfxParamTypeDouble3D || type == kOfxParamTypeRGB) {
+		return 3;
+	}
+	if (type == kOfxParamTypeRGBA) {
+		return 4;
+	}
+	return 0;
+}
+
+void OfxParamStruct::resetToDefault()
+{
+	values.resize(componentCount(type));
+	for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+		values[i] = properties.number(kOfxParamPropDefault, i);
+	}
+	if (type == kOfxParamTypeString) {
+		string_value = properties.string(kOfxParamPropDefault);
+	}
+}
+
+static bool is_integer_param(const std::string & type)
+{
+	return
+		type == kOfxParamTypeInteger ||
+		type == kOfxParamTypeInteger2D ||
+		type == kOfxParamTypeInteger3D ||
+		type == kOfxParamTypeBoolean ||
+		type == kOfxParamTypeChoice;
+}
+
+OfxParamStruct *OfxParamSetStruct::find(const char *name) const
+{
+	for (const auto & param : params) {
+		if (param->name == name) return param.get();
+	}
+	return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Meshes
+
+int attributeTypeSize(const char *type)
+{
+	if (0 == strcmp(type, kOfxMeshAttribTypeUByte)) return 1;
+	if (0 == strcmp(type, kOfxMeshAttribTypeInt)) return static_cast<int>(sizeof(int));
+	if (0 == strcmp(type, kOfxMeshAttribTypeFloat)) return static_cast<int>(sizeof(float));
+	return 0;
+}
+
+int findConstantFaceSize(const int *face_sizes, int face_count)
+{
+	if (face_count == 0 || face_sizes[0] <= 0) return -1;
+	for (int f = 1; f < face_count; ++f) {
+		if (face_sizes[f] != face_sizes[0]) return -1;
+	}
+	return face_sizes[0];
+}
+
+host_attribute_t *OfxMeshStruct::findAttribute(const char *attachment, const char *name) const
+{
+	for (const auto & attribute : attributes) {
+		if (attribute->attachment == attachment && attribute->name == name) {
+			return attribute.get();
+		}
+	}
+	return nullptr;
+}
+
+host_attribute_t *OfxMeshStruct::defineAttribute(const char *attachment, const char *name, int component_count, const char *type, const char *semantic)
+{
+	host_attribute_t *attribute = findAttribute(attachment, name);
+	if (nullptr != attribute) {
+		bool same_layout =
+			attribute->integer(kOfxMeshAttribPropComponentCount) == component_count &&
+			0 == strcmp(attribute->string(kOfxMeshAttribPropType), type);
+		return same_layout ? attribute : nullptr;
+	}
+
+	attributes.emplace_back(new host_attribute_t);
+	attribute = attributes.back().get();
+	attribute->attachment = attachment;
+	attribute->name = name;
+	attribute->setInt(kOfxMeshAttribPropComponentCount, 0, component_count);
+	attribute->setString(kOfxMeshAttribPropType, 0, type);
+	if (nullptr != semantic) {
+		attribute->setString(kOfxMeshAttribPropSemantic, 0, semantic);
+	}
+	attribute->setPointer(kOfxMeshAttribPropData, 0, nullptr);
+	attribute->setInt(kOfxMeshAttribPropStride, 0, 0);
+	attribute->setInt(kOfxMeshAttribPropIsOwner, 0, 1);
+	properties.setInt(kOfxMeshPropAttributeCount, 0, static_cast<int>(attributes.size()));
+	return attribute;
+}
+
+void OfxMeshStruct::setAttributeData(host_attribute_t *attribute, void *data, int stride)
+{
+	attribute->buffer.reset();
+	attribute->setPointer(kOfxMeshAttribPropData, 0, data);
+	attribute->setInt(kOfxMeshAttribPropStride, 0, stride);
+	attribute->setInt(kOfxMeshAttribPropIsOwner, 0, 0);
+}
+
+void OfxMeshStruct::setCounts(int point_count, int corner_count, int face_count, bool no_loose_edge, int constant_face_size)
+{
+	properties.setInt(kOfxMeshPropPointCount, 0, point_count);
+	properties.setInt(kOfxMeshPropCornerCount, 0, corner_count);
+	properties.setInt(kOfxMeshPropFaceCount, 0, face_count);
+	properties.setInt(kOfxMeshPropNoLooseEdge, 0, no_loose_edge ? 1 : 0);
+	properties.setInt(kOfxMeshPropConstantFaceSize, 0, constant_face_size);
+}
+
+int OfxMeshStruct::elementCount(const std::string & attachment) const
+{
+	if (attachment == kOfxMeshAttribPoint) return pointCount();
+	if (attachment == kOfxMeshAttribCorner) return cornerCount();
+	if (attachment == kOfxMeshAttribFace) return faceCount();
+	if (attachment == kOfxMeshAttribMesh) return 1;
+	return 0;
+}
+
+OfxStatus OfxMeshStruct::allocate()
+{
+	bool constant_face_size = properties.integer(kOfxMeshPropConstantFaceSize, 0, -1) > 0;
+	for (const auto & attribute : attributes) {
+		if (!attribute->integer(kOfxMeshAttribPropIsOwner)) continue;
+		if (nullptr != attribute->pointer(kOfxMeshAttribPropData)) continue;
+		// Faces of constant size are not given a size each
+		if (constant_face_size && attribute->attachment == kOfxMeshAttribFace && attribute->name == kOfxMeshAttribFaceSize) continue;
+
+		int component_size = attributeTypeSize(attribute->string(kOfxMeshAttribPropType));
+		int stride = attribute->integer(kOfxMeshAttribPropComponentCount) * component_size;
+		if (stride <= 0) return kOfxStatErrValue;
+		size_t byte_count = static_cast<size_t>(stride) * elementCount(attribute->attachment);
+
+		// Left uninitialized, plugins are expected to write every element
+		attribute->buffer.reset(new (std::nothrow) char[byte_count == 0 ? 1 : byte_count]);
+		if (nullptr == attribute->buffer) return kOfxStatErrMemory;
+		attribute->setPointer(kOfxMeshAttribPropData, 0, attribute->buffer.get());
+		attribute->setInt(kOfxMeshAttribPropStride, 0, stride);
+	}
+	return kOfxStatOK;
+}
+
+void OfxMeshStruct::reset()
+{
+	attributes.clear();
+	properties.clear();
+	properties.setInt(kOfxMeshPropAttributeCount, 0, 0);
+	setCounts(0, 0, 0);
+#ifdef kOfxMeshPropTransformMatrix
+	properties.setPointer(kOfxMeshPropTransformMatrix, 0, nullptr);
+#endif // kOfxMeshPropTransformMatrix
+	defineAttribute(kOfxMeshAttribPoint, kOfxMeshAttribPointPosition, 3, kOfxMeshAttribTypeFloat, nullptr);
+	defineAttribute(kOfxMeshAttribCorner, kOfxMeshAttribCornerPoint, 1, kOfxMeshAttribTypeInt, nullptr);
+	defineAttribute(kOfxMeshAttribFace, kOfxMeshAttribFaceSize, 1, kOfxMeshAttribTypeInt, nullptr);
+}
+
+void OfxMeshStruct::shareFrom(const OfxMeshStruct & source)
+{
+	reset();
+	setCounts(
+		source.pointCount(), source.cornerCount(), source.faceCount(),
+		source.properties.integer(kOfxMeshPropNoLooseEdge, 0, 1) != 0,
+		source.properties.integer(kOfxMeshPropConstantFaceSize, 0, -1));
+	for (const auto & attribute : source.attributes) {
+		host_attribute_t *copy = defineAttribute(
+			attribute->attachment.c_str(),
+			attribute->name.c_str(),
+			attribute->integer(kOfxMeshAttribPropComponentCount),
+			attribute->string(kOfxMeshAttribPropType),
+			attribute->has(kOfxMeshAttribPropSemantic) ? attribute->string(kOfxMeshAttribPropSemantic) : nullptr);
+		if (nullptr == copy) continue;
+		setAttributeData(copy, attribute->pointer(kOfxMeshAttribPropData), attribute->integer(kOfxMeshAttribPropStride));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Effects
+
+OfxMeshInputStruct *OfxMeshEffectStruct::findInput(const char *name) const
+{
+	for (const auto & input : inputs) {
+		if (input->name == name) return input.get();
+	}
+	return nullptr;
+}
+
+void OfxMeshEffectStruct::copyDescriptor(const OfxMeshEffectStruct & descriptor)
+{
+	properties = descriptor.properties;
+
+	inputs.clear();
+	for (const auto & descriptor_input : descriptor.inputs) {
+		inputs.emplace_back(new OfxMeshInputStruct);
+		OfxMeshInputStruct & input = *inputs.back();
+		input.name = descriptor_input->name;
+		input.properties = descriptor_input->properties;
+		input.requested_attributes = descriptor_input->requested_attributes;
+		input.mesh.reset();
+	}
+
+	param_set.properties = descriptor.param_set.properties;
+	param_set.params.clear();
+	for (const auto & descriptor_param : descriptor.param_set.params) {
+		param_set.params.emplace_back(new OfxParamStruct);
+		OfxParamStruct & param = *param_set.params.back();
+		param.name = descriptor_param->name;
+		param.type = descriptor_param->type;
+		param.properties = descriptor_param->properties;
+		param.resetToDefault();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Parameter suite
+
+static OfxStatus paramDefine(OfxParamSetHandle paramSet, const char *paramType, const char *name, OfxPropertySetHandle *propertySet)
+{
+	if (nullptr == paramSet) return kOfxStatErrBadHandle;
+	if (nullptr != paramSet->find(name)) return kOfxStatErrExists;
+
+	paramSet->params.emplace_back(new OfxParamStruct);
+	OfxParamStruct *param = paramSet->params.back().get();
+	param->name = name;
+	param->type = paramType;
+	param->properties.setString(kOfxParamPropType, 0, paramType);
+	param->resetToDefault();
+	if (nullptr != propertySet) {
+		*propertySet = &param->properties;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus paramGetHandle(OfxParamSetHandle paramSet, const char *name, OfxParamHandle *param, OfxPropertySetHandle *propertySet)
+{
+	if (nullptr == paramSet) return kOfxStatErrBadHandle;
+	OfxParamStruct *found = paramSet->find(name);
+	if (nullptr == found) return kOfxStatErrUnknown;
+	*param = found;
+	if (nullptr != propertySet) {
+		*propertySet = &found->properties;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus paramSetGetPropertySet(OfxParamSetHandle paramSet, OfxPropertySetHandle *propHandle)
+{
+	if (nullptr == paramSet) return kOfxStatErrBadHandle;
+	*propHandle = &paramSet->properties;
+	return kOfxStatOK;
+}
+
+static OfxStatus paramGetPropertySet(OfxParamHandle param, OfxPropertySetHandle *propHandle)
+{
+	if (nullptr == param) return kOfxStatErrBadHandle;
+	*propHandle = &param->properties;
+	return kOfxStatOK;
+}
+
+/**
+ * Write the value of param to the pointers of args, whose types depend on the
+ * type of the parameter as specified by the OpenFX parameter suite.
+ */
+static OfxStatus get_param_value(OfxParamHandle param, va_list args)
+{
+	if (nullptr == param) return kOfxStatErrBadHandle;
+	if (param->type == kOfxParamTypeString) {
+		*va_arg(args, const char**) = param->string_value.c_str();
+		return kOfxStatOK;
+	}
+	if (param->values.empty()) return kOfxStatErrUnsupported;
+	bool is_integer = is_integer_param(param->type);
+	for (double value : param->values) {
+		if (is_integer) {
+			*va_arg(args, int*) = static_cast<int>(value);
+		} else {
+			*va_arg(args, double*) = value;
+		}
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus set_param_value(OfxParamHandle param, va_list args)
+{
+	if (nullptr == param) return kOfxStatErrBadHandle;
+	if (param->type == kOfxParamTypeString) {
+		const char *value = va_arg(args, const char*);
+		param->string_value = nullptr == value ? "" : value;
+		return kOfxStatOK;
+	}
+	if (param->values.empty()) return kOfxStatErrUnsupported;
+	bool is_integer = is_integer_param(param->type);
+	for (double & value : param->values) {
+		value = is_integer ? static_cast<double>(va_arg(args, int)) : va_arg(args, double);
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus paramGetValue(OfxParamHandle paramHandle, ...)
+{
+	va_list args;
+	va_start(args, paramHandle);
+	OfxStatus status = get_param_value(paramHandle, args);
+	va_end(args);
+	return status;
+}
+
+static OfxStatus paramGetValueAtTime(OfxParamHandle paramHandle, OfxTime time, ...)
+{
+	// Parameters are not animated in the local host
+	va_list args;
+	va_start(args, time);
+	OfxStatus status = get_param_value(paramHandle, args);
+	va_end(args);
+	return status;
+}
+
+static OfxStatus paramSetValue(OfxParamHandle paramHandle, ...)
+{
+	va_list args;
+	va_start(args, paramHandle);
+	OfxStatus status = set_param_value(paramHandle, args);
+	va_end(args);
+	return status;
+}
+
+static OfxStatus paramSetValueAtTime(OfxParamHandle paramHandle, OfxTime time, ...)
+{
+	va_list args;
+	va_start(args, time);
+	OfxStatus status = set_param_value(paramHandle, args);
+	va_end(args);
+	return status;
+}
+
+static OfxStatus paramGetNumKeys(OfxParamHandle paramHandle, unsigned int *numberOfKeys)
+{
+	*numberOfKeys = 0;
+	return kOfxStatOK;
+}
+
+static OfxStatus paramEditBegin(OfxParamSetHandle paramSet, const char *name)
+{
+	return kOfxStatOK;
+}
+
+static OfxStatus paramEditEnd(OfxParamSetHandle paramSet)
+{
+	return kOfxStatOK;
+}
+
+const OfxParameterSuiteV1 *getParameterSuite()
+{
+	static const OfxParameterSuiteV1 suite = [] {
+		// Animation related entries are left null
+		OfxParameterSuiteV1 s = {};
+		s.paramDefine = paramDefine;
+		s.paramGetHandle = paramGetHandle;
+		s.paramSetGetPropertySet = paramSetGetPropertySet;
+		s.paramGetPropertySet = paramGetPropertySet;
+		s.paramGetValue = paramGetValue;
+		s.paramGetValueAtTime = paramGetValueAtTime;
+		s.paramSetValue = paramSetValue;
+		s.paramSetValueAtTime = paramSetValueAtTime;
+		s.paramGetNumKeys = paramGetNumKeys;
+		s.paramEditBegin = paramEditBegin;
+		s.paramEditEnd = paramEditEnd;
+		return s;
+	}();
+	return &suite;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Mesh effect suite
+
+static OfxStatus getPropertySet(OfxMeshEffectHandle meshEffect, OfxPropertySetHandle *propHandle)
+{
+	if (nullptr == meshEffect) return kOfxStatErrBadHandle;
+	*propHandle = &meshEffect->properties;
+	return kOfxStatOK;
+}
+
+static OfxStatus getParamSet(OfxMeshEffectHandle meshEffect, OfxParamSetHandle *paramSet)
+{
+	if (nullptr == meshEffect) return kOfxStatErrBadHandle;
+	*paramSet = &meshEffect->param_set;
+	return kOfxStatOK;
+}
+
+static OfxStatus inputDefine(OfxMeshEffectHandle meshEffect, const char *name, OfxMeshInputHandle *input, OfxPropertySetHandle *propertySet)
+{
+	if (nullptr == meshEffect) return kOfxStatErrBadHandle;
+	OfxMeshInputStruct *found = meshEffect->findInput(name);
+	if (nullptr == found) {
+		meshEffect->inputs.emplace_back(new OfxMeshInputStruct);
+		found = meshEffect->inputs.back().get();
+		found->name = name;
+		found->mesh.reset();
+	}
+	if (nullptr != input) *input = found;
+	if (nullptr != propertySet) *propertySet = &found->properties;
+	return kOfxStatOK;
+}
+
+static OfxStatus inputGetHandle(OfxMeshEffectHandle meshEffect, const char *name, OfxMeshInputHandle *input, OfxPropertySetHandle *propertySet)
+{
+	if (nullptr == meshEffect) return kOfxStatErrBadHandle;
+	OfxMeshInputStruct *found = meshEffect->findInput(name);
+	if (nullptr == found) return kOfxStatErrUnknown;
+	*input = found;
+	if (nullptr != propertySet) *propertySet = &found->properties;
+	return kOfxStatOK;
+}
+
+static OfxStatus inputGetPropertySet(OfxMeshInputHandle input, OfxPropertySetHandle *propHandle)
+{
+	if (nullptr == input) return kOfxStatErrBadHandle;
+	*propHandle = &input->properties;
+	return kOfxStatOK;
+}
+
+static OfxStatus inputRequestAttribute(OfxMeshInputHandle input, const char *attachment, const char *name, int componentCount, const char *type, const char *semantic, int mandatory)
+{
+	if (nullptr == input) return kOfxStatErrBadHandle;
+	input->requested_attributes.push_back(attribute_request_t{
+		attachment,
+		name,
+		componentCount,
+		type,
+		nullptr == semantic ? "" : semantic,
+		mandatory != 0
+	});
+	return kOfxStatOK;
+}
+
+static OfxStatus inputGetMesh(OfxMeshInputHandle input, OfxTime time, OfxMeshHandle *meshHandle, OfxPropertySetHandle *propertySet)
+{
+	if (nullptr == input) return kOfxStatErrBadHandle;
+	if (input->isOutput()) {
+		// Outputs start empty at each cook
+		input->mesh.reset();
+	}
+	*meshHandle = &input->mesh;
+	if (nullptr != propertySet) *propertySet = &input->mesh.properties;
+	return kOfxStatOK;
+}
+
+static OfxStatus inputReleaseMesh(OfxMeshHandle meshHandle)
+{
+	// Meshes are owned by their input and stay valid for the host to read
+	// the output back after the cook
+	return nullptr == meshHandle ? kOfxStatErrBadHandle : kOfxStatOK;
+}
+
+static OfxStatus attributeDefine(OfxMeshHandle meshHandle, const char *attachment, const char *name, int componentCount, const char *type, const char *semantic, OfxPropertySetHandle *attributeHandle)
+{
+	if (nullptr == meshHandle) return kOfxStatErrBadHandle;
+	if (componentCount < 1 || componentCount > 4 || 0 == attributeTypeSize(type)) return kOfxStatErrValue;
+	host_attribute_t *attribute = meshHandle->defineAttribute(attachment, name, componentCount, type, semantic);
+	if (nullptr == attribute) return kOfxStatErrExists;
+	if (nullptr != attributeHandle) *attributeHandle = attribute;
+	return kOfxStatOK;
+}
+
+static OfxStatus meshGetAttributeByIndex(OfxMeshHandle meshHandle, int index, OfxPropertySetHandle *attributeHandle)
+{
+	if (nullptr == meshHandle) return kOfxStatErrBadHandle;
+	if (index < 0 || index >= static_cast<int>(meshHandle->attributes.size())) return kOfxStatErrBadIndex;
+	*attributeHandle = meshHandle->attributes[index].get();
+	return kOfxStatOK;
+}
+
+static OfxStatus meshGetAttribute(OfxMeshHandle meshHandle, const char *attachment, const char *name, OfxPropertySetHandle *attributeHandle)
+{
+	if (nullptr == meshHandle) return kOfxStatErrBadHandle;
+	host_attribute_t *attribute = meshHandle->findAttribute(attachment, name);
+	if (nullptr == attribute) return kOfxStatErrBadIndex;
+	*attributeHandle = attribute;
+	return kOfxStatOK;
+}
+
+static OfxStatus meshGetPropertySet(OfxMeshHandle mesh, OfxPropertySetHandle *propHandle)
+{
+	if (nullptr == mesh) return kOfxStatErrBadHandle;
+	*propHandle = &mesh->properties;
+	return kOfxStatOK;
+}
+
+static OfxStatus meshAlloc(OfxMeshHandle meshHandle)
+{
+	if (nullptr == meshHandle) return kOfxStatErrBadHandle;
+	return meshHandle->allocate();
+}
+
+static int meshEffectAbort(OfxMeshEffectHandle meshEffect)
+{
+	return nullptr != meshEffect && meshEffect->abort_requested ? 1 : 0;
+}
+
+const OfxMeshEffectSuiteV1 *getMeshEffectSuite()
+{
+	static const OfxMeshEffectSuiteV1 suite = [] {
+		OfxMeshEffectSuiteV1 s = {};
+		s.getPropertySet = getPropertySet;
+		s.getParamSet = getParamSet;
+		s.inputDefine = inputDefine;
+		s.inputGetHandle = inputGetHandle;
+		s.inputGetPropertySet = inputGetPropertySet;
+		s.inputRequestAttribute = inputRequestAttribute;
+		s.inputGetMesh = inputGetMesh;
+		s.inputReleaseMesh = inputReleaseMesh;
+		s.attributeDefine = attributeDefine;
+		s.meshGetAttributeByIndex = meshGetAttributeByIndex;
+		s.meshGetAttribute = meshGetAttribute;
+		s.meshGetPropertySet = meshGetPropertySet;
+		s.meshAlloc = meshAlloc;
+		s.abort = meshEffectAbort;
+		return s;
+	}();
+	return &suite;
+}
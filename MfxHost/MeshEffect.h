@@ -0,0 +1,181 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "PropertySet.h"
+
+#include <ofxCore.h>
+#include <ofxParam.h>
+#include <ofxMeshEffect.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Handles of the local host. They are plain structs owned by the host, the
+ * suites below only ever hand out pointers to them.
+ */
+
+struct OfxParamStruct {
+	std::string name;
+	std::string type;
+	OfxPropertySetStruct properties;
+	// Current value, one component per element (ints and booleans are
+	// stored as doubles, which is exact in their range)
+	std::vector<double> values;
+	std::string string_value;
+
+	/**
+	 * Number of components of a parameter of type type, 0 for types that do
+	 * not hold a numeric value
+	 */
+	static int componentCount(const std::string & type);
+
+	/**
+	 * Set the value from the kOfxParamPropDefault property
+	 */
+	void resetToDefault();
+};
+
+struct OfxParamSetStruct {
+	OfxPropertySetStruct properties;
+	std::vector<std::unique_ptr<OfxParamStruct>> params;
+
+	OfxParamStruct *find(const char *name) const;
+};
+
+/**
+ * Attribute handles are property sets, as in the OpenMfx API, so an attribute
+ * is a property set that also knows where it lives and owns its buffer when
+ * the host allocated it.
+ */
+struct host_attribute_t : public OfxPropertySetStruct {
+	std::string attachment;
+	std::string name;
+	std::unique_ptr<char[]> buffer;
+};
+
+struct OfxMeshStruct {
+	OfxPropertySetStruct properties;
+	std::vector<std::unique_ptr<host_attribute_t>> attributes;
+
+	host_attribute_t *findAttribute(const char *attachment, const char *name) const;
+
+	/**
+	 * Add an attribute, or return the existing one if it has the same
+	 * layout. Returns nullptr if an attribute with the same name but another
+	 * layout exists.
+	 */
+	host_attribute_t *defineAttribute(const char *attachment, const char *name, int component_count, const char *type, const char *semantic);
+
+	/**
+	 * Point an attribute to data owned by the caller
+	 */
+	void setAttributeData(host_attribute_t *attribute, void *data, int stride);
+
+	int pointCount() const { return properties.integer(kOfxMeshPropPointCount); }
+	int cornerCount() const { return properties.integer(kOfxMeshPropCornerCount); }
+	int faceCount() const { return properties.integer(kOfxMeshPropFaceCount); }
+
+	/**
+	 * Set element counts and default topology properties
+	 */
+	void setCounts(int point_count, int corner_count, int face_count, bool no_loose_edge = true, int constant_face_size = -1);
+
+	/**
+	 * Allocate a buffer for every attribute that the host owns and that has
+	 * none yet, sized after the current element counts.
+	 */
+	OfxStatus allocate();
+
+	/**
+	 * Drop all attributes and set up an empty mesh with the attributes that
+	 * every mesh must have.
+	 */
+	void reset();
+
+	/**
+	 * Reset to the counts and attributes of source, pointing to its buffers
+	 * without copy, e.g. to feed the output of an effect to another one.
+	 * Attributes whose layout conflicts with a mandatory one are skipped.
+	 */
+	void shareFrom(const OfxMeshStruct & source);
+
+	/**
+	 * Element count of the given attachment
+	 */
+	int elementCount(const std::string & attachment) const;
+};
+
+struct attribute_request_t {
+	std::string attachment;
+	std::string name;
+	int component_count;
+	std::string type;
+	std::string semantic;
+	bool mandatory;
+};
+
+struct OfxMeshInputStruct {
+	std::string name;
+	OfxPropertySetStruct properties;
+	std::vector<attribute_request_t> requested_attributes;
+	OfxMeshStruct mesh;
+
+	bool isOutput() const { return name == kOfxMeshMainOutput; }
+};
+
+struct OfxMeshEffectStruct {
+	OfxPropertySetStruct properties;
+	OfxParamSetStruct param_set;
+	std::vector<std::unique_ptr<OfxMeshInputStruct>> inputs;
+	// Polled by the abort function of the mesh effect suite, possibly from
+	// worker threads of the plugin while another thread sets it
+	std::atomic<bool> abort_requested{ false };
+
+	OfxMeshInputStruct *findInput(const char *name) const;
+
+	/**
+	 * Copy inputs and parameters of a descriptor, with parameter values set
+	 * to their defaults, to set up a new instance.
+	 */
+	void copyDescriptor(const OfxMeshEffectStruct & descriptor);
+};
+
+/**
+ * Byte size of one component of an attribute of the given type
+ */
+int attributeTypeSize(const char *type);
+
+/**
+ * Size shared by all faces, to tell plugins with kOfxMeshPropConstantFaceSize,
+ * or -1 if sizes differ
+ */
+int findConstantFaceSize(const int *face_sizes, int face_count);
+
+const OfxParameterSuiteV1 *getParameterSuite();
+const OfxMeshEffectSuiteV1 *getMeshEffectSuite();
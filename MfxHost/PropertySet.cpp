@@ -0,0 +1,350 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "PropertySet.h"
+
+static size_t dimension_of(const property_t & prop)
+{
+	switch (prop.type) {
+	case PropertyType::Pointer:
+		return prop.pointers.size();
+	case PropertyType::String:
+		return prop.strings.size();
+	case PropertyType::Double:
+		return prop.doubles.size();
+	case PropertyType::Int:
+		return prop.ints.size();
+	}
+	return 0;
+}
+
+property_t & OfxPropertySetStruct::ensure(const char *name, PropertyType type, int index)
+{
+	property_t & prop = m_properties[name];
+	if (dimension_of(prop) == 0 || prop.type != type) {
+		prop = property_t{};
+		prop.type = type;
+	}
+	size_t size = static_cast<size_t>(index) + 1;
+	switch (type) {
+	case PropertyType::Pointer:
+		if (prop.pointers.size() < size) prop.pointers.resize(size, nullptr);
+		break;
+	case PropertyType::String:
+		if (prop.strings.size() < size) prop.strings.resize(size);
+		break;
+	case PropertyType::Double:
+		if (prop.doubles.size() < size) prop.doubles.resize(size, 0.0);
+		break;
+	case PropertyType::Int:
+		if (prop.ints.size() < size) prop.ints.resize(size, 0);
+		break;
+	}
+	return prop;
+}
+
+void OfxPropertySetStruct::setPointer(const char *name, int index, void *value)
+{
+	ensure(name, PropertyType::Pointer, index).pointers[index] = value;
+}
+
+void OfxPropertySetStruct::setString(const char *name, int index, const char *value)
+{
+	ensure(name, PropertyType::String, index).strings[index] = value == nullptr ? "" : value;
+}
+
+void OfxPropertySetStruct::setDouble(const char *name, int index, double value)
+{
+	ensure(name, PropertyType::Double, index).doubles[index] = value;
+}
+
+void OfxPropertySetStruct::setInt(const char *name, int index, int value)
+{
+	ensure(name, PropertyType::Int, index).ints[index] = value;
+}
+
+OfxStatus OfxPropertySetStruct::getPointer(const char *name, int index, void **value) const
+{
+	auto it = m_properties.find(name);
+	if (it == m_properties.end()) return kOfxStatErrUnknown;
+	const property_t & prop = it->second;
+	if (prop.type != PropertyType::Pointer) return kOfxStatErrValue;
+	if (index < 0 || index >= static_cast<int>(prop.pointers.size())) return kOfxStatErrBadIndex;
+	*value = prop.pointers[index];
+	return kOfxStatOK;
+}
+
+OfxStatus OfxPropertySetStruct::getString(const char *name, int index, char **value) const
+{
+	auto it = m_properties.find(name);
+	if (it == m_properties.end()) return kOfxStatErrUnknown;
+	const property_t & prop = it->second;
+	if (prop.type != PropertyType::String) return kOfxStatErrValue;
+	if (index < 0 || index >= static_cast<int>(prop.strings.size())) return kOfxStatErrBadIndex;
+	// The suite hands out non const pointers, plugins must not write to them
+	*value = const_cast<char*>(prop.strings[index].c_str());
+	return kOfxStatOK;
+}
+
+OfxStatus OfxPropertySetStruct::getDouble(const char *name, int index, double *value) const
+{
+	auto it = m_properties.find(name);
+	if (it == m_properties.end()) return kOfxStatErrUnknown;
+	const property_t & prop = it->second;
+	if (index < 0 || index >= static_cast<int>(dimension_of(prop))) return kOfxStatErrBadIndex;
+	switch (prop.type) {
+	case PropertyType::Double:
+		*value = prop.doubles[index];
+		return kOfxStatOK;
+	case PropertyType::Int:
+		*value = static_cast<double>(prop.ints[index]);
+		return kOfxStatOK;
+	default:
+		return kOfxStatErrValue;
+	}
+}
+
+OfxStatus OfxPropertySetStruct::getInt(const char *name, int index, int *value) const
+{
+	auto it = m_properties.find(name);
+	if (it == m_properties.end()) return kOfxStatErrUnknown;
+	const property_t & prop = it->second;
+	if (index < 0 || index >= static_cast<int>(dimension_of(prop))) return kOfxStatErrBadIndex;
+	switch (prop.type) {
+	case PropertyType::Int:
+		*value = prop.ints[index];
+		return kOfxStatOK;
+	case PropertyType::Double:
+		*value = static_cast<int>(prop.doubles[index]);
+		return kOfxStatOK;
+	default:
+		return kOfxStatErrValue;
+	}
+}
+
+void *OfxPropertySetStruct::pointer(const char *name, int index, void *fallback) const
+{
+	void *value;
+	return getPointer(name, index, &value) == kOfxStatOK ? value : fallback;
+}
+
+const char *OfxPropertySetStruct::string(const char *name, int index, const char *fallback) const
+{
+	char *value;
+	return getString(name, index, &value) == kOfxStatOK ? value : fallback;
+}
+
+double OfxPropertySetStruct::number(const char *name, int index, double fallback) const
+{
+	double value;
+	return getDouble(name, index, &value) == kOfxStatOK ? value : fallback;
+}
+
+int OfxPropertySetStruct::integer(const char *name, int index, int fallback) const
+{
+	int value;
+	return getInt(name, index, &value) == kOfxStatOK ? value : fallback;
+}
+
+int OfxPropertySetStruct::dimension(const char *name) const
+{
+	auto it = m_properties.find(name);
+	return it == m_properties.end() ? 0 : static_cast<int>(dimension_of(it->second));
+}
+
+void OfxPropertySetStruct::reset(const char *name)
+{
+	m_properties.erase(name);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Property suite
+
+static OfxStatus propSetPointer(OfxPropertySetHandle properties, const char *property, int index, void *value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	if (index < 0) return kOfxStatErrBadIndex;
+	properties->setPointer(property, index, value);
+	return kOfxStatOK;
+}
+
+static OfxStatus propSetString(OfxPropertySetHandle properties, const char *property, int index, const char *value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	if (index < 0) return kOfxStatErrBadIndex;
+	properties->setString(property, index, value);
+	return kOfxStatOK;
+}
+
+static OfxStatus propSetDouble(OfxPropertySetHandle properties, const char *property, int index, double value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	if (index < 0) return kOfxStatErrBadIndex;
+	properties->setDouble(property, index, value);
+	return kOfxStatOK;
+}
+
+static OfxStatus propSetInt(OfxPropertySetHandle properties, const char *property, int index, int value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	if (index < 0) return kOfxStatErrBadIndex;
+	properties->setInt(property, index, value);
+	return kOfxStatOK;
+}
+
+static OfxStatus propSetPointerN(OfxPropertySetHandle properties, const char *property, int count, void *const*value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propSetPointer(properties, property, i, value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propSetStringN(OfxPropertySetHandle properties, const char *property, int count, const char *const*value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propSetString(properties, property, i, value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propSetDoubleN(OfxPropertySetHandle properties, const char *property, int count, const double *value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propSetDouble(properties, property, i, value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propSetIntN(OfxPropertySetHandle properties, const char *property, int count, const int *value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propSetInt(properties, property, i, value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propGetPointer(OfxPropertySetHandle properties, const char *property, int index, void **value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	return properties->getPointer(property, index, value);
+}
+
+static OfxStatus propGetString(OfxPropertySetHandle properties, const char *property, int index, char **value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	return properties->getString(property, index, value);
+}
+
+static OfxStatus propGetDouble(OfxPropertySetHandle properties, const char *property, int index, double *value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	return properties->getDouble(property, index, value);
+}
+
+static OfxStatus propGetInt(OfxPropertySetHandle properties, const char *property, int index, int *value)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	return properties->getInt(property, index, value);
+}
+
+static OfxStatus propGetPointerN(OfxPropertySetHandle properties, const char *property, int count, void **value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propGetPointer(properties, property, i, &value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propGetStringN(OfxPropertySetHandle properties, const char *property, int count, char **value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propGetString(properties, property, i, &value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propGetDoubleN(OfxPropertySetHandle properties, const char *property, int count, double *value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propGetDouble(properties, property, i, &value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propGetIntN(OfxPropertySetHandle properties, const char *property, int count, int *value)
+{
+	for (int i = 0; i < count; ++i) {
+		OfxStatus status = propGetInt(properties, property, i, &value[i]);
+		if (status != kOfxStatOK) return status;
+	}
+	return kOfxStatOK;
+}
+
+static OfxStatus propReset(OfxPropertySetHandle properties, const char *property)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	properties->reset(property);
+	return kOfxStatOK;
+}
+
+static OfxStatus propGetDimension(OfxPropertySetHandle properties, const char *property, int *count)
+{
+	if (properties == nullptr) return kOfxStatErrBadHandle;
+	if (!properties->has(property)) return kOfxStatErrUnknown;
+	*count = properties->dimension(property);
+	return kOfxStatOK;
+}
+
+const OfxPropertySuiteV1 *getPropertySuite()
+{
+	static const OfxPropertySuiteV1 suite = {
+		propSetPointer,
+		propSetString,
+		propSetDouble,
+		propSetInt,
+		propSetPointerN,
+		propSetStringN,
+		propSetDoubleN,
+		propSetIntN,
+		propGetPointer,
+		propGetString,
+		propGetDouble,
+		propGetInt,
+		propGetPointerN,
+		propGetStringN,
+		propGetDoubleN,
+		propGetIntN,
+		propReset,
+		propGetDimension,
+	};
+	return &suite;
+}
@@ -0,0 +1,93 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <ofxCore.h>
+#include <ofxProperty.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+enum class PropertyType {
+	Pointer,
+	String,
+	Double,
+	Int,
+};
+
+/**
+ * Values of a single property. Only the vector matching the type is used.
+ */
+struct property_t {
+	PropertyType type;
+	std::vector<void*> pointers;
+	std::vector<std::string> strings;
+	std::vector<double> doubles;
+	std::vector<int> ints;
+};
+
+/**
+ * Property set of the local host. Properties are created on first write, and
+ * numeric properties convert between int and double on read since plugins
+ * and hosts do not always agree on which one a property holds.
+ *
+ * Reading a property that has never been set returns kOfxStatErrUnknown, as
+ * required by the property suite, but the typed helpers used by the host
+ * itself fall back to a default value instead.
+ */
+struct OfxPropertySetStruct {
+public:
+	void setPointer(const char *name, int index, void *value);
+	void setString(const char *name, int index, const char *value);
+	void setDouble(const char *name, int index, double value);
+	void setInt(const char *name, int index, int value);
+
+	OfxStatus getPointer(const char *name, int index, void **value) const;
+	OfxStatus getString(const char *name, int index, char **value) const;
+	OfxStatus getDouble(const char *name, int index, double *value) const;
+	OfxStatus getInt(const char *name, int index, int *value) const;
+
+	void *pointer(const char *name, int index = 0, void *fallback = nullptr) const;
+	const char *string(const char *name, int index = 0, const char *fallback = "") const;
+	double number(const char *name, int index = 0, double fallback = 0.0) const;
+	int integer(const char *name, int index = 0, int fallback = 0) const;
+
+	bool has(const char *name) const { return m_properties.count(name) > 0; }
+	int dimension(const char *name) const;
+	void reset(const char *name);
+	void clear() { m_properties.clear(); }
+
+private:
+	property_t & ensure(const char *name, PropertyType type, int index);
+
+private:
+	std::map<std::string, property_t> m_properties;
+};
+
+/**
+ * Property suite of the local host, operating on OfxPropertySetStruct
+ */
+const OfxPropertySuiteV1 *getPropertySuite();
@@ -0,0 +1,150 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "AttributeGather.h"
+
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+// Gathers are split into tasks of this many elements, so that a few large
+// attributes and many small ones are balanced alike across threads
+static constexpr int kGatherBlock = 1 << 14;
+
+using gather_kernel_t = void (*)(const attribute_gather_t & g, int begin, int end);
+
+template <typename T>
+static inline T from_average(double value)
+{
+	if (std::is_floating_point<T>::value) return static_cast<T>(value);
+	return static_cast<T>(std::llround(value));
+}
+
+/**
+ * Gather of N components of type T, N being 0 when only known at runtime
+ */
+template <typename T, int N>
+static void gather_kernel(const attribute_gather_t & g, int begin, int end)
+{
+	AttributeView<const T, N> src(g.src, g.src_stride, g.src_count, g.component_count);
+	AttributeView<T, N> dst = AttributeView<T, N>(g.dst, g.dst_stride, g.count, g.component_count).slice(begin, end);
+	if (nullptr == g.sources) {
+		copyAttribute(src.slice(begin, end), dst, 1);
+	}
+	else {
+		gatherAttribute(src, dst, g.sources + begin, 1);
+	}
+}
+
+template <typename T, int N>
+static void average_kernel(const attribute_gather_t & g, int begin, int end)
+{
+	AttributeView<const T, N> src(g.src, g.src_stride, g.src_count, g.component_count);
+	AttributeView<T, N> dst(g.dst, g.dst_stride, g.count, g.component_count);
+
+	// Components of runtime sized elements are averaged by blocks
+	constexpr int kBlock = N > 0 ? N : 16;
+	const int component_count = src.componentCount();
+
+	for (int k0 = 0; k0 < component_count; k0 += kBlock) {
+		const int n = std::min(kBlock, component_count - k0);
+		for (int i = begin; i < end; ++i) {
+			int first = g.group_start[i], last = g.group_start[i + 1];
+			double sum[kBlock] = {};
+			for (int j = first; j < last; ++j) {
+				const T *value = src[g.group_elements[j]] + k0;
+				for (int k = 0; k < n; ++k) {
+					sum[k] += static_cast<double>(value[k]);
+				}
+			}
+			T *average = dst[i] + k0;
+			double weight = 1.0 / (last - first);
+			for (int k = 0; k < n; ++k) {
+				average[k] = from_average<T>(sum[k] * weight);
+			}
+		}
+	}
+}
+
+template <typename T>
+static gather_kernel_t select_typed_kernel(const attribute_gather_t & g)
+{
+	bool average = nullptr != g.group_start;
+	switch (g.component_count) {
+	case 1: return average ? average_kernel<T, 1> : gather_kernel<T, 1>;
+	case 2: return average ? average_kernel<T, 2> : gather_kernel<T, 2>;
+	case 3: return average ? average_kernel<T, 3> : gather_kernel<T, 3>;
+	case 4: return average ? average_kernel<T, 4> : gather_kernel<T, 4>;
+	default: return average ? average_kernel<T, 0> : gather_kernel<T, 0>;
+	}
+}
+
+static gather_kernel_t select_kernel(const attribute_gather_t & g)
+{
+	switch (g.type) {
+	case MfxAttributeType::UByte: return select_typed_kernel<uint8_t>(g);
+	case MfxAttributeType::Int: return select_typed_kernel<int32_t>(g);
+	case MfxAttributeType::Float: return select_typed_kernel<float>(g);
+	default: return nullptr;
+	}
+}
+
+int attributeComponentSize(MfxAttributeType type)
+{
+	switch (type) {
+	case MfxAttributeType::UByte: return sizeof(uint8_t);
+	case MfxAttributeType::Int: return sizeof(int32_t);
+	case MfxAttributeType::Float: return sizeof(float);
+	default: return 0;
+	}
+}
+
+void gatherAttributes(const std::vector<attribute_gather_t> & gathers, int thread_count)
+{
+	struct task_t {
+		gather_kernel_t kernel;
+		const attribute_gather_t *gather;
+		int begin;
+		int end;
+	};
+
+	std::vector<task_t> tasks;
+	for (const attribute_gather_t & g : gathers) {
+		gather_kernel_t kernel = select_kernel(g);
+		if (nullptr == kernel || g.component_count <= 0) continue;
+		for (int begin = 0; begin < g.count; begin += kGatherBlock) {
+			tasks.push_back(task_t{ kernel, &g, begin, std::min(begin + kGatherBlock, g.count) });
+		}
+	}
+
+	parallelFor(0, static_cast<int>(tasks.size()), 1, thread_count, [&](int b, int e) {
+		for (int t = b; t < e; ++t) {
+			tasks[t].kernel(*tasks[t].gather, tasks[t].begin, tasks[t].end);
+		}
+	});
+}
@@ -0,0 +1,62 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxEffect>
+
+#include <vector>
+
+/**
+ * Copy of an attribute from the input mesh to the output mesh, through a map
+ * from output elements to the input elements they come from
+ */
+struct attribute_gather_t {
+	MfxAttributeType type;
+	int component_count;
+	const char *src;
+	int src_stride;
+	int src_count; // number of input elements
+	char *dst;
+	int dst_stride;
+	int count; // number of output elements
+	// Input element of each output element, or nullptr for the identity
+	const int *sources;
+	// When not null, each output element is rather the average of input
+	// elements group_elements[group_start[i]:group_start[i+1]]
+	const int *group_start;
+	const int *group_elements;
+};
+
+/**
+ * Size in bytes of one component, or 0 for unknown types
+ */
+int attributeComponentSize(MfxAttributeType type);
+
+/**
+ * Run all gathers, in parallel over both attributes and element ranges. The
+ * kernels are specialized for each type and component count up to 4, so
+ * that gathers of packed attributes get vectorized.
+ */
+void gatherAttributes(const std::vector<attribute_gather_t> & gathers, int thread_count = 0);
@@ -0,0 +1,83 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "CookCache.h"
+
+CookCache::CookCache(size_t memory_cap)
+	: m_memory_cap(memory_cap)
+	, m_memory_usage(0)
+	, m_hit_count(0)
+	, m_miss_count(0)
+{}
+
+const cook_result_t *CookCache::find(const cook_key_t & key)
+{
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if (it->key == key) {
+			m_entries.splice(m_entries.begin(), m_entries, it);
+			++m_hit_count;
+			return &m_entries.front().result;
+		}
+	}
+	++m_miss_count;
+	return nullptr;
+}
+
+void CookCache::insert(const cook_key_t & key, cook_result_t && result)
+{
+	size_t size = result.memoryUsage();
+	if (size > m_memory_cap) return;
+
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if (it->key == key) {
+			m_memory_usage -= it->result.memoryUsage();
+			m_entries.erase(it);
+			break;
+		}
+	}
+
+	m_entries.push_front(entry_t{ key, std::move(result) });
+	m_memory_usage += size;
+	evict();
+}
+
+void CookCache::setMemoryCap(size_t memory_cap)
+{
+	m_memory_cap = memory_cap;
+	evict();
+}
+
+void CookCache::clear()
+{
+	m_entries.clear();
+	m_memory_usage = 0;
+}
+
+void CookCache::evict()
+{
+	while (m_memory_usage > m_memory_cap && !m_entries.empty()) {
+		m_memory_usage -= m_entries.back().result.memoryUsage();
+		m_entries.pop_back();
+	}
+}
@@ -0,0 +1,154 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxEffect>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+/**
+ * Identifies the input of a cook: a hash of the input buffers together
+ * with the element counts and the parameters that affect the result.
+ */
+struct cook_key_t {
+	uint64_t hash;
+	int point_count;
+	int corner_count;
+	int face_count;
+	float threshold;
+	int point_merge;
+	int output_order;
+	// With a spatial output order, the numbering of the output points
+	// follows the search structure: the backend asked for, which resolves
+	// the same way for the same input, and the tile size, 0 when not tiled
+	int backend;
+	int tile_points;
+
+	bool operator==(const cook_key_t & other) const {
+		return hash == other.hash
+			&& point_count == other.point_count
+			&& corner_count == other.corner_count
+			&& face_count == other.face_count
+			&& threshold == other.threshold
+			&& point_merge == other.point_merge
+			&& output_order == other.output_order
+			&& backend == other.backend
+			&& tile_points == other.tile_points;
+	}
+};
+
+/**
+ * Attribute of a cached output other than position, corner point and face
+ * size, packed
+ */
+struct cached_attribute_t {
+	MfxAttributeAttachment attachment;
+	std::string name;
+	MfxAttributeType type;
+	int component_count;
+	MfxAttributeSemantic semantic;
+	std::vector<char> data;
+};
+
+/**
+ * Output mesh of a cook, packed
+ */
+struct cook_result_t {
+	std::vector<float> positions; // 3 floats per point
+	std::vector<int> corner_points;
+	std::vector<int> face_sizes; // empty if faces have a constant size
+	int face_count = 0;
+	int constant_face_size = -1;
+	std::vector<cached_attribute_t> attributes;
+
+	int pointCount() const { return static_cast<int>(positions.size() / 3); }
+	int cornerCount() const { return static_cast<int>(corner_points.size()); }
+	int faceCount() const { return face_count; }
+
+	size_t memoryUsage() const {
+		size_t size = positions.capacity() * sizeof(float)
+			+ (corner_points.capacity() + face_sizes.capacity()) * sizeof(int);
+		for (const cached_attribute_t & attribute : attributes) {
+			size += attribute.data.capacity() + attribute.name.capacity();
+		}
+		return size;
+	}
+};
+
+/**
+ * Recently cooked results of an effect instance, so that cooking again the
+ * same input, as hosts do on a viewport refresh or an upstream change that
+ * did not affect this effect, only copies the stored output. Results are
+ * evicted least recently used first once their total size exceeds the
+ * memory cap.
+ */
+class CookCache {
+public:
+	explicit CookCache(size_t memory_cap = kDefaultMemoryCap);
+
+	/**
+	 * Result cooked from key, or nullptr. A hit makes the entry the most
+	 * recently used one. The pointer is valid until the next insertion.
+	 */
+	const cook_result_t *find(const cook_key_t & key);
+
+	/**
+	 * Store the result cooked from key, unless it is larger than the whole
+	 * memory cap.
+	 */
+	void insert(const cook_key_t & key, cook_result_t && result);
+
+	void setMemoryCap(size_t memory_cap);
+	void clear();
+
+	int64_t hitCount() const { return m_hit_count; }
+	int64_t missCount() const { return m_miss_count; }
+	size_t memoryUsage() const { return m_memory_usage; }
+	int entryCount() const { return static_cast<int>(m_entries.size()); }
+
+public:
+	static constexpr size_t kDefaultMemoryCap = size_t(256) << 20;
+
+private:
+	struct entry_t {
+		cook_key_t key;
+		cook_result_t result;
+	};
+
+	void evict();
+
+private:
+	// Most recently used first. Few results fit in memory, so a list is
+	// searched faster than a map would be maintained.
+	std::list<entry_t> m_entries;
+	size_t m_memory_cap;
+	size_t m_memory_usage;
+	int64_t m_hit_count;
+	int64_t m_miss_count;
+};
@@ -22,170 +22,677 @@
  * in the Software.
  */
 
-#include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
 #include "KDTree.h"
+#include "MergeKernels.h"
+#include "UnionFind.h"
 
-// Core code is from https://rosettacode.org/wiki/K-d_tree
-// It is actually very buggy, I should look for another one.
-// The tree is not well built when there are several points with the exact same
-// coordinate on one axis, because it uses the value to recognize the point
-// The 'equivalent' functino is my own, and is buggy as well. It does not
-// always find the quaried point itself, and is not idempotent while it should
-// (ie ensure that equivalent(equivalent(p)) = equivalent(p) for any p)
+#include <MfxCommon/CookProgress.h>
+#include <MfxCommon/Parallel.h>
+#include <MfxCommon/RadixSort.h>
+
+// The tree is an implicit, index based kd-tree: nodes live in a flat array in
+// pre-order and point coordinates are copied once, in tree order, into three
+// contiguous float arrays. Leaves hold up to kLeafSize consecutive points so
+// that the innermost loops are plain scans over contiguous memory.
+// Points are split by rank (coordinate, then index) rather than by value, so
+// that duplicate coordinates always produce balanced subtrees, and inner nodes
+// keep both the max of the left side and the min of the right side along the
+// split axis, which lets queries skip the gap between the two.
+//
+// Construction first sorts the points once along each axis, then splits these
+// three sorted lists level by level with stable partitions. This is O(n log n)
+// whatever the input, and both the partitions and the two subtrees of large
+// nodes run in parallel.
 
 using Real = KDTree::Real;
 
 /**
- * Squared euclidian distance between the roots of two trees
+ * Squared euclidian distance between two points
  */
-static inline Real dist(struct kd_node_t *a, struct kd_node_t *b)
+static inline Real dist(Real ax, Real ay, Real az, Real bx, Real by, Real bz)
 {
-    Real dx = a->p[0] - b->p[0];
-    Real dy = a->p[1] - b->p[1];
-    Real dz = a->p[2] - b->p[2];
-    return dx * dx + dy * dy + dz * dz;
+	Real dx = ax - bx;
+	Real dy = ay - by;
+	Real dz = az - bz;
+	return dx * dx + dy * dy + dz * dz;
 }
 
 /**
- * Swap node values only (not node children)
+ * Whether a subtree lying at signed distance d from the target along the
+ * split axis may contain points within the squared radius. This mirrors the
+ * rounding of dist() so that pruning never drops a pair that dist() accepts.
  */
-static inline void swap(struct kd_node_t *x, struct kd_node_t *y) {
-    char *tmp = x->p;
-    x->p = y->p;
-    y->p = tmp;
+static inline bool within(Real d, Real sqradius)
+{
+	return d <= 0 || d * d <= sqradius;
+}
+
+static inline bool is_leaf(const kd_node_t & node)
+{
+	return (node.meta & 3) == KDTree::kLeaf;
+}
+
+static inline int leaf_count(const kd_node_t & node)
+{
+	return node.meta >> 2;
 }
 
 /**
- * From a range of node pointers find the median one with regard to its dimension axis
+ * Number of nodes in a subtree holding n points. At any depth subtree sizes
+ * only take two consecutive values, so it is enough to carry (f(n), f(n+1))
+ * down a single path.
  */
-static struct kd_node_t* find_median(struct kd_node_t *start, struct kd_node_t *end, int axis)
-{
-    if (end <= start) return NULL;
-    if (end == start + 1)
-        return start;
- 
-    struct kd_node_t *p, *store, *md = start + (end - start) / 2;
-    double pivot;
-    while (1) {
-        pivot = md->p[axis];
- 
-        swap(md, end - 1);
-        for (store = p = start; p < end; p++) {
-            if (p->p[axis] < pivot) {
-                if (p != store)
-                    swap(p, store);
-                store++;
-            }
-        }
-        swap(store, end - 1);
- 
-        /* TODO: PROBLEM if median has duplicate values */
-        if (store->p[axis] == md->p[axis])
-            return md;
- 
-        if (store > md) end = store;
-        else        start = store;
-    }
-}
- 
-static struct kd_node_t* make_tree(struct kd_node_t *t, int len, int axis = 0)
-{
-    struct kd_node_t *n;
- 
-    if (!len) return 0;
- 
-    if (n = find_median(t, t + len, axis)) {
-		axis = (axis + 1) % 3;
-		n->left  = make_tree(t, n - t, axis);
-		n->right = make_tree(n + 1, t + len - (n + 1), axis);
-    }
-    return n;
-}
-
-static void nearest_aux(struct kd_node_t *root, struct kd_node_t *target,
-        struct kd_node_t **best, Real *best_dist, int axis = 0)
-{
-    Real d, dx, dx2;
- 
-    if (!root) return;
-    d = dist(root, target);
-    dx = root->p[axis] - target->p[axis];
-    dx2 = dx * dx;
-
-    if (!*best || d < *best_dist) {
-        *best_dist = d;
-        *best = root;
-    }
- 
-    /* if chance of exact match is high */
-    if (!*best_dist) return;
- 
-    axis = (axis + 1) % 3;
- 
-    nearest_aux(dx > 0 ? root->left : root->right, target, best, best_dist, axis);
-    if (dx2 > *best_dist) return;
-    nearest_aux(dx > 0 ? root->right : root->left, target, best, best_dist, axis);
+static void subtree_node_count_pair(int n, int & fn, int & fn1)
+{
+	if (n + 1 <= KDTree::kLeafSize) {
+		fn = fn1 = 1;
+		return;
+	}
+	int h = n / 2;
+	int a, b; // f(h), f(h+1)
+	subtree_node_count_pair(h, a, b);
+	if (n % 2 == 0) {
+		fn = n <= KDTree::kLeafSize ? 1 : 1 + 2 * a;
+		fn1 = 1 + a + b;
+	}
+	else {
+		fn = n <= KDTree::kLeafSize ? 1 : 1 + a + b;
+		fn1 = 1 + 2 * b;
+	}
+}
+
+static int subtree_node_count(int n)
+{
+	int fn, fn1;
+	subtree_node_count_pair(n, fn, fn1);
+	return fn;
 }
 
 /**
- * Get point with the minimum index among the points lying within a given
- * radius around target.
+ * Map a float to an unsigned integer with the same ordering
  */
-static void equivalent_aux(struct kd_node_t *root, struct kd_node_t *target,
-                          Real sqradius, struct kd_node_t **best, int axis = 0)
-{
-    Real d, dx, dx2;
- 
-    if (!root) return;
-    d = dist(root, target);
-    dx = root->p[axis] - target->p[axis];
-    dx2 = dx * dx;
-
-	if (d <= sqradius && (!*best || root->p < (*best)->p)) {
-		*best = root;
-	}
- 
-    axis = (axis + 1) % 3;
- 
-	equivalent_aux(dx > 0 ? root->left : root->right, target, sqradius, best, axis);
-    if (dx2 > sqradius) return;
-	equivalent_aux(dx > 0 ? root->right : root->left, target, sqradius, best, axis);
-}
-
-static void print_aux(struct kd_node_t *root, int offset = 0)
-{
-    if (!root) return;
-	for (int i = 0 ; i < offset ; ++i) std::cout << "  ";
-	std::cout << "[" << root->p[0] << ", " << root->p[1] << ", " << root->p[2] << "]" << std::endl;
-    print_aux(root->left, offset + 1);
-	print_aux(root->right, offset + 1);
-}
-
-KDTree::KDTree(int point_count, char *point_data, int stride)
-    : m_point_data(point_data)
-	, m_nodes(point_count)
-    , m_stride(stride)
-{
-    for (int i = 0 ; i < point_count ; ++i) {
-        m_nodes[i].p = m_point_data + m_stride * i;
-    }
-    m_root = make_tree(m_nodes.data(), static_cast<int>(m_nodes.size()));
-}
-
-void KDTree::nearest(int point_index, int & best_index, Real & best_distance) {
-    struct kd_node_t *best = NULL;
-	struct kd_node_t target;
-	target.p = m_point_data + m_stride * point_index;
-    nearest_aux(m_root, &target, &best, &best_distance);
-    best_index = NULL == best ? -1 : (best->p - m_point_data) / m_stride;
-}
-
-int KDTree::equivalent(int point_index, Real radius) {
-    struct kd_node_t *best = NULL;
-	struct kd_node_t target;
-	target.p = m_point_data + m_stride * point_index;
-	equivalent_aux(m_root, &target, radius * radius, &best);
-	// The min should not be needed if the algorithm would work
-    return NULL == best ? point_index : std::min(point_index, static_cast<int>((best->p - m_point_data) / m_stride));
+static inline uint32_t sortable_key(Real v)
+{
+	uint32_t u;
+	memcpy(&u, &v, sizeof(u));
+	return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+static constexpr int kSortGrain = 1 << 16;
+static constexpr int kPartitionGrain = 1 << 15;
+static constexpr int kQueryGrain = 1 << 12;
+
+/**
+ * Stable partition of ord[begin:end] into the points whose side flag is 0,
+ * then those whose side flag is 1, of which there are end - mid.
+ */
+static void stable_partition(int *ord, int *tmp, int begin, int mid, int end, const uint8_t *side, int thread_count)
+{
+	int count = end - begin;
+	int chunk_count = chunkCount(count, kPartitionGrain, thread_count);
+
+	if (chunk_count == 1) {
+		int l = begin, r = mid;
+		for (int i = begin; i < end; ++i) {
+			int p = ord[i];
+			if (side[p]) tmp[r++] = p;
+			else tmp[l++] = p;
+		}
+		std::copy(tmp + begin, tmp + end, ord + begin);
+		return;
+	}
+
+	std::vector<int> left_offset(chunk_count);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int n = 0;
+		int e = begin + chunkBegin(count, chunk_count, chunk + 1);
+		for (int i = begin + chunkBegin(count, chunk_count, chunk); i < e; ++i) {
+			n += side[ord[i]] == 0;
+		}
+		left_offset[chunk] = n;
+	});
+	int sum = 0;
+	for (int c = 0; c < chunk_count; ++c) {
+		int n = left_offset[c];
+		left_offset[c] = sum;
+		sum += n;
+	}
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int b = begin + chunkBegin(count, chunk_count, chunk);
+		int e = begin + chunkBegin(count, chunk_count, chunk + 1);
+		int l = begin + left_offset[chunk];
+		int r = mid + (b - begin) - left_offset[chunk];
+		for (int i = b; i < e; ++i) {
+			int p = ord[i];
+			if (side[p]) tmp[r++] = p;
+			else tmp[l++] = p;
+		}
+	});
+	parallelFor(begin, end, kPartitionGrain, thread_count, [&](int b, int e) {
+		std::copy(tmp + b, tmp + e, ord + b);
+	});
+}
+
+namespace {
+struct build_context_t {
+	const Real *xyz; // packed input positions
+	int *ord[3]; // point indices, sorted along each axis within each subtree
+	int *tmp;
+	uint8_t *side; // per point, 0 when it goes to the left subtree
+	kd_node_t *nodes;
+	Real *x, *y, *z;
+	int *point_index;
+};
+}
+
+static void build_leaf(const build_context_t & ctx, kd_node_t & node, int begin, int end)
+{
+	node.meta = KDTree::kLeaf | ((end - begin) << 2);
+	node.index = begin;
+	for (int i = begin; i < end; ++i) {
+		int p = ctx.ord[0][i];
+		ctx.point_index[i] = p;
+		ctx.x[i] = ctx.xyz[3 * p + 0];
+		ctx.y[i] = ctx.xyz[3 * p + 1];
+		ctx.z[i] = ctx.xyz[3 * p + 2];
+	}
+}
+
+static void build_subtree(const build_context_t & ctx, int node_index, int begin, int end, int thread_count)
+{
+	int count = end - begin;
+	kd_node_t & node = ctx.nodes[node_index];
+
+	if (count <= KDTree::kLeafSize) {
+		build_leaf(ctx, node, begin, end);
+		return;
+	}
+
+	// When the cook is cancelled, large subtrees are left unbuilt and the
+	// constructor empties the whole tree
+	bool large = count > KDTree::kParallelCutoff;
+	if (large && cookCancelled()) return;
+
+	// Split along the axis of largest extent, read off the sorted lists
+	int axis = 0;
+	Real best_extent = -1;
+	for (int k = 0; k < 3; ++k) {
+		Real extent = ctx.xyz[3 * ctx.ord[k][end - 1] + k] - ctx.xyz[3 * ctx.ord[k][begin] + k];
+		if (extent > best_extent) {
+			best_extent = extent;
+			axis = k;
+		}
+	}
+
+	int mid = begin + count / 2;
+	const int *split = ctx.ord[axis];
+	int right = node_index + 1 + subtree_node_count(mid - begin);
+	node.left_max = ctx.xyz[3 * split[mid - 1] + axis];
+	node.right_min = ctx.xyz[3 * split[mid] + axis];
+	node.meta = axis;
+	node.index = right;
+
+	parallelFor(begin, end, kPartitionGrain, thread_count, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			ctx.side[split[i]] = i >= mid;
+		}
+	});
+	for (int k = 0; k < 3; ++k) {
+		if (k == axis) continue;
+		stable_partition(ctx.ord[k], ctx.tmp, begin, mid, end, ctx.side, thread_count);
+	}
+
+	bool parallel = thread_count > 1 && count > KDTree::kParallelCutoff;
+	int left_threads = parallel ? thread_count / 2 : thread_count;
+	int right_threads = parallel ? thread_count - left_threads : thread_count;
+	parallelInvoke(parallel,
+		[&]() { build_subtree(ctx, node_index + 1, begin, mid, left_threads); },
+		[&]() { build_subtree(ctx, right, mid, end, right_threads); }
+	);
+
+	// Progress is reported for the points of the small subtrees, each built
+	// by a single call
+	if (large) {
+		int small_count = 0;
+		if (mid - begin <= KDTree::kParallelCutoff) small_count += mid - begin;
+		if (end - mid <= KDTree::kParallelCutoff) small_count += end - mid;
+		cookCheckpoint(small_count);
+	}
+}
+
+KDTree::KDTree(int point_count, const char *point_data, int stride, int thread_count, ScratchArena *arena)
+	: m_points(point_data, stride, point_count)
+	, m_thread_count(resolveThreadCount(thread_count))
+	, m_nodes(arena)
+	, m_x(arena)
+	, m_y(arena)
+	, m_z(arena)
+	, m_point_index(arena)
+{
+	if (point_count <= 0) return;
+	int threads = m_thread_count;
+
+	// Positions packed, copied only when the host buffer is strided
+	ScratchVector<Real> xyz_copy(arena);
+	const Real *xyz = m_points[0];
+	if (!m_points.isPacked()) {
+		xyz_copy.resize(3 * static_cast<size_t>(point_count));
+		copyAttribute(m_points, AttributeView<Real, 3>::packed(xyz_copy.data(), point_count), threads);
+		xyz = xyz_copy.data();
+	}
+
+	// Sort point indices along each axis, ties are kept in index order
+	ScratchVector<int> ord[3] = {
+		ScratchVector<int>(point_count, 0, arena),
+		ScratchVector<int>(point_count, 0, arena),
+		ScratchVector<int>(point_count, 0, arena)
+	};
+	{
+		ScratchVector<uint32_t> keys(point_count, 0, arena);
+		for (int k = 0; k < 3; ++k) {
+			if (cookCancelled()) break;
+			parallelFor(0, point_count, kSortGrain, threads, [&](int b, int e) {
+				for (int i = b; i < e; ++i) {
+					keys[i] = sortable_key(xyz[3 * static_cast<size_t>(i) + k]);
+					ord[k][i] = i;
+				}
+			});
+			radixSort(keys.data(), ord[k].data(), point_count, 32, threads, arena);
+		}
+	}
+
+	// The tree of a cancelled cook is left empty, the sorted lists may be
+	// incomplete and its result is dropped anyway
+	if (cookCancelled()) return;
+
+	// With an arena, the sort keys and the buffers of the sort above are on
+	// top of the stack and now freed, so the rest reuses their memory
+	ScratchVector<int> tmp(point_count, 0, arena);
+	ScratchVector<uint8_t> side(point_count, 0, arena);
+	m_nodes.resize(subtree_node_count(point_count));
+	m_x.resize(point_count);
+	m_y.resize(point_count);
+	m_z.resize(point_count);
+	m_point_index.resize(point_count);
+
+	build_context_t ctx;
+	ctx.xyz = xyz;
+	for (int k = 0; k < 3; ++k) {
+		ctx.ord[k] = ord[k].data();
+	}
+	ctx.tmp = tmp.data();
+	ctx.side = side.data();
+	ctx.nodes = m_nodes.data();
+	ctx.x = m_x.data();
+	ctx.y = m_y.data();
+	ctx.z = m_z.data();
+	ctx.point_index = m_point_index.data();
+	build_subtree(ctx, 0, 0, point_count, threads);
+
+	// Same as above once the build started: some nodes may be unset, so
+	// the whole tree is dropped rather than leaving oversized leaves
+	if (cookCancelled()) {
+		m_nodes.clear();
+		m_x.clear();
+		m_y.clear();
+		m_z.clear();
+		m_point_index.clear();
+	}
+}
+
+void KDTree::refit(const char *point_data, int stride)
+{
+	m_points = AttributeView<const Real, 3>(point_data, stride, m_points.size());
+	if (empty()) return;
+	int point_count = pointCount();
+
+	parallelFor(0, point_count, kSortGrain, m_thread_count, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			const Real *p = position(m_point_index[i]);
+			m_x[i] = p[0];
+			m_y[i] = p[1];
+			m_z[i] = p[2];
+		}
+	});
+
+	Real lo[3], hi[3];
+	refitSubtree(0, 0, point_count, lo, hi, m_thread_count);
+}
+
+void KDTree::refitSubtree(int node_index, int begin, int end, Real lo[3], Real hi[3], int thread_count)
+{
+	kd_node_t & node = m_nodes[node_index];
+
+	if (is_leaf(node)) {
+		const Real *coords[3] = { m_x.data(), m_y.data(), m_z.data() };
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = hi[k] = coords[k][begin];
+			for (int i = begin + 1; i < end; ++i) {
+				lo[k] = std::min(lo[k], coords[k][i]);
+				hi[k] = std::max(hi[k], coords[k][i]);
+			}
+		}
+		return;
+	}
+
+	// Same split as when building, the left subtree gets the lower half
+	int count = end - begin;
+	int mid = begin + count / 2;
+	Real left_lo[3], left_hi[3], right_lo[3], right_hi[3];
+	bool parallel = thread_count > 1 && count > kParallelCutoff;
+	int left_threads = parallel ? thread_count / 2 : thread_count;
+	int right_threads = parallel ? thread_count - left_threads : thread_count;
+	parallelInvoke(parallel,
+		[&]() { refitSubtree(node_index + 1, begin, mid, left_lo, left_hi, left_threads); },
+		[&]() { refitSubtree(node.index, mid, end, right_lo, right_hi, right_threads); }
+	);
+
+	int axis = node.meta & 3;
+	node.left_max = left_hi[axis];
+	node.right_min = right_lo[axis];
+	for (int k = 0; k < 3; ++k) {
+		lo[k] = std::min(left_lo[k], right_lo[k]);
+		hi[k] = std::max(left_hi[k], right_hi[k]);
+	}
+}
+
+void KDTree::nearest(int point_index, int & best_index, Real & best_distance) const {
+	best_index = -1;
+	if (m_nodes.empty()) return;
+
+	const Real *target = position(point_index);
+	Real tx = target[0], ty = target[1], tz = target[2];
+
+	struct entry_t { int node; Real bound; };
+	entry_t stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = entry_t{ 0, 0 };
+
+	while (top > 0) {
+		entry_t e = stack[--top];
+		if (best_index != -1 && e.bound >= best_distance) continue;
+		const kd_node_t & node = m_nodes[e.node];
+
+		if (is_leaf(node)) {
+			int end = node.index + leaf_count(node);
+			for (int i = node.index; i < end; ++i) {
+				Real d = dist(m_x[i], m_y[i], m_z[i], tx, ty, tz);
+				if (best_index == -1 || d < best_distance) {
+					best_distance = d;
+					best_index = m_point_index[i];
+				}
+			}
+			/* if chance of exact match is high */
+			if (best_distance == 0) break;
+			continue;
+		}
+
+		int axis = node.meta & 3;
+		Real t = target[axis];
+		Real dl = std::max(Real(0), t - node.left_max);
+		Real dr = std::max(Real(0), node.right_min - t);
+		int left = e.node + 1, right = node.index;
+		// Push the far child first so that the near one is visited first
+		if (dl <= dr) {
+			stack[top++] = entry_t{ right, dr * dr };
+			stack[top++] = entry_t{ left, dl * dl };
+		}
+		else {
+			stack[top++] = entry_t{ left, dl * dl };
+			stack[top++] = entry_t{ right, dr * dr };
+		}
+	}
+}
+
+MFX_DEFINE_ISA_DISPATCH(scan_point_ranges, scanPointRanges)
+
+template <typename Fn>
+void KDTree::forEachInRadius(const Real target[3], Real sqradius, const Fn & fn, int64_t *visit_count) const {
+	if (m_nodes.empty()) return;
+
+	// Leaves are not scanned one by one but collected into ranges of tree
+	// positions, merged when contiguous, which are handed to the scan kernel
+	// by batches of up to kScanBatch points.
+	static_assert(kLeafSize <= kScanBatch, "a leaf must fit in a batch");
+	static constexpr int kMaxRanges = 64;
+	int range_begin[kMaxRanges];
+	int range_size[kMaxRanges];
+	int hits[kScanBatch];
+	Real sq_distances[kScanBatch];
+	int range_count = 0;
+	int batch_size = 0;
+	auto scan = scan_point_ranges();
+	auto flush = [&]() {
+		int n = scan(m_x.data(), m_y.data(), m_z.data(), range_begin, range_size, range_count, target, sqradius, hits, sq_distances);
+		for (int h = 0; h < n; ++h) {
+			fn(hits[h], sq_distances[h]);
+		}
+		range_count = 0;
+		batch_size = 0;
+	};
+
+	int stack[kMaxDepth];
+	int top = 0;
+	stack[top++] = 0;
+	int64_t visits = 0;
+
+	while (top > 0) {
+		const kd_node_t & node = m_nodes[stack[--top]];
+		++visits;
+
+		if (is_leaf(node)) {
+			int count = leaf_count(node);
+			if (batch_size + count > kScanBatch || range_count == kMaxRanges) flush();
+			if (range_count > 0 && range_begin[range_count - 1] + range_size[range_count - 1] == node.index) {
+				range_size[range_count - 1] += count;
+			}
+			else {
+				range_begin[range_count] = node.index;
+				range_size[range_count] = count;
+				++range_count;
+			}
+			batch_size += count;
+			continue;
+		}
+
+		// The right child is pushed first so that points come in tree order
+		int axis = node.meta & 3;
+		int node_index = static_cast<int>(&node - m_nodes.data());
+		if (within(node.right_min - target[axis], sqradius)) stack[top++] = node.index;
+		if (within(target[axis] - node.left_max, sqradius)) stack[top++] = node_index + 1;
+	}
+	if (range_count > 0) flush();
+	if (nullptr != visit_count) *visit_count += visits;
+}
+
+int KDTree::equivalent(int point_index, Real radius) const {
+	const Real *target = position(point_index);
+	int best = point_index;
+	forEachInRadius(target, radius * radius, [&](int i, Real) {
+		best = std::min(best, m_point_index[i]);
+	});
+	return best;
+}
+
+void KDTree::equivalentAll(Real radius, int *assign, int64_t *visit_count) const {
+	if (empty()) return;
+	int point_count = pointCount();
+
+	if (cookCancelled()) {
+		// The result of a cancelled cook is dropped anyway
+		std::iota(assign, assign + point_count, 0);
+		return;
+	}
+
+	UnionFind sets(point_count, m_thread_count);
+	Real sqradius = radius * radius;
+
+	// Queries are issued in tree order so that consecutive queries visit
+	// the same nodes. Each pair of close points is linked once, from its
+	// highest index.
+	std::atomic<int64_t> total_visits(0);
+	parallelFor(0, point_count, 1 << 12, m_thread_count, [&](int b, int e) {
+		int64_t visits = 0;
+		for (int s = b; s < e; ++s) {
+			if ((s - b) % kCheckpointGrain == kCheckpointGrain - 1 && cookCheckpoint(kCheckpointGrain)) break;
+			int target_index = m_point_index[s];
+			Real target[3] = { m_x[s], m_y[s], m_z[s] };
+			forEachInRadius(target, sqradius, [&](int i, Real) {
+				if (m_point_index[i] < target_index) sets.unite(target_index, m_point_index[i]);
+			}, &visits);
+		}
+		total_visits.fetch_add(visits, std::memory_order_relaxed);
+	});
+
+	sets.flatten(assign, m_thread_count);
+	if (nullptr != visit_count) *visit_count = total_visits.load();
+}
+
+void KDTree::radiusSearch(int query_count, const char *query_data, int query_stride, Real radius, neighbor_lists_t & result) const
+{
+	AttributeView<const Real, 3> queries(query_data, query_stride, query_count);
+	Real sqradius = radius * radius;
+	if (empty()) {
+		result.offsets.assign(query_count + 1, 0);
+		result.indices.clear();
+		result.sq_distances.clear();
+		return;
+	}
+	result.offsets.resize(query_count + 1);
+
+	// Each chunk of queries appends the neighbours it finds to buffers of
+	// its own, which are then concatenated once all counts are known. The
+	// buffers are kept in result, so that batches after the first one do
+	// not allocate them again.
+	int chunk_count = chunkCount(query_count, kQueryGrain, m_thread_count);
+	std::vector<std::vector<int>> & chunk_indices = result.chunk_indices;
+	std::vector<std::vector<Real>> & chunk_distances = result.chunk_sq_distances;
+	if (static_cast<int>(chunk_indices.size()) < chunk_count) {
+		chunk_indices.resize(chunk_count);
+		chunk_distances.resize(chunk_count);
+	}
+	parallelForChunks(chunk_count, [&](int chunk) {
+		std::vector<int> & indices = chunk_indices[chunk];
+		std::vector<Real> & distances = chunk_distances[chunk];
+		indices.clear();
+		distances.clear();
+		int end = chunkBegin(query_count, chunk_count, chunk + 1);
+		for (int q = chunkBegin(query_count, chunk_count, chunk); q < end; ++q) {
+			size_t first = indices.size();
+			forEachInRadius(queries[q], sqradius, [&](int i, Real d) {
+				indices.push_back(m_point_index[i]);
+				distances.push_back(d);
+			});
+			result.offsets[q] = static_cast<int>(indices.size() - first);
+		}
+	});
+
+	int total = parallelExclusiveScan(result.offsets.data(), query_count, m_thread_count);
+	result.offsets[query_count] = total;
+	result.indices.resize(total);
+	result.sq_distances.resize(total);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int first = result.offsets[chunkBegin(query_count, chunk_count, chunk)];
+		std::copy(chunk_indices[chunk].begin(), chunk_indices[chunk].end(), result.indices.begin() + first);
+		std::copy(chunk_distances[chunk].begin(), chunk_distances[chunk].end(), result.sq_distances.begin() + first);
+	});
+}
+
+namespace {
+struct candidate_t {
+	Real sq_distance;
+	int index;
+
+	bool operator<(const candidate_t & other) const {
+		return sq_distance < other.sq_distance || (sq_distance == other.sq_distance && index < other.index);
+	}
+};
+}
+
+void KDTree::knnSearch(int query_count, const char *query_data, int query_stride, int k, neighbor_lists_t & result) const
+{
+	AttributeView<const Real, 3> queries(query_data, query_stride, query_count);
+	k = empty() ? 0 : std::max(0, std::min(k, pointCount()));
+	result.offsets.resize(query_count + 1);
+	result.indices.resize(static_cast<size_t>(query_count) * k);
+	result.sq_distances.resize(static_cast<size_t>(query_count) * k);
+
+	parallelFor(0, query_count + 1, kSortGrain, m_thread_count, [&](int b, int e) {
+		for (int q = b; q < e; ++q) {
+			result.offsets[q] = q * k;
+		}
+	});
+	if (k == 0) return;
+
+	parallelFor(0, query_count, kQueryGrain, m_thread_count, [&](int b, int e) {
+		// Max-heap of the k best candidates found so far
+		std::vector<candidate_t> heap(k);
+		struct entry_t { int node; Real bound; };
+		entry_t stack[kMaxDepth];
+
+		for (int q = b; q < e; ++q) {
+			const Real *target = queries[q];
+			int size = 0;
+			int top = 0;
+			stack[top++] = entry_t{ 0, 0 };
+
+			while (top > 0) {
+				entry_t entry = stack[--top];
+				// Subtrees at the same distance as the worst candidate may
+				// still hold a point of lower index
+				if (size == k && entry.bound > heap[0].sq_distance) continue;
+				const kd_node_t & node = m_nodes[entry.node];
+
+				if (is_leaf(node)) {
+					int end = node.index + leaf_count(node);
+					for (int i = node.index; i < end; ++i) {
+						candidate_t c{ dist(m_x[i], m_y[i], m_z[i], target[0], target[1], target[2]), m_point_index[i] };
+						if (size < k) {
+							heap[size++] = c;
+							std::push_heap(heap.begin(), heap.begin() + size);
+						}
+						else if (c < heap[0]) {
+							std::pop_heap(heap.begin(), heap.end());
+							heap[k - 1] = c;
+							std::push_heap(heap.begin(), heap.end());
+						}
+					}
+					continue;
+				}
+
+				int axis = node.meta & 3;
+				Real t = target[axis];
+				Real dl = std::max(Real(0), t - node.left_max);
+				Real dr = std::max(Real(0), node.right_min - t);
+				int left = entry.node + 1, right = node.index;
+				// Push the far child first so that the near one is visited first
+				if (dl <= dr) {
+					stack[top++] = entry_t{ right, dr * dr };
+					stack[top++] = entry_t{ left, dl * dl };
+				}
+				else {
+					stack[top++] = entry_t{ left, dl * dl };
+					stack[top++] = entry_t{ right, dr * dr };
+				}
+			}
+
+			std::sort_heap(heap.begin(), heap.begin() + size);
+			size_t first = static_cast<size_t>(q) * k;
+			for (int j = 0; j < size; ++j) {
+				result.indices[first + j] = heap[j].index;
+				result.sq_distances[first + j] = heap[j].sq_distance;
+			}
+		}
+	});
+}
+
+size_t KDTree::memoryUsage() const
+{
+	return m_nodes.capacity() * sizeof(kd_node_t)
+		+ (m_x.capacity() + m_y.capacity() + m_z.capacity()) * sizeof(Real)
+		+ m_point_index.capacity() * sizeof(int);
 }
@@ -24,34 +24,168 @@
 
 #pragma once
 
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/ScratchArena.h>
+
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
-struct kd_node_t{
-	char* p; // pointer to data pool
-    struct kd_node_t *left, *right;
+/**
+ * Node of the kd-tree. Nodes are stored in pre-order in a flat array, so the
+ * left child of an inner node is always the next node and only the right
+ * child index needs to be stored.
+ */
+struct kd_node_t {
+	float left_max; // inner node: max coordinate of the left subtree along the split axis
+	float right_min; // inner node: min coordinate of the right subtree along the split axis
+	int32_t meta; // bits 0-1: split axis, or kLeaf; bits 2-31: point count of a leaf
+	int32_t index; // inner node: index of the right child; leaf: first point in tree order
+};
+
+/**
+ * Neighbours found by a batch of queries, in compressed sparse row layout:
+ * the neighbours of query q are indices[offsets[q]] to
+ * indices[offsets[q + 1] - 1], given as indices of points in the tree, and
+ * sq_distances holds their squared distances to the query. The buffers are
+ * reused from one batch to the next.
+ */
+struct neighbor_lists_t {
+	std::vector<int> offsets; // query count + 1 elements
+	std::vector<int> indices;
+	std::vector<float> sq_distances;
+
+	// Neighbours found by each chunk of queries of KDTree::radiusSearch(),
+	// before they are concatenated, kept so that their memory is reused too
+	std::vector<std::vector<int>> chunk_indices;
+	std::vector<std::vector<float>> chunk_sq_distances;
+
+	int queryCount() const { return offsets.empty() ? 0 : static_cast<int>(offsets.size()) - 1; }
+	int neighborCount(int query) const { return offsets[query + 1] - offsets[query]; }
 };
 
 class KDTree {
 public:
 	using Real = float;
 
-    KDTree(int point_count, char*point_data, int stride = 3);
+	/**
+	 * Build a tree over point_count points whose xyz float coordinates are
+	 * read from point_data, separated by stride bytes. Positions are copied
+	 * so point_data only needs to stay valid while calling the queries that
+	 * take a point index.
+	 * Construction runs on up to thread_count threads, or on all available
+	 * cores when thread_count is 0.
+	 * If arena is not null, the tree and its construction buffers are
+	 * allocated from it, and the tree must be destroyed before the arena is
+	 * rewound past the point where it was built.
+	 */
+	KDTree(int point_count, const char *point_data, int stride = 3 * sizeof(Real), int thread_count = 0, ScratchArena *arena = nullptr);
+
+	/**
+	 * Update the tree for new positions of the same points, e.g. the next
+	 * frame of an animation, without changing its structure: points keep
+	 * their leaf and only the split bounds of inner nodes are recomputed.
+	 * This is O(n) and queries remain exact, but they get slower as the
+	 * points drift away from the configuration the tree was built for,
+	 * because the two sides of a node may then overlap.
+	 */
+	void refit(const char *point_data, int stride = 3 * sizeof(Real));
 
 	/**
 	 * Get the nearest point (useless as is, it will return the target point
 	 * itself since by construction it is in the tree)
 	 */
-    void nearest(int point_index, int & best_index, Real & best_distance);
+	void nearest(int point_index, int & best_index, Real & best_distance) const;
 
 	/**
 	 * Get point with the minimum index among the points lying within a given
 	 * radius around target.
 	 */
-	int equivalent(int point_index, Real radius);
+	int equivalent(int point_index, Real radius) const;
+
+	/**
+	 * Compute for every point the representative it gets merged into. Points
+	 * closer than radius are linked together, and each group of linked points
+	 * is represented by its lowest index, so that assign[assign[i]] is always
+	 * assign[i]. Runs in parallel, and the result does not depend on the
+	 * number of threads. assign must hold pointCount() elements.
+	 * If visit_count is not null, it receives the number of nodes visited,
+	 * which tells how well the tree prunes the search.
+	 */
+	void equivalentAll(Real radius, int *assign, int64_t *visit_count = nullptr) const;
+
+	/**
+	 * Find, for each of the query_count points whose xyz float coordinates
+	 * are read from query_data separated by query_stride bytes, all points
+	 * of the tree lying within radius. Query points do not need to be in the
+	 * tree, they may for instance be the points of another mesh. Neighbours
+	 * of a query are listed in tree order, so results are the same from one
+	 * run to the next. Queries run in parallel, with no allocation per query.
+	 */
+	void radiusSearch(int query_count, const char *query_data, int query_stride, Real radius, neighbor_lists_t & result) const;
+
+	/**
+	 * Find, for each query point, the k points of the tree nearest to it, or
+	 * all points if the tree has fewer than k. They are sorted by increasing
+	 * distance, then by index when distances are equal.
+	 */
+	void knnSearch(int query_count, const char *query_data, int query_stride, int k, neighbor_lists_t & result) const;
+
+	/**
+	 * True when the tree holds no point, which is also the case of a tree
+	 * whose build was cancelled
+	 */
+	bool empty() const { return m_nodes.empty(); }
+
+	int pointCount() const { return static_cast<int>(m_point_index.size()); }
+	int nodeCount() const { return static_cast<int>(m_nodes.size()); }
+
+	/**
+	 * Original index of each point, in tree order. Points of a leaf, and of
+	 * a subtree, are contiguous, so it is a spatially coherent order.
+	 */
+	const int *pointOrder() const { return m_point_index.data(); }
+
+	/**
+	 * Number of bytes held by the tree (nodes and tree-ordered point copy)
+	 */
+	size_t memoryUsage() const;
+
+public:
+	static constexpr int kLeafSize = 8;
+	static constexpr int kLeaf = 3;
+	static constexpr int kMaxDepth = 64;
+	// Subtrees with fewer points than this are built on a single thread
+	static constexpr int kParallelCutoff = 1 << 14;
+	// Max number of points of the leaves scanned at once by radius queries
+	static constexpr int kScanBatch = 512;
+
+private:
+	/**
+	 * Recompute the bounds of the subtree at node_index, which holds points
+	 * [begin, end) in tree order, and return its bounding box.
+	 */
+	void refitSubtree(int node_index, int begin, int end, Real lo[3], Real hi[3], int thread_count);
+
+	const Real *position(int point_index) const {
+		return m_points[point_index];
+	}
+
+	/**
+	 * Call fn(i, sq_distance) for each point i, in tree order, lying within
+	 * the squared radius around target. i is the position of the point in
+	 * tree order, m_point_index[i] being its index. If visit_count is not
+	 * null, the number of nodes visited is added to it.
+	 */
+	template <typename Fn>
+	void forEachInRadius(const Real target[3], Real sqradius, const Fn & fn, int64_t *visit_count = nullptr) const;
 
 private:
-	char *m_point_data;
-    std::vector<struct kd_node_t> m_nodes;
-    struct kd_node_t *m_root;
-    int m_stride;
+	AttributeView<const Real, 3> m_points;
+	int m_thread_count;
+	ScratchVector<kd_node_t> m_nodes;
+	// Point coordinates in tree order, as three contiguous arrays (SoA)
+	ScratchVector<Real> m_x, m_y, m_z;
+	// Original index of each point, in tree order
+	ScratchVector<int> m_point_index;
 };
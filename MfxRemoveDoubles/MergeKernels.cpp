@@ -0,0 +1,157 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "MergeKernels.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Distances are computed as in the rest of the kd-tree, with a separate
+// multiply and add per axis (no FMA contraction), so that the level this file
+// is built for never changes which points get merged.
+
+int MFX_ISA_NAME(scanPointRanges)(
+	const float *x, const float *y, const float *z,
+	const int *range_begin, const int *range_size, int range_count,
+	const float target[3], float sqradius,
+	int *hits, float *sq_distances)
+{
+	int n = 0;
+	for (int r = 0; r < range_count; ++r) {
+		int begin = range_begin[r];
+		int end = begin + range_size[r];
+		int i = begin;
+
+#if defined(__AVX512F__)
+		const __m512 tx = _mm512_set1_ps(target[0]);
+		const __m512 ty = _mm512_set1_ps(target[1]);
+		const __m512 tz = _mm512_set1_ps(target[2]);
+		const __m512 sq = _mm512_set1_ps(sqradius);
+		const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		for (; i < end; i += 16) {
+			// Tail lanes are masked out rather than handled by a scalar loop
+			int left = end - i;
+			__mmask16 valid = left >= 16 ? static_cast<__mmask16>(0xffff) : static_cast<__mmask16>((1u << left) - 1);
+			__m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(valid, x + i), tx);
+			__m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(valid, y + i), ty);
+			__m512 dz = _mm512_sub_ps(_mm512_maskz_loadu_ps(valid, z + i), tz);
+			__m512 d = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+			__mmask16 inside = _mm512_mask_cmp_ps_mask(valid, d, sq, _CMP_LE_OQ);
+			__m512i index = _mm512_add_epi32(_mm512_set1_epi32(i), lanes);
+			_mm512_mask_compressstoreu_epi32(hits + n, inside, index);
+			_mm512_mask_compressstoreu_ps(sq_distances + n, inside, d);
+			n += _mm_popcnt_u32(inside);
+		}
+#elif defined(__AVX2__)
+		const __m256 tx = _mm256_set1_ps(target[0]);
+		const __m256 ty = _mm256_set1_ps(target[1]);
+		const __m256 tz = _mm256_set1_ps(target[2]);
+		const __m256 sq = _mm256_set1_ps(sqradius);
+		for (; i + 8 <= end; i += 8) {
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), tx);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), ty);
+			__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), tz);
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+			int inside = _mm256_movemask_ps(_mm256_cmp_ps(d, sq, _CMP_LE_OQ));
+			if (0 == inside) continue;
+			float lane_d[8];
+			_mm256_storeu_ps(lane_d, d);
+			for (int l = 0; l < 8; ++l) {
+				hits[n] = i + l;
+				sq_distances[n] = lane_d[l];
+				n += (inside >> l) & 1;
+			}
+		}
+#endif
+
+		for (; i < end; ++i) {
+			float dx = x[i] - target[0];
+			float dy = y[i] - target[1];
+			float dz = z[i] - target[2];
+			float d = dx * dx + dy * dy + dz * dz;
+			hits[n] = i;
+			sq_distances[n] = d;
+			n += d <= sqradius;
+		}
+	}
+	return n;
+}
+
+int MFX_ISA_NAME(countRepresentatives)(const int *assign, int begin, int end)
+{
+	int n = 0;
+	for (int i = begin; i < end; ++i) {
+		n += assign[i] == i;
+	}
+	return n;
+}
+
+void MFX_ISA_NAME(indexRepresentatives)(const int *assign, int begin, int end, int first_index, int *point_index)
+{
+	int i = begin;
+	int next = first_index;
+
+	// Prefix sums of the representative flags, computed in registers with
+	// log2(width) shifted adds
+#if defined(__AVX512F__)
+	// Masked forms with an explicit zero source avoid the undefined vectors of
+	// the plain intrinsics, which some compilers warn about
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __mmask16 all = static_cast<__mmask16>(0xffff);
+	for (; i + 16 <= end; i += 16) {
+		__m512i index = _mm512_add_epi32(_mm512_set1_epi32(i), lanes);
+		__mmask16 kept = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(assign + i), index);
+		__m512i flags = _mm512_maskz_set1_epi32(kept, 1);
+		__m512i sum = flags;
+		sum = _mm512_add_epi32(sum, _mm512_mask_alignr_epi32(zero, all, sum, zero, 15));
+		sum = _mm512_add_epi32(sum, _mm512_mask_alignr_epi32(zero, all, sum, zero, 14));
+		sum = _mm512_add_epi32(sum, _mm512_mask_alignr_epi32(zero, all, sum, zero, 12));
+		sum = _mm512_add_epi32(sum, _mm512_mask_alignr_epi32(zero, all, sum, zero, 8));
+		_mm512_storeu_si512(point_index + i, _mm512_add_epi32(_mm512_set1_epi32(next), _mm512_sub_epi32(sum, flags)));
+		next += _mm_popcnt_u32(kept);
+	}
+#elif defined(__AVX2__)
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i one = _mm256_set1_epi32(1);
+	for (; i + 8 <= end; i += 8) {
+		__m256i index = _mm256_add_epi32(_mm256_set1_epi32(i), lanes);
+		__m256i kept = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(assign + i)), index);
+		__m256i flags = _mm256_and_si256(kept, one);
+		// Scan within each 128 bit half, then add the low half total to the high half
+		__m256i sum = _mm256_add_epi32(flags, _mm256_slli_si256(flags, 4));
+		sum = _mm256_add_epi32(sum, _mm256_slli_si256(sum, 8));
+		__m256i low_total = _mm256_shuffle_epi32(_mm256_permute2x128_si256(sum, sum, 0x08), 0xff);
+		sum = _mm256_add_epi32(sum, low_total);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(point_index + i), _mm256_add_epi32(_mm256_set1_epi32(next), _mm256_sub_epi32(sum, flags)));
+		next += _mm_popcnt_u32(static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(kept))));
+	}
+#endif
+
+	for (; i < end; ++i) {
+		point_index[i] = next;
+		next += assign[i] == i;
+	}
+}
@@ -0,0 +1,57 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <MfxCommon/CpuDispatch.h>
+
+// Innermost loops of the merge, compiled once per instruction set level and
+// picked at runtime (see CpuDispatch.h). Every level returns exactly the same
+// results.
+
+/**
+ * Test the points of range_count ranges of the kd-tree, given in tree order
+ * by their first point and size, against a sphere of squared radius sqradius
+ * around target. Write the tree position of each point inside the sphere to
+ * hits and its squared distance to sq_distances, in tree order, and return
+ * how many there are. Outputs must have room for the total size of ranges.
+ */
+MFX_DECLARE_ISA_VARIANTS(int, scanPointRanges, (
+	const float *x, const float *y, const float *z,
+	const int *range_begin, const int *range_size, int range_count,
+	const float target[3], float sqradius,
+	int *hits, float *sq_distances));
+
+/**
+ * Number of points in [begin, end) that are their own representative, i.e.
+ * such that assign[i] == i.
+ */
+MFX_DECLARE_ISA_VARIANTS(int, countRepresentatives, (const int *assign, int begin, int end));
+
+/**
+ * Write to point_index[i], for each i in [begin, end), first_index plus the
+ * number of representatives in [begin, i). This is the output index of the
+ * point when it is a representative.
+ */
+MFX_DECLARE_ISA_VARIANTS(void, indexRepresentatives, (const int *assign, int begin, int end, int first_index, int *point_index));
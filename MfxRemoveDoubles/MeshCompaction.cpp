@@ -0,0 +1,414 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "MeshCompaction.h"
+#include "MergeKernels.h"
+
+#include <MfxCommon/CookProgress.h>
+#include <MfxCommon/FaceSize.h>
+#include <MfxCommon/Parallel.h>
+#include <MfxCommon/RadixSort.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+static constexpr int kPointGrain = 1 << 16;
+static constexpr int kFaceGrain = 1 << 14;
+
+MFX_DEFINE_ISA_DISPATCH(count_representatives, countRepresentatives)
+MFX_DEFINE_ISA_DISPATCH(index_representatives, indexRepresentatives)
+
+MeshCompaction::MeshCompaction(int thread_count, ScratchArena *arena)
+	: m_thread_count(resolveThreadCount(thread_count))
+	, m_arena(arena)
+	, m_assign(nullptr)
+	, m_point_count(0)
+	, m_face_count(0)
+	, m_constant_face_size(-1)
+	, m_point_index(arena)
+	, m_face_start(arena)
+	, m_output_face_start(arena)
+	, m_face_order(arena)
+	, m_output_point_count(0)
+	, m_output_corner_count(0)
+	, m_output_face_count(0)
+	, m_output_constant_face_size(-1)
+{}
+
+template <int kFaceSize, typename Emit>
+int MeshCompaction::forEachUniqueCorner(int face, std::vector<long long> & scratch, const Emit & emit) const
+{
+	if (kFaceSize > 0) {
+		// Triangles and quads: the loops are unrolled and each corner is
+		// compared with all the previous ones, without branching
+		int begin = face * kFaceSize;
+		int points[kFaceSize > 0 ? kFaceSize : 1];
+		bool unique[kFaceSize > 0 ? kFaceSize : 1];
+		int n = 0;
+		for (int j = 0; j < kFaceSize; ++j) {
+			points[j] = cornerPoint(begin + j);
+			bool duplicate = false;
+			for (int k = 0; k < j; ++k) {
+				duplicate |= points[k] == points[j];
+			}
+			unique[j] = !duplicate;
+			n += unique[j];
+		}
+		for (int j = 0; j < kFaceSize; ++j) {
+			if (unique[j]) emit(begin + j, points[j]);
+		}
+		return n;
+	}
+
+	int begin = faceStart(face);
+	int size = faceStart(face + 1) - begin;
+
+	if (size <= kSmallFaceSize) {
+		int seen[kSmallFaceSize];
+		int n = 0;
+		for (int j = 0; j < size; ++j) {
+			int p = cornerPoint(begin + j);
+			bool duplicate = false;
+			for (int k = 0; k < n; ++k) {
+				duplicate |= seen[k] == p;
+			}
+			if (!duplicate) {
+				seen[n++] = p;
+				emit(begin + j, p);
+			}
+		}
+		return n;
+	}
+
+	// Ngons: sort (point, position) pairs to find the first occurrence of
+	// each point, then emit them in their original order
+	scratch.resize(2 * static_cast<size_t>(size));
+	long long *keys = scratch.data();
+	long long *first = keys + size;
+	for (int j = 0; j < size; ++j) {
+		keys[j] = (static_cast<long long>(cornerPoint(begin + j)) << 32) | j;
+		first[j] = 0;
+	}
+	std::sort(keys, keys + size);
+	int n = 0;
+	for (int j = 0; j < size; ++j) {
+		if (j == 0 || (keys[j] >> 32) != (keys[j - 1] >> 32)) {
+			first[keys[j] & 0xffffffff] = 1;
+			++n;
+		}
+	}
+	for (int j = 0; j < size; ++j) {
+		if (first[j]) {
+			emit(begin + j, cornerPoint(begin + j));
+		}
+	}
+	return n;
+}
+
+template <typename Emit>
+void MeshCompaction::forEachOutputCorner(const Emit & emit) const
+{
+	int slot_count = slotCount();
+	int chunk_count = chunkCount(slot_count, kFaceGrain, m_thread_count);
+	dispatchFaceSize(m_constant_face_size, [&](auto face_size) {
+		constexpr int kFaceSize = decltype(face_size)::value;
+		parallelForChunks(chunk_count, [&](int chunk) {
+			std::vector<long long> scratch;
+			int end = chunkBegin(slot_count, chunk_count, chunk + 1);
+			for (int s = chunkBegin(slot_count, chunk_count, chunk); s < end; ++s) {
+				int out = m_output_face_start[s];
+				if (out == m_output_face_start[s + 1]) continue;
+				forEachUniqueCorner<kFaceSize>(slotFace(s), scratch, [&](int corner, int p) {
+					emit(out, corner, p);
+					++out;
+				});
+			}
+		});
+	});
+}
+
+template <typename Emit>
+void MeshCompaction::forEachOutputFace(const Emit & emit) const
+{
+	int slot_count = slotCount();
+	int chunk_count = chunkCount(slot_count, kFaceGrain, m_thread_count);
+	std::vector<int> chunk_start(chunk_count + 1, 0);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int kept = 0;
+		int end = chunkBegin(slot_count, chunk_count, chunk + 1);
+		for (int s = chunkBegin(slot_count, chunk_count, chunk); s < end; ++s) {
+			kept += m_output_face_start[s + 1] > m_output_face_start[s];
+		}
+		chunk_start[chunk + 1] = kept;
+	});
+	for (int c = 0; c < chunk_count; ++c) {
+		chunk_start[c + 1] += chunk_start[c];
+	}
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int out = chunk_start[chunk];
+		int end = chunkBegin(slot_count, chunk_count, chunk + 1);
+		for (int s = chunkBegin(slot_count, chunk_count, chunk); s < end; ++s) {
+			if (m_output_face_start[s + 1] == m_output_face_start[s]) continue;
+			emit(out, s);
+			++out;
+		}
+	});
+}
+
+void MeshCompaction::count(
+	const int *assign, int point_count,
+	const char *corner_data, int corner_stride, int corner_count,
+	const char *face_size_data, int face_size_stride, int face_count,
+	int constant_face_size)
+{
+	m_assign = assign;
+	m_corners = AttributeView<const int>(corner_data, corner_stride, corner_count);
+	m_face_sizes = AttributeView<const int>(face_size_data, face_size_stride, face_count);
+	m_point_count = point_count;
+	m_face_count = face_count;
+	m_constant_face_size = constant_face_size;
+	m_face_order.clear();
+
+	// Points that represent themselves are kept, in their original order.
+	// Each chunk counts its representatives, then numbers them from the
+	// total of the previous chunks.
+	m_point_index.resize(point_count);
+	int point_chunk_count = chunkCount(point_count, kPointGrain, m_thread_count);
+	std::vector<int> chunk_start(point_chunk_count + 1, 0);
+	parallelForChunks(point_chunk_count, [&](int chunk) {
+		int b = chunkBegin(point_count, point_chunk_count, chunk);
+		int e = chunkBegin(point_count, point_chunk_count, chunk + 1);
+		chunk_start[chunk + 1] = count_representatives()(assign, b, e);
+	});
+	for (int c = 0; c < point_chunk_count; ++c) {
+		chunk_start[c + 1] += chunk_start[c];
+	}
+	parallelForChunks(point_chunk_count, [&](int chunk) {
+		int b = chunkBegin(point_count, point_chunk_count, chunk);
+		int e = chunkBegin(point_count, point_chunk_count, chunk + 1);
+		index_representatives()(assign, b, e, chunk_start[chunk], m_point_index.data());
+	});
+	m_output_point_count = chunk_start[point_chunk_count];
+
+	// Faces of constant size start at implicit offsets
+	if (constant_face_size > 0) {
+		m_face_start.clear();
+	}
+	else {
+		m_face_start.resize(face_count + 1);
+		copyAttribute(m_face_sizes, AttributeView<int>::packed(m_face_start.data(), face_count), m_thread_count);
+		m_face_start[face_count] = parallelExclusiveScan(m_face_start.data(), face_count, m_thread_count);
+	}
+	assert(faceStart(face_count) == corner_count);
+	(void)corner_count;
+
+	// Faces that keep at least two corners are kept, and if faces have a
+	// constant size the output does too unless some of them shrank
+	m_output_face_start.resize(face_count + 1);
+	int chunk_count = chunkCount(face_count, kFaceGrain, m_thread_count);
+	std::vector<int> kept_faces(chunk_count), shrunk_faces(chunk_count);
+	dispatchFaceSize(constant_face_size, [&](auto face_size) {
+		constexpr int kFaceSize = decltype(face_size)::value;
+		parallelForChunks(chunk_count, [&](int chunk) {
+			std::vector<long long> scratch;
+			int kept = 0;
+			int shrunk = 0;
+			int begin = chunkBegin(face_count, chunk_count, chunk);
+			int end = chunkBegin(face_count, chunk_count, chunk + 1);
+			for (int f = begin; f < end; ++f) {
+				if ((f - begin) % kCheckpointGrain == kCheckpointGrain - 1 && cookCheckpoint(kCheckpointGrain)) {
+					// The cook is cancelled, the remaining faces are dropped
+					// so that the counts stay consistent
+					std::fill(m_output_face_start.begin() + f, m_output_face_start.begin() + end, 0);
+					break;
+				}
+				int n = forEachUniqueCorner<kFaceSize>(f, scratch, [](int, int) {});
+				m_output_face_start[f] = n > 1 ? n : 0;
+				kept += n > 1;
+				shrunk += n > 1 && n < constant_face_size;
+			}
+			kept_faces[chunk] = kept;
+			shrunk_faces[chunk] = shrunk;
+		});
+	});
+	m_output_corner_count = parallelExclusiveScan(m_output_face_start.data(), face_count, m_thread_count);
+	m_output_face_start[face_count] = m_output_corner_count;
+
+	m_output_face_count = 0;
+	int shrunk_face_count = 0;
+	for (int c = 0; c < chunk_count; ++c) {
+		m_output_face_count += kept_faces[c];
+		shrunk_face_count += shrunk_faces[c];
+	}
+	m_output_constant_face_size = constant_face_size > 0 && shrunk_face_count == 0 ? constant_face_size : -1;
+}
+
+void MeshCompaction::rebind(
+	const int *assign,
+	const char *corner_data, int corner_stride,
+	const char *face_size_data, int face_size_stride)
+{
+	m_assign = assign;
+	m_corners = AttributeView<const int>(corner_data, corner_stride, m_corners.size());
+	m_face_sizes = AttributeView<const int>(face_size_data, face_size_stride, m_face_sizes.size());
+}
+
+void MeshCompaction::reorderPoints(const int *point_order)
+{
+	// Same as the numbering of count(), following point_order
+	int chunk_count = chunkCount(m_point_count, kPointGrain, m_thread_count);
+	std::vector<int> chunk_start(chunk_count + 1, 0);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int kept = 0;
+		int end = chunkBegin(m_point_count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(m_point_count, chunk_count, chunk); i < end; ++i) {
+			int p = point_order[i];
+			kept += m_assign[p] == p;
+		}
+		chunk_start[chunk + 1] = kept;
+	});
+	for (int c = 0; c < chunk_count; ++c) {
+		chunk_start[c + 1] += chunk_start[c];
+	}
+	assert(chunk_start[chunk_count] == m_output_point_count);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int out = chunk_start[chunk];
+		int end = chunkBegin(m_point_count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(m_point_count, chunk_count, chunk); i < end; ++i) {
+			int p = point_order[i];
+			if (m_assign[p] == p) m_point_index[p] = out++;
+		}
+	});
+}
+
+void MeshCompaction::reorderFaces()
+{
+	if (!m_face_order.empty() || m_output_face_count == 0) return;
+
+	// Key of each output face, the output point of its first corner, which
+	// is always kept. With points in spatial order, this sorts faces about
+	// as well as their lowest point would, for a third of the reads.
+	ScratchVector<uint32_t> keys(m_output_face_count, 0, m_arena);
+	ScratchVector<int> face_order(m_output_face_count, 0, m_arena);
+	forEachOutputFace([&](int out, int f) {
+		keys[out] = static_cast<uint32_t>(m_point_index[cornerPoint(faceStart(f))]);
+		face_order[out] = f;
+	});
+	int key_bits = 1;
+	while (key_bits < 32 && (1u << key_bits) < static_cast<uint32_t>(m_output_point_count)) ++key_bits;
+	radixSort(keys.data(), face_order.data(), m_output_face_count, key_bits, m_thread_count, m_arena);
+
+	// Output faces become the slots
+	ScratchVector<int> output_face_start(m_output_face_count + 1, 0, m_arena);
+	parallelFor(0, m_output_face_count, kFaceGrain, m_thread_count, [&](int b, int e) {
+		for (int out = b; out < e; ++out) {
+			int f = face_order[out];
+			output_face_start[out] = m_output_face_start[f + 1] - m_output_face_start[f];
+		}
+	});
+	output_face_start[m_output_face_count] = parallelExclusiveScan(output_face_start.data(), m_output_face_count, m_thread_count);
+	m_output_face_start.swap(output_face_start);
+	m_face_order.swap(face_order);
+}
+
+void MeshCompaction::writePoints(const char *src, int src_stride, char *dst, int dst_stride, int element_size) const
+{
+	AttributeView<const char, 0> input(src, src_stride, m_point_count, element_size);
+	AttributeView<char, 0> output(dst, dst_stride, m_output_point_count, element_size);
+	parallelFor(0, m_point_count, kPointGrain, m_thread_count, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			if (m_assign[i] != i) continue;
+			memcpy(output[m_point_index[i]], input[i], element_size);
+		}
+	});
+}
+
+void MeshCompaction::writeCorners(char *dst, int dst_stride) const
+{
+	AttributeView<int> output(dst, dst_stride, m_output_corner_count);
+	forEachOutputCorner([&](int out, int, int p) {
+		*output[out] = m_point_index[p];
+	});
+}
+
+void MeshCompaction::writeFaceSizes(char *dst, int dst_stride) const
+{
+	AttributeView<int> output(dst, dst_stride, m_output_face_count);
+	forEachOutputFace([&](int out, int s) {
+		*output[out] = m_output_face_start[s + 1] - m_output_face_start[s];
+	});
+}
+
+void MeshCompaction::writePointSources(int *dst) const
+{
+	parallelFor(0, m_point_count, kPointGrain, m_thread_count, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			if (m_assign[i] == i) dst[m_point_index[i]] = i;
+		}
+	});
+}
+
+void MeshCompaction::writeCornerSources(int *dst) const
+{
+	forEachOutputCorner([&](int out, int corner, int) {
+		dst[out] = corner;
+	});
+}
+
+void MeshCompaction::writeFaceSources(int *dst) const
+{
+	forEachOutputFace([&](int out, int s) {
+		dst[out] = slotFace(s);
+	});
+}
+
+void MeshCompaction::writePointGroups(int *group_start, int *group_points) const
+{
+	// Sort input points by output point, the sort being stable groups list
+	// their points in increasing order
+	ScratchVector<uint32_t> keys(m_point_count, 0, m_arena);
+	parallelFor(0, m_point_count, kPointGrain, m_thread_count, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			keys[i] = static_cast<uint32_t>(m_point_index[m_assign[i]]);
+			group_points[i] = i;
+		}
+	});
+	int key_bits = 1;
+	while (key_bits < 32 && (1u << key_bits) < static_cast<uint32_t>(m_output_point_count)) ++key_bits;
+	radixSort(keys.data(), group_points, m_point_count, key_bits, m_thread_count, m_arena);
+
+	// Every output point has at least its representative
+	parallelFor(0, m_point_count, kPointGrain, m_thread_count, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			if (i == 0 || keys[i] != keys[i - 1]) group_start[keys[i]] = i;
+		}
+	});
+	group_start[m_output_point_count] = m_point_count;
+}
+
+size_t MeshCompaction::memoryUsage() const
+{
+	return (m_point_index.capacity() + m_face_start.capacity() + m_output_face_start.capacity() + m_face_order.capacity()) * sizeof(int);
+}
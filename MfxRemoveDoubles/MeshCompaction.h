@@ -0,0 +1,226 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/ScratchArena.h>
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Order of the output points and faces of a MeshCompaction
+ */
+enum class OutputOrder {
+	Input = 0, // points and faces keep their input order
+	SpatialPoints = 1, // points follow the order of a search structure
+	SpatialPointsAndFaces = 2, // faces are also sorted by their first point
+};
+
+/**
+ * Rebuilds the topology of a mesh once some of its points have been merged.
+ * Corners of a face that end up on the same point are collapsed, and faces
+ * left with less than two corners are removed.
+ *
+ * This runs as a count pass, which tells the size of the output mesh, then
+ * independent scatter passes that write each output attribute in place. Both
+ * are parallel and do not allocate per face.
+ *
+ * Output points and faces keep their input order, unless they are reordered
+ * in between, so that nearby points get nearby indices. Input meshes such as
+ * scans often list their points in no particular order, and every
+ * corner to point lookup then misses the cache.
+ */
+class MeshCompaction {
+public:
+	/**
+	 * If arena is not null, the tables and the buffers of the write passes
+	 * are allocated from it.
+	 */
+	explicit MeshCompaction(int thread_count = 0, ScratchArena *arena = nullptr);
+
+	/**
+	 * Count the output points, corners and faces. assign maps each point to
+	 * its representative, as returned by KDTree::equivalentAll. Input buffers
+	 * are read again by the write passes so they must outlive them.
+	 * If constant_face_size is positive, all faces have this many corners
+	 * and face_size_data is not read, it may be null.
+	 */
+	void count(
+		const int *assign, int point_count,
+		const char *corner_data, int corner_stride, int corner_count,
+		const char *face_size_data, int face_size_stride, int face_count,
+		int constant_face_size = -1);
+
+	/**
+	 * Point the write passes to new buffers holding the same merge map and
+	 * topology as the ones given to count(), so that its result can be
+	 * reused, e.g. across the frames of an animation.
+	 */
+	void rebind(
+		const int *assign,
+		const char *corner_data, int corner_stride,
+		const char *face_size_data, int face_size_stride);
+
+	/**
+	 * Number the output points in the order in which their representatives
+	 * appear in point_order, a permutation of the input points, typically the
+	 * order of the points in the search structure (see KDTree::pointOrder()).
+	 * Must be called after count() and before the write passes.
+	 */
+	void reorderPoints(const int *point_order);
+
+	/**
+	 * Sort the output faces by the output point of their first corner, in a
+	 * stable way, so that consecutive faces read nearby points. Must be
+	 * called after count(), and after reorderPoints() if points are
+	 * reordered.
+	 */
+	void reorderFaces();
+
+	int outputPointCount() const { return m_output_point_count; }
+	int outputCornerCount() const { return m_output_corner_count; }
+	int outputFaceCount() const { return m_output_face_count; }
+
+	/**
+	 * Size of all output faces if the input faces have a constant size and
+	 * none of them lost a corner without being removed, -1 otherwise. The
+	 * output then needs no face size attribute.
+	 */
+	int outputConstantFaceSize() const { return m_output_constant_face_size; }
+
+	/**
+	 * Number of bytes of the per point and per face tables
+	 */
+	size_t memoryUsage() const;
+
+	/**
+	 * Copy element_size bytes per point from src to dst for each point that
+	 * is kept, i.e. that represents itself.
+	 */
+	void writePoints(const char *src, int src_stride, char *dst, int dst_stride, int element_size) const;
+
+	/**
+	 * Write the output point index of each output corner
+	 */
+	void writeCorners(char *dst, int dst_stride) const;
+
+	/**
+	 * Write the size of each output face
+	 */
+	void writeFaceSizes(char *dst, int dst_stride) const;
+
+	/**
+	 * Write the input element each output point, corner or face comes from,
+	 * to carry other attributes over with a gather. dst must hold as many
+	 * ints as there are output elements.
+	 */
+	void writePointSources(int *dst) const;
+	void writeCornerSources(int *dst) const;
+	void writeFaceSources(int *dst) const;
+
+	/**
+	 * List the input points merged into each output point: those of output
+	 * point i are group_points[group_start[i]:group_start[i+1]], in
+	 * increasing order, so the first one is the representative.
+	 * group_start must hold outputPointCount() + 1 ints and group_points
+	 * one per input point.
+	 */
+	void writePointGroups(int *group_start, int *group_points) const;
+
+public:
+	// Faces up to this size are deduplicated in a fixed size buffer
+	static constexpr int kSmallFaceSize = 16;
+
+private:
+	int cornerPoint(int corner) const {
+		return m_assign[*m_corners[corner]];
+	}
+
+	int faceStart(int face) const {
+		return m_constant_face_size > 0 ? face * m_constant_face_size : m_face_start[face];
+	}
+
+	/**
+	 * Faces are listed as slots, which are the input faces, some of them
+	 * removed, or once faces are reordered the output faces.
+	 */
+	int slotCount() const {
+		return m_face_order.empty() ? m_face_count : m_output_face_count;
+	}
+
+	int slotFace(int slot) const {
+		return m_face_order.empty() ? slot : m_face_order[slot];
+	}
+
+	/**
+	 * Call emit(corner) for the first corner of face that lands on each
+	 * distinct merged point, in order, and return their count. scratch
+	 * holds ngon temporaries. kFaceSize is the size of all faces, or 0 if
+	 * it is read for each face (see FaceSize.h).
+	 */
+	template <int kFaceSize, typename Emit>
+	int forEachUniqueCorner(int face, std::vector<long long> & scratch, const Emit & emit) const;
+
+	/**
+	 * Call emit(output_corner, input_corner, merged_point) for each output
+	 * corner, in parallel
+	 */
+	template <typename Emit>
+	void forEachOutputCorner(const Emit & emit) const;
+
+	/**
+	 * Call emit(output_face, slot) for each face that is kept, in parallel
+	 */
+	template <typename Emit>
+	void forEachOutputFace(const Emit & emit) const;
+
+private:
+	int m_thread_count;
+	ScratchArena *m_arena;
+
+	const int *m_assign;
+	AttributeView<const int> m_corners;
+	AttributeView<const int> m_face_sizes;
+	int m_point_count;
+	int m_face_count;
+	int m_constant_face_size;
+
+	// Output index of each input point that represents itself
+	ScratchVector<int> m_point_index;
+	// First input corner of each input face, face_count + 1 elements, empty
+	// when faces have a constant size
+	ScratchVector<int> m_face_start;
+	// First output corner of each slot, slotCount() + 1 elements. Faces
+	// that are removed have no corner.
+	ScratchVector<int> m_output_face_start;
+	// Input face of each output face once faces are reordered, else empty
+	ScratchVector<int> m_face_order;
+
+	int m_output_point_count;
+	int m_output_corner_count;
+	int m_output_face_count;
+	int m_output_constant_face_size;
+};
@@ -0,0 +1,715 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "KDTree.h"
+#include "SpatialGrid.h"
+#include "MeshCompaction.h"
+#include "CookCache.h"
+#include "TemporalMerge.h"
+#include "TiledMerge.h"
+#include "AttributeGather.h"
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxEffect>
+
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/ContentHash.h>
+#include <MfxCommon/HostProgress.h>
+#include <MfxCommon/Profiling.h>
+#include <MfxCommon/TaskScheduler.h>
+#include <MfxCommon/ScratchArena.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+///////////////////////////////////////////////////////////////////////////////
+// Remove Doubles
+
+/**
+ * Value given to a point that other points are merged into
+ */
+enum class PointMerge {
+	Representative = 0, // the value of the point with the lowest index
+	Average = 1, // the average value of all merged points
+};
+
+/**
+ * Input attribute carried over to the output, besides the point position,
+ * corner point and face size which are always there
+ */
+struct carried_attribute_t {
+	MfxAttributeAttachment attachment;
+	const char *name;
+	MfxAttributeProps props;
+};
+
+/**
+ * What an instance keeps from one cook to the next
+ */
+struct instance_state_t {
+	CookCache cache;
+	TemporalMerge temporal;
+	// Scratch memory of the cooks, kept at the size of the largest one
+	ScratchArena arena;
+};
+
+class RemoveDoublesEffect : public MfxEffect {
+public:
+	const char* GetName() override
+	{ return "RemoveDoubles"; }
+
+protected:
+	OfxStatus Describe(OfxMeshEffectHandle descriptor) override {
+		AddInput(kOfxMeshMainInput);
+		AddInput("target")
+			.Label("Weld Target");
+		AddInput(kOfxMeshMainOutput);
+
+		AddParam("threshold", 0.0001)
+			.Label("Threshold");
+
+		AddParam("backend", static_cast<int>(MergeBackend::Auto))
+			.Label("Backend (0: Auto, 1: KD-Tree, 2: Grid)")
+			.Range(0, 2);
+
+		AddParam("point_merge", static_cast<int>(PointMerge::Representative))
+			.Label("Merged Point Attributes (0: Representative, 1: Average)")
+			.Range(0, 1);
+
+		AddParam("output_order", static_cast<int>(OutputOrder::Input))
+			.Label("Output Order (0: Input, 1: Spatial Points, 2: Spatial Points and Faces)")
+			.Range(0, 2);
+
+		AddParam("search_memory", 0)
+			.Label("Search Memory (MB, 0: no limit, merge in tiles above)")
+			.Range(0, 1 << 20);
+
+		AddParam("cache", false)
+			.Label("Cache Results");
+
+		AddParam("cache_size", 256)
+			.Label("Cache Size (MB)")
+			.Range(0, 65536);
+
+		AddParam("animated", false)
+			.Label("Animated (keep the tree across frames)");
+
+		AddParam("weld_to_target", false)
+			.Label("Weld to Target (snap points onto the target mesh first)");
+
+		AddParam("threads", 0)
+			.Label("Threads (0: all, as allowed by MFX_THREADS)")
+			.Range(0, 1024);
+
+		return kOfxStatOK;
+	}
+
+	OfxStatus CreateInstance(OfxMeshEffectHandle instance) override {
+		std::lock_guard<std::mutex> lock(m_instances_mutex);
+		m_instances[instance] = std::make_unique<instance_state_t>();
+		return kOfxStatOK;
+	}
+
+	OfxStatus DestroyInstance(OfxMeshEffectHandle instance) override {
+		std::lock_guard<std::mutex> lock(m_instances_mutex);
+		m_instances.erase(instance);
+		return kOfxStatOK;
+	}
+
+	OfxStatus Cook(OfxMeshEffectHandle instance) override {
+		CookProfile profile(GetName());
+		HostProgress progress(host(), instance, GetName());
+		ThreadCapScope thread_cap(GetParam<int>("threads").GetValue());
+		profileCounter("threads", threadCap());
+
+		OfxStatus status = cookMerge(instance);
+		if (progress.cancelled()) {
+			// The scratch memory and what previous frames kept are freed, now
+			// that nothing uses them, as the host may not cook this again
+			instance_state_t *state = instanceState(instance);
+			if (nullptr != state) {
+				state->temporal.reset();
+				state->arena.release();
+			}
+			profileCounter("cancelled", 1);
+			return kOfxStatFailed;
+		}
+		return status;
+	}
+
+private:
+	/**
+	 * The body of Cook(), which gives up as soon as the cook is cancelled,
+	 * leaving the output mesh empty
+	 */
+	OfxStatus cookMerge(OfxMeshEffectHandle instance) {
+		// 0. Get input data
+		ProfileScope fetch_scope("fetch");
+		MfxMesh inputMesh = GetInput(kOfxMeshMainInput).GetMesh();
+		MfxMesh outputMesh = GetInput(kOfxMeshMainOutput).GetMesh();
+		double threshold = GetParam<double>("threshold").GetValue();
+		MergeBackend backend = static_cast<MergeBackend>(GetParam<int>("backend").GetValue());
+		bool use_cache = GetParam<bool>("cache").GetValue();
+		int cache_size = GetParam<int>("cache_size").GetValue();
+		bool animated = GetParam<bool>("animated").GetValue();
+		bool weld_to_target = GetParam<bool>("weld_to_target").GetValue();
+		PointMerge point_merge = static_cast<PointMerge>(GetParam<int>("point_merge").GetValue());
+		OutputOrder output_order = static_cast<OutputOrder>(GetParam<int>("output_order").GetValue());
+		size_t search_memory = static_cast<size_t>(std::max(0, GetParam<int>("search_memory").GetValue())) << 20;
+
+		MfxMeshProps inputMeshProps;
+		inputMesh.FetchProperties(inputMeshProps);
+
+		MfxAttribute inputPos = inputMesh.GetPointAttribute(kOfxMeshAttribPointPosition);
+		MfxAttributeProps inputPosProps;
+		inputPos.FetchProperties(inputPosProps);
+
+		MfxAttribute inputCorner = inputMesh.GetCornerAttribute(kOfxMeshAttribCornerPoint);
+		MfxAttributeProps inputCornerProps;
+		inputCorner.FetchProperties(inputCornerProps);
+
+		// Faces of triangle and quad meshes may all have constantFaceSize
+		// corners, and then the face size attribute is not read
+		int constantFaceSize = inputMeshProps.constantFaceSize;
+		MfxAttributeProps inputFaceSizeProps = {};
+		if (constantFaceSize <= 0) {
+			inputMesh.GetFaceAttribute(kOfxMeshAttribFaceSize).FetchProperties(inputFaceSizeProps);
+		}
+
+		std::vector<carried_attribute_t> attributes = carriedAttributes(inputMesh);
+
+		MfxMesh targetMesh;
+		MfxAttributeProps targetPosProps = {};
+		int targetPointCount = 0;
+		if (weld_to_target) {
+			targetMesh = GetInput("target").GetMesh();
+			if (targetMesh.IsValid()) {
+				MfxMeshProps targetMeshProps;
+				targetMesh.FetchProperties(targetMeshProps);
+				targetMesh.GetPointAttribute(kOfxMeshAttribPointPosition).FetchProperties(targetPosProps);
+				targetPointCount = targetMeshProps.pointCount;
+			}
+		}
+		fetch_scope.stop();
+
+		float radius = static_cast<float>(threshold);
+
+		instance_state_t *state = instanceState(instance);
+
+		// Points whose search structure would not fit in search_memory are
+		// merged tile by tile, which gives the same result
+		int tile_points = TiledMerge::tilePoints(inputMeshProps.pointCount, search_memory);
+		bool tiled = tile_points > 0;
+
+		// Cooking the same input again only copies the previous output. With
+		// animated on, a spatial output order follows the tree kept from
+		// earlier frames, refitted rather than built, so the same input may
+		// be numbered differently depending on the frames before it, and
+		// nothing is cached.
+		bool spatial_animated = nullptr != state && animated && output_order != OutputOrder::Input;
+		CookCache *cache = use_cache && nullptr != state && !spatial_animated ? &state->cache : nullptr;
+		cook_key_t key = {};
+		if (nullptr != cache) {
+			ProfileScope scope("hash");
+			cache->setMemoryCap(static_cast<size_t>(std::max(0, cache_size)) << 20);
+			key.point_count = inputMeshProps.pointCount;
+			key.corner_count = inputMeshProps.cornerCount;
+			key.face_count = inputMeshProps.faceCount;
+			key.threshold = radius;
+			key.point_merge = static_cast<int>(point_merge);
+			key.output_order = static_cast<int>(output_order);
+			if (output_order != OutputOrder::Input) {
+				key.backend = static_cast<int>(backend);
+				key.tile_points = tile_points;
+			}
+			key.hash = hashStrided(inputPosProps.data, inputPosProps.stride, 3 * sizeof(float), key.point_count, 1);
+			key.hash = hashStrided(inputCornerProps.data, inputCornerProps.stride, sizeof(int), key.corner_count, key.hash);
+			if (constantFaceSize > 0) {
+				key.hash = hashCombine(key.hash, static_cast<uint64_t>(constantFaceSize));
+			}
+			else {
+				key.hash = hashStrided(inputFaceSizeProps.data, inputFaceSizeProps.stride, sizeof(int), key.face_count, key.hash);
+			}
+			for (const carried_attribute_t & attribute : attributes) {
+				const MfxAttributeProps & props = attribute.props;
+				key.hash = hashCombine(key.hash, hashBytes(attribute.name, strlen(attribute.name)));
+				key.hash = hashCombine(key.hash, static_cast<uint64_t>(attribute.attachment) << 32 | static_cast<uint64_t>(props.type) << 16 | static_cast<uint64_t>(props.componentCount));
+				int element_size = attributeComponentSize(props.type) * props.componentCount;
+				key.hash = hashStrided(props.data, props.stride, element_size, elementCount(inputMeshProps, attribute.attachment), key.hash);
+			}
+			key.hash = hashCombine(key.hash, static_cast<uint64_t>(targetPointCount));
+			key.hash = hashStrided(targetPosProps.data, targetPosProps.stride, 3 * sizeof(float), targetPointCount, key.hash);
+			scope.stop();
+
+			const cook_result_t *result = cache->find(key);
+			profileCounter("cache hits", cache->hitCount());
+			profileCounter("cache misses", cache->missCount());
+			if (nullptr != result) {
+				if (targetMesh.IsValid()) targetMesh.Release();
+				inputMesh.Release();
+				return cookFromCache(outputMesh, *result);
+			}
+		}
+
+		// Temporary arrays are drawn from memory kept by the instance, so that
+		// cooking again does not map new pages
+		ScratchArena local_arena;
+		ScratchArena *arena = nullptr != state ? &state->arena : &local_arena;
+		arena->reset();
+
+		// Points close enough to the target mesh are first snapped onto it,
+		// and from there on the merge reads the snapped positions
+		MfxAttributeProps sourcePosProps = inputPosProps;
+		ScratchVector<float> snapped_positions(arena);
+		if (targetPointCount > 0) {
+			ProfileScope scope("weld");
+			cookStage(0.1, targetPointCount);
+			snapped_positions.resize(3 * static_cast<size_t>(inputMeshProps.pointCount));
+			int welded = snapToTarget(inputMeshProps.pointCount, inputPosProps, targetPointCount, targetPosProps, radius, snapped_positions.data(), arena);
+			sourcePosProps.data = reinterpret_cast<char*>(snapped_positions.data());
+			sourcePosProps.stride = 3 * sizeof(float);
+			profileCounter("points welded", welded);
+		}
+		if (targetMesh.IsValid()) targetMesh.Release();
+		if (cookCancelled()) return cancelCook(inputMesh, outputMesh);
+
+		// 1. Find points to merge
+		ScratchVector<int> assign(arena);
+		MeshCompaction local_compaction(0, arena);
+		const MeshCompaction *compaction = &local_compaction;
+		size_t scratch_bytes = 0;
+		if (nullptr != state && animated) {
+			// Frames of an animation reuse the tree, and possibly the
+			// compaction, of the previous cook. Only the kd-tree supports it.
+			TemporalMerge & temporal = state->temporal;
+			cookStage(0.8, 2 * static_cast<int64_t>(inputMeshProps.pointCount) + inputMeshProps.faceCount);
+			compaction = &temporal.update(
+				inputMeshProps.pointCount, sourcePosProps.data, sourcePosProps.stride,
+				inputCornerProps.data, inputCornerProps.stride, inputMeshProps.cornerCount,
+				inputFaceSizeProps.data, inputFaceSizeProps.stride, inputMeshProps.faceCount,
+				constantFaceSize, radius, output_order
+			);
+			profileCounter("nodes visited", temporal.visitCount());
+			profileCounter("tree rebuilt", temporal.rebuiltTree());
+			profileCounter("compaction reused", temporal.reusedCompaction());
+			scratch_bytes = temporal.memoryUsage();
+		}
+		else {
+			if (nullptr != state) {
+				// Free what previous frames kept, if animated was on
+				state->temporal.reset();
+			}
+
+			assign.resize(inputMeshProps.pointCount);
+
+			bounds_t bounds = {};
+			if (!tiled && backend != MergeBackend::KDTree) {
+				ProfileScope scope("bounds");
+				bounds = SpatialGrid::computeBounds(inputMeshProps.pointCount, sourcePosProps.data, sourcePosProps.stride);
+			}
+			if (!tiled && backend == MergeBackend::Auto) {
+				bool use_grid = SpatialGrid::isSuitable(inputMeshProps.pointCount, bounds, radius);
+				backend = use_grid ? MergeBackend::Grid : MergeBackend::KDTree;
+			}
+
+			// Output points may be numbered in the order of the search
+			// structure, which is copied before the structure goes
+			ScratchVector<int> point_order(arena);
+			if (output_order != OutputOrder::Input) {
+				point_order.resize(inputMeshProps.pointCount);
+			}
+			auto copy_point_order = [&](const int *order) {
+				int n = static_cast<int>(point_order.size());
+				copyAttribute(AttributeView<const int>::packed(order, n), AttributeView<int>::packed(point_order.data(), n));
+			};
+
+			int64_t visit_count = 0;
+			scratch_bytes = (assign.capacity() + point_order.capacity()) * sizeof(int);
+			size_t search_mark = arena->mark();
+			if (tiled) {
+				ProfileScope scope("tiled search");
+				cookStage(0.7, 2 * static_cast<int64_t>(inputMeshProps.pointCount));
+				TiledMerge merge(inputMeshProps.pointCount, sourcePosProps.data, sourcePosProps.stride, 0, arena);
+				merge.equivalentAll(radius, tile_points, backend, assign.data(), point_order.empty() ? nullptr : point_order.data());
+				profileCounter("tiles", merge.tileCount());
+				profileCounter("points shared by tiles", merge.sharedPointCount());
+				profileCounter("largest tile", merge.largestTile());
+				profileCounter("nodes visited", merge.visitCount());
+				scratch_bytes += merge.memoryUsage();
+			}
+			else if (backend == MergeBackend::Grid) {
+				ProfileScope build_scope("grid build");
+				cookStage(0.2, 0);
+				SpatialGrid grid(inputMeshProps.pointCount, sourcePosProps.data, sourcePosProps.stride, bounds, radius, 0, arena);
+				build_scope.stop();
+				ProfileScope scope("assign");
+				cookStage(0.7, inputMeshProps.pointCount);
+				grid.equivalentAll(radius, assign.data(), &visit_count);
+				copy_point_order(grid.pointOrder());
+				profileCounter("cells visited", visit_count);
+				scratch_bytes += grid.memoryUsage();
+			}
+			else {
+				ProfileScope build_scope("tree build");
+				cookStage(0.35, inputMeshProps.pointCount);
+				KDTree tree(inputMeshProps.pointCount, sourcePosProps.data, sourcePosProps.stride, 0, arena);
+				build_scope.stop();
+				ProfileScope scope("assign");
+				cookStage(0.7, inputMeshProps.pointCount);
+				tree.equivalentAll(radius, assign.data(), &visit_count);
+				// A tree whose build was cancelled is emptied, and has no order
+				if (!tree.empty()) {
+					copy_point_order(tree.pointOrder());
+				}
+				profileCounter("nodes visited", visit_count);
+				scratch_bytes += tree.memoryUsage();
+			}
+			// The search structure is gone, the compaction tables reuse its
+			// memory
+			arena->rewind(search_mark);
+
+			if (cookCancelled()) return cancelCook(inputMesh, outputMesh);
+
+			// 2. Count output elements
+			ProfileScope compaction_scope("compaction");
+			cookStage(0.8, inputMeshProps.faceCount);
+			local_compaction.count(
+				assign.data(), inputMeshProps.pointCount,
+				inputCornerProps.data, inputCornerProps.stride, inputMeshProps.cornerCount,
+				inputFaceSizeProps.data, inputFaceSizeProps.stride, inputMeshProps.faceCount,
+				constantFaceSize
+			);
+			compaction_scope.stop();
+
+			if (output_order != OutputOrder::Input) {
+				ProfileScope scope("reorder");
+				local_compaction.reorderPoints(point_order.data());
+				if (output_order == OutputOrder::SpatialPointsAndFaces) {
+					local_compaction.reorderFaces();
+				}
+			}
+			scratch_bytes += local_compaction.memoryUsage();
+		}
+
+		// Past this point the cook runs to the end, filling the output takes
+		// a fraction of the time spent so far
+		if (cookCancelled()) return cancelCook(inputMesh, outputMesh);
+		cookStage(1.0, 0);
+
+		int outputPointCount = compaction->outputPointCount();
+		int outputCornerCount = compaction->outputCornerCount();
+		int outputFaceCount = compaction->outputFaceCount();
+		int outputConstantFaceSize = compaction->outputConstantFaceSize();
+		profileCounter("points removed", inputMeshProps.pointCount - outputPointCount);
+		profileCounter("corners removed", inputMeshProps.cornerCount - outputCornerCount);
+		profileCounter("faces removed", inputMeshProps.faceCount - outputFaceCount);
+		profileCounter("scratch bytes", static_cast<int64_t>(scratch_bytes));
+		profileCounter("constant face size", outputConstantFaceSize);
+
+		// 3. Allocate output, with the same attributes as the input
+		ProfileScope allocate_scope("allocate");
+		for (const carried_attribute_t & attribute : attributes) {
+			const MfxAttributeProps & props = attribute.props;
+			outputMesh.AddAttribute(attribute.attachment, attribute.name, props.componentCount, props.type, props.semantic);
+		}
+		outputMesh.Allocate(outputPointCount, outputCornerCount, outputFaceCount, true, outputConstantFaceSize);
+
+		MfxAttribute outputPos = outputMesh.GetPointAttribute(kOfxMeshAttribPointPosition);
+		MfxAttributeProps outputPosProps;
+		outputPos.FetchProperties(outputPosProps);
+
+		MfxAttribute outputCorner = outputMesh.GetCornerAttribute(kOfxMeshAttribCornerPoint);
+		MfxAttributeProps outputCornerProps;
+		outputCorner.FetchProperties(outputCornerProps);
+
+		MfxAttributeProps outputFaceSizeProps = {};
+		if (outputConstantFaceSize <= 0) {
+			outputMesh.GetFaceAttribute(kOfxMeshAttribFaceSize).FetchProperties(outputFaceSizeProps);
+		}
+
+		std::vector<MfxAttributeProps> outputAttributeProps(attributes.size());
+		for (size_t i = 0; i < attributes.size(); ++i) {
+			MfxAttribute output = outputAttribute(outputMesh, attributes[i].attachment, attributes[i].name);
+			output.FetchProperties(outputAttributeProps[i]);
+		}
+		allocate_scope.stop();
+
+		// 4. Fill output
+		ProfileScope fill_scope("fill");
+		compaction->writeCorners(outputCornerProps.data, outputCornerProps.stride);
+		if (outputConstantFaceSize <= 0) {
+			compaction->writeFaceSizes(outputFaceSizeProps.data, outputFaceSizeProps.stride);
+		}
+
+		// Every other attribute is gathered from the input through maps from
+		// output elements to input elements, all in a single parallel batch
+		bool has_attachment[4] = {};
+		for (const carried_attribute_t & attribute : attributes) {
+			has_attachment[static_cast<int>(attribute.attachment)] = true;
+		}
+		bool average = point_merge == PointMerge::Average && outputPointCount < inputMeshProps.pointCount;
+		ScratchVector<int> point_sources(arena), group_start(arena), group_points(arena), corner_sources(arena), face_sources(arena);
+		if (average) {
+			group_start.resize(outputPointCount + 1);
+			group_points.resize(inputMeshProps.pointCount);
+			compaction->writePointGroups(group_start.data(), group_points.data());
+		}
+		else {
+			point_sources.resize(outputPointCount);
+			compaction->writePointSources(point_sources.data());
+		}
+		if (has_attachment[static_cast<int>(MfxAttributeAttachment::Corner)]) {
+			corner_sources.resize(outputCornerCount);
+			compaction->writeCornerSources(corner_sources.data());
+		}
+		if (has_attachment[static_cast<int>(MfxAttributeAttachment::Face)]) {
+			face_sources.resize(outputFaceCount);
+			compaction->writeFaceSources(face_sources.data());
+		}
+
+		auto make_gather = [&](MfxAttributeAttachment attachment, const MfxAttributeProps & src, const MfxAttributeProps & dst) {
+			attribute_gather_t gather = {};
+			gather.type = src.type;
+			gather.component_count = src.componentCount;
+			gather.src = src.data;
+			gather.src_stride = src.stride;
+			gather.src_count = elementCount(inputMeshProps, attachment);
+			gather.dst = dst.data;
+			gather.dst_stride = dst.stride;
+			gather.count = elementCount(outputPointCount, outputCornerCount, outputFaceCount, attachment);
+			switch (attachment) {
+			case MfxAttributeAttachment::Point:
+				gather.sources = point_sources.data();
+				if (average) {
+					gather.group_start = group_start.data();
+					gather.group_elements = group_points.data();
+				}
+				break;
+			case MfxAttributeAttachment::Corner:
+				gather.sources = corner_sources.data();
+				break;
+			case MfxAttributeAttachment::Face:
+				gather.sources = face_sources.data();
+				break;
+			default:
+				break;
+			}
+			return gather;
+		};
+
+		std::vector<attribute_gather_t> gathers;
+		gathers.push_back(make_gather(MfxAttributeAttachment::Point, sourcePosProps, outputPosProps));
+		for (size_t i = 0; i < attributes.size(); ++i) {
+			gathers.push_back(make_gather(attributes[i].attachment, attributes[i].props, outputAttributeProps[i]));
+		}
+		gatherAttributes(gathers);
+		fill_scope.stop();
+		profileCounter("attributes", static_cast<int64_t>(gathers.size()));
+
+		if (nullptr != cache) {
+			ProfileScope scope("cache store");
+			cook_result_t result;
+			result.positions.resize(3 * static_cast<size_t>(outputPointCount));
+			result.corner_points.resize(outputCornerCount);
+			result.face_count = outputFaceCount;
+			result.constant_face_size = outputConstantFaceSize;
+			copyAttribute(attributeView<const float, 3>(outputPosProps, outputPointCount), AttributeView<float, 3>::packed(result.positions.data(), outputPointCount));
+			copyAttribute(attributeView<const int>(outputCornerProps, outputCornerCount), AttributeView<int>::packed(result.corner_points.data(), outputCornerCount));
+			if (outputConstantFaceSize <= 0) {
+				result.face_sizes.resize(outputFaceCount);
+				copyAttribute(attributeView<const int>(outputFaceSizeProps, outputFaceCount), AttributeView<int>::packed(result.face_sizes.data(), outputFaceCount));
+			}
+			result.attributes.resize(attributes.size());
+			for (size_t i = 0; i < attributes.size(); ++i) {
+				const MfxAttributeProps & props = outputAttributeProps[i];
+				cached_attribute_t & cached = result.attributes[i];
+				cached.attachment = attributes[i].attachment;
+				cached.name = attributes[i].name;
+				cached.type = props.type;
+				cached.component_count = props.componentCount;
+				cached.semantic = props.semantic;
+				int element_size = attributeComponentSize(props.type) * props.componentCount;
+				int count = elementCount(outputPointCount, outputCornerCount, outputFaceCount, cached.attachment);
+				cached.data.resize(static_cast<size_t>(element_size) * count);
+				copyElements(props.data, props.stride, cached.data.data(), element_size, element_size, count);
+			}
+			cache->insert(key, std::move(result));
+			profileCounter("cache bytes", static_cast<int64_t>(cache->memoryUsage()));
+		}
+
+		profileCounter("arena bytes", static_cast<int64_t>(arena->capacity()));
+		profileCounter("arena peak", static_cast<int64_t>(arena->peakUsage()));
+		profileCounter("arena chunks", arena->chunkCount());
+
+		ProfileScope release_scope("release");
+		inputMesh.Release();
+		outputMesh.Release();
+		return kOfxStatOK;
+	}
+
+	/**
+	 * Attributes of the input mesh other than the mandatory ones, skipping
+	 * those whose type is unknown
+	 */
+	static std::vector<carried_attribute_t> carriedAttributes(MfxMesh & mesh) {
+		std::vector<carried_attribute_t> attributes;
+		int attribute_count = mesh.GetAttributeCount();
+		for (int i = 0; i < attribute_count; ++i) {
+			MfxAttribute attribute = mesh.GetAttributeByIndex(i);
+			carried_attribute_t carried;
+			carried.attachment = attribute.GetAttachment();
+			carried.name = attribute.GetName();
+			attribute.FetchProperties(carried.props);
+
+			bool mandatory =
+				(carried.attachment == MfxAttributeAttachment::Point && 0 == strcmp(carried.name, kOfxMeshAttribPointPosition))
+				|| (carried.attachment == MfxAttributeAttachment::Corner && 0 == strcmp(carried.name, kOfxMeshAttribCornerPoint))
+				|| (carried.attachment == MfxAttributeAttachment::Face && 0 == strcmp(carried.name, kOfxMeshAttribFaceSize));
+			if (mandatory || attributeComponentSize(carried.props.type) == 0) continue;
+			attributes.push_back(carried);
+		}
+		return attributes;
+	}
+
+	/**
+	 * Write to snapped the positions of the points, each moved onto the
+	 * nearest target point if it lies within radius. Returns the number of
+	 * points moved.
+	 */
+	static int snapToTarget(
+		int point_count, const MfxAttributeProps & positions,
+		int target_count, const MfxAttributeProps & target_positions,
+		float radius, float *snapped, ScratchArena *arena)
+	{
+		KDTree tree(target_count, target_positions.data, target_positions.stride, 0, arena);
+		if (cookCancelled()) return 0;
+		neighbor_lists_t nearest;
+		tree.knnSearch(point_count, positions.data, positions.stride, 1, nearest);
+
+		AttributeView<const float, 3> input = attributeView<const float, 3>(positions, point_count);
+		AttributeView<const float, 3> target = attributeView<const float, 3>(target_positions, target_count);
+		AttributeView<float, 3> output = AttributeView<float, 3>::packed(snapped, point_count);
+		float sqradius = radius * radius;
+		std::atomic<int> moved(0);
+		parallelFor(0, point_count, kAttributeGrain, 0, [&](int b, int e) {
+			int n = 0;
+			for (int i = b; i < e; ++i) {
+				bool snap = nearest.sq_distances[i] <= sqradius;
+				const float *p = snap ? target[nearest.indices[i]] : input[i];
+				float *q = output[i];
+				q[0] = p[0];
+				q[1] = p[1];
+				q[2] = p[2];
+				n += snap;
+			}
+			moved += n;
+		});
+		return moved;
+	}
+
+	static MfxAttribute outputAttribute(MfxMesh & mesh, MfxAttributeAttachment attachment, const char *name) {
+		switch (attachment) {
+		case MfxAttributeAttachment::Point: return mesh.GetPointAttribute(name);
+		case MfxAttributeAttachment::Corner: return mesh.GetCornerAttribute(name);
+		case MfxAttributeAttachment::Face: return mesh.GetFaceAttribute(name);
+		default: return mesh.GetMeshAttribute(name);
+		}
+	}
+
+	static int elementCount(int point_count, int corner_count, int face_count, MfxAttributeAttachment attachment) {
+		switch (attachment) {
+		case MfxAttributeAttachment::Point: return point_count;
+		case MfxAttributeAttachment::Corner: return corner_count;
+		case MfxAttributeAttachment::Face: return face_count;
+		default: return 1;
+		}
+	}
+
+	static int elementCount(const MfxMeshProps & props, MfxAttributeAttachment attachment) {
+		return elementCount(props.pointCount, props.cornerCount, props.faceCount, attachment);
+	}
+
+	instance_state_t *instanceState(OfxMeshEffectHandle instance) {
+		std::lock_guard<std::mutex> lock(m_instances_mutex);
+		auto it = m_instances.find(instance);
+		return it == m_instances.end() ? nullptr : it->second.get();
+	}
+
+	/**
+	 * Give up a cancelled cook, releasing both meshes like a complete one
+	 */
+	OfxStatus cancelCook(MfxMesh & inputMesh, MfxMesh & outputMesh) {
+		inputMesh.Release();
+		outputMesh.Release();
+		return kOfxStatFailed;
+	}
+
+	/**
+	 * Fill the output mesh with a previously cooked result
+	 */
+	OfxStatus cookFromCache(MfxMesh & outputMesh, const cook_result_t & result) {
+		ProfileScope allocate_scope("allocate");
+		for (const cached_attribute_t & attribute : result.attributes) {
+			outputMesh.AddAttribute(attribute.attachment, attribute.name.c_str(), attribute.component_count, attribute.type, attribute.semantic);
+		}
+		outputMesh.Allocate(result.pointCount(), result.cornerCount(), result.faceCount(), true, result.constant_face_size);
+
+		MfxAttributeProps outputPosProps, outputCornerProps, outputFaceSizeProps = {};
+		outputMesh.GetPointAttribute(kOfxMeshAttribPointPosition).FetchProperties(outputPosProps);
+		outputMesh.GetCornerAttribute(kOfxMeshAttribCornerPoint).FetchProperties(outputCornerProps);
+		if (result.constant_face_size <= 0) {
+			outputMesh.GetFaceAttribute(kOfxMeshAttribFaceSize).FetchProperties(outputFaceSizeProps);
+		}
+		allocate_scope.stop();
+
+		ProfileScope fill_scope("fill");
+		copyAttribute(AttributeView<const float, 3>::packed(result.positions.data(), result.pointCount()), attributeView<float, 3>(outputPosProps, result.pointCount()));
+		copyAttribute(AttributeView<const int>::packed(result.corner_points.data(), result.cornerCount()), attributeView<int>(outputCornerProps, result.cornerCount()));
+		if (result.constant_face_size <= 0) {
+			copyAttribute(AttributeView<const int>::packed(result.face_sizes.data(), result.faceCount()), attributeView<int>(outputFaceSizeProps, result.faceCount()));
+		}
+		for (const cached_attribute_t & attribute : result.attributes) {
+			MfxAttributeProps props;
+			outputAttribute(outputMesh, attribute.attachment, attribute.name.c_str()).FetchProperties(props);
+			int element_size = attributeComponentSize(attribute.type) * attribute.component_count;
+			int count = elementCount(result.pointCount(), result.cornerCount(), result.faceCount(), attribute.attachment);
+			copyElements(attribute.data.data(), element_size, props.data, props.stride, element_size, count);
+		}
+		fill_scope.stop();
+
+		ProfileScope release_scope("release");
+		outputMesh.Release();
+		return kOfxStatOK;
+	}
+
+private:
+	// Instances may cook concurrently, but never one instance twice at once
+	std::mutex m_instances_mutex;
+	std::unordered_map<OfxMeshEffectHandle, std::unique_ptr<instance_state_t>> m_instances;
+};
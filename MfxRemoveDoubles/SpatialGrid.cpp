@@ -0,0 +1,341 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "SpatialGrid.h"
+#include "UnionFind.h"
+
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/CookProgress.h>
+#include <MfxCommon/Parallel.h>
+#include <MfxCommon/RadixSort.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using Real = SpatialGrid::Real;
+
+static constexpr int kGrain = 1 << 16;
+
+/**
+ * Squared euclidian distance between two points, computed exactly like in
+ * KDTree so that both backends accept the same pairs.
+ */
+static inline Real dist(Real ax, Real ay, Real az, Real bx, Real by, Real bz)
+{
+	Real dx = ax - bx;
+	Real dy = ay - by;
+	Real dz = az - bz;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+/**
+ * Insert two zero bits between each of the 21 lowest bits of v
+ */
+static inline uint64_t spread_bits(uint64_t v)
+{
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffffull;
+	v = (v | v << 16) & 0x1f0000ff0000ffull;
+	v = (v | v << 8) & 0x100f00f00f00f00full;
+	v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+	v = (v | v << 2) & 0x1249249249249249ull;
+	return v;
+}
+
+static inline uint32_t compact_bits(uint64_t v)
+{
+	v &= 0x1249249249249249ull;
+	v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ull;
+	v = (v ^ (v >> 4)) & 0x100f00f00f00f00full;
+	v = (v ^ (v >> 8)) & 0x1f0000ff0000ffull;
+	v = (v ^ (v >> 16)) & 0x1f00000000ffffull;
+	v = (v ^ (v >> 32)) & 0x1fffffull;
+	return static_cast<uint32_t>(v);
+}
+
+static inline uint64_t morton_code(uint32_t x, uint32_t y, uint32_t z)
+{
+	return spread_bits(x) | (spread_bits(y) << 1) | (spread_bits(z) << 2);
+}
+
+bounds_t SpatialGrid::computeBounds(int point_count, const char *point_data, int stride, int thread_count)
+{
+	bounds_t bounds;
+	for (int k = 0; k < 3; ++k) {
+		bounds.lower[k] = FLT_MAX;
+		bounds.upper[k] = -FLT_MAX;
+	}
+	if (point_count <= 0) return bounds;
+
+	AttributeView<const Real, 3> points(point_data, stride, point_count);
+	return parallelReduce(0, point_count, kGrain, thread_count, bounds, [&](int begin, int end) {
+		bounds_t b = bounds;
+		for (int i = begin; i < end; ++i) {
+			const Real *p = points[i];
+			for (int k = 0; k < 3; ++k) {
+				b.lower[k] = std::min(b.lower[k], p[k]);
+				b.upper[k] = std::max(b.upper[k], p[k]);
+			}
+		}
+		return b;
+	}, [](bounds_t a, const bounds_t & b) {
+		for (int k = 0; k < 3; ++k) {
+			a.lower[k] = std::min(a.lower[k], b.lower[k]);
+			a.upper[k] = std::max(a.upper[k], b.upper[k]);
+		}
+		return a;
+	});
+}
+
+bool SpatialGrid::isSuitable(int point_count, const bounds_t & bounds, Real radius)
+{
+	if (point_count < kMinSuitablePointCount) return false;
+
+	Real extent = 0;
+	for (int k = 0; k < 3; ++k) {
+		extent = std::max(extent, bounds.upper[k] - bounds.lower[k]);
+	}
+	if (!(extent > 0) || !(radius > 0)) return false;
+
+	// Cells would have to be enlarged beyond the radius to fit in the keys
+	Real ratio = radius / extent;
+	if (ratio * (1 << kBitsPerAxis) < 1) return false;
+
+	// Assume points are sampled on surfaces, as for scans and CAD models, so
+	// that the number of points per cell grows with the square of the ratio
+	return ratio * ratio * static_cast<Real>(point_count) <= kMaxSuitableOccupancy;
+}
+
+SpatialGrid::SpatialGrid(int point_count, const char *point_data, int stride, const bounds_t & bounds, Real cell_size, int thread_count, ScratchArena *arena)
+	: m_thread_count(resolveThreadCount(thread_count))
+	, m_cell_keys(arena)
+	, m_cell_start(arena)
+	, m_x(arena)
+	, m_y(arena)
+	, m_z(arena)
+	, m_point_index(arena)
+{
+	if (point_count <= 0) return;
+	int threads = m_thread_count;
+
+	// Pad cells so that rounding in cell coordinates never pushes two points
+	// accepted by dist() more than one cell apart
+	Real extent = 0, magnitude = 0;
+	for (int k = 0; k < 3; ++k) {
+		extent = std::max(extent, bounds.upper[k] - bounds.lower[k]);
+		magnitude = std::max(magnitude, std::max(std::abs(bounds.lower[k]), std::abs(bounds.upper[k])));
+	}
+	Real max_cells = static_cast<Real>((1 << kBitsPerAxis) - 1);
+	m_cell_size = std::max(cell_size * 1.0001f + 8 * FLT_EPSILON * magnitude, extent / max_cells);
+	if (!(m_cell_size > 0)) m_cell_size = 1;
+	Real inv_cell_size = 1 / m_cell_size;
+
+	int bits_per_axis = 1;
+	while (bits_per_axis < kBitsPerAxis && static_cast<Real>(1 << bits_per_axis) <= extent * inv_cell_size + 1) {
+		++bits_per_axis;
+	}
+
+	// Sort points by cell, points of a cell remain in index order
+	AttributeView<const Real, 3> points(point_data, stride, point_count);
+	m_point_index.resize(point_count);
+	m_x.resize(point_count);
+	m_y.resize(point_count);
+	m_z.resize(point_count);
+	ScratchVector<uint64_t> keys(point_count, 0, arena);
+	parallelFor(0, point_count, kGrain, threads, [&](int b, int e) {
+		uint32_t max_coord = (1u << kBitsPerAxis) - 1;
+		for (int i = b; i < e; ++i) {
+			const Real *p = points[i];
+			uint32_t c[3];
+			for (int k = 0; k < 3; ++k) {
+				Real v = (p[k] - bounds.lower[k]) * inv_cell_size;
+				c[k] = v >= 0 ? std::min(static_cast<uint32_t>(v), max_coord) : 0;
+			}
+			keys[i] = morton_code(c[0], c[1], c[2]);
+			m_point_index[i] = i;
+		}
+	});
+	radixSort(keys.data(), m_point_index.data(), point_count, 3 * bits_per_axis, threads, arena);
+
+	parallelFor(0, point_count, kGrain, threads, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			const Real *p = points[m_point_index[i]];
+			m_x[i] = p[0];
+			m_y[i] = p[1];
+			m_z[i] = p[2];
+		}
+	});
+
+	// Occupied cells are the runs of equal keys
+	int chunk_count = chunkCount(point_count, kGrain, threads);
+	std::vector<int> chunk_cells(chunk_count + 1);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int n = 0;
+		int end = chunkBegin(point_count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(point_count, chunk_count, chunk); i < end; ++i) {
+			n += i == 0 || keys[i] != keys[i - 1];
+		}
+		chunk_cells[chunk + 1] = n;
+	});
+	for (int c = 0; c < chunk_count; ++c) {
+		chunk_cells[c + 1] += chunk_cells[c];
+	}
+	int cell_count = chunk_cells[chunk_count];
+	m_cell_keys.resize(cell_count);
+	m_cell_start.resize(cell_count + 1);
+	m_cell_start[cell_count] = point_count;
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int cell = chunk_cells[chunk];
+		int end = chunkBegin(point_count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(point_count, chunk_count, chunk); i < end; ++i) {
+			if (i == 0 || keys[i] != keys[i - 1]) {
+				m_cell_keys[cell] = keys[i];
+				m_cell_start[cell] = i;
+				++cell;
+			}
+		}
+	});
+}
+
+int SpatialGrid::findCell(uint64_t key, int hint) const
+{
+	// Neighbour cells are most often close in Morton order, so gallop from
+	// the current cell rather than searching the whole key array
+	const uint64_t *keys = m_cell_keys.data();
+	int cell_count = cellCount();
+	int lo, hi;
+	if (keys[hint] < key) {
+		int step = 1;
+		lo = hint + 1;
+		hi = lo;
+		while (hi < cell_count && keys[hi] < key) {
+			lo = hi + 1;
+			hi += step;
+			step *= 2;
+		}
+		hi = std::min(hi + 1, cell_count);
+	}
+	else {
+		int step = 1;
+		hi = hint;
+		lo = hi;
+		while (lo > 0 && keys[lo - 1] >= key) {
+			hi = lo;
+			lo = std::max(0, lo - step);
+			step *= 2;
+		}
+	}
+	const uint64_t *it = std::lower_bound(keys + lo, keys + hi, key);
+	return it != keys + cell_count && *it == key ? static_cast<int>(it - keys) : -1;
+}
+
+void SpatialGrid::equivalentAll(Real radius, int *assign, int64_t *visit_count) const {
+	int point_count = pointCount();
+	if (point_count == 0) return;
+
+	UnionFind sets(point_count, m_thread_count);
+	Real sqradius = radius * radius;
+
+	// Half of the 26 neighbours, each pair of adjacent cells is visited once
+	int offsets[13][3];
+	int offset_count = 0;
+	for (int dz = -1; dz <= 1; ++dz) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dz > 0 || (dz == 0 && (dy > 0 || (dy == 0 && dx > 0)))) {
+					offsets[offset_count][0] = dx;
+					offsets[offset_count][1] = dy;
+					offsets[offset_count][2] = dz;
+					++offset_count;
+				}
+			}
+		}
+	}
+
+	const int max_coord = (1 << kBitsPerAxis) - 1;
+	std::atomic<int64_t> total_visits(0);
+	parallelFor(0, cellCount(), 1 << 10, m_thread_count, [&](int b, int e) {
+		int64_t visits = 0;
+		int reported = m_cell_start[b];
+		for (int cell = b; cell < e; ++cell) {
+			int begin = m_cell_start[cell], end = m_cell_start[cell + 1];
+			if ((cell - b) % kCheckpointGrain == kCheckpointGrain - 1) {
+				// Progress is counted in points, cells hold a varying number
+				if (cookCheckpoint(begin - reported)) break;
+				reported = begin;
+			}
+
+			for (int i = begin; i < end; ++i) {
+				for (int j = i + 1; j < end; ++j) {
+					if (dist(m_x[i], m_y[i], m_z[i], m_x[j], m_y[j], m_z[j]) <= sqradius) {
+						sets.unite(m_point_index[i], m_point_index[j]);
+					}
+				}
+			}
+
+			uint64_t key = m_cell_keys[cell];
+			int c[3] = {
+				static_cast<int>(compact_bits(key)),
+				static_cast<int>(compact_bits(key >> 1)),
+				static_cast<int>(compact_bits(key >> 2))
+			};
+			for (int o = 0; o < offset_count; ++o) {
+				int n[3];
+				bool inside = true;
+				for (int k = 0; k < 3; ++k) {
+					n[k] = c[k] + offsets[o][k];
+					inside = inside && n[k] >= 0 && n[k] <= max_coord;
+				}
+				if (!inside) continue;
+				int other = findCell(morton_code(n[0], n[1], n[2]), cell);
+				if (other < 0) continue;
+				++visits;
+
+				int other_begin = m_cell_start[other], other_end = m_cell_start[other + 1];
+				for (int i = begin; i < end; ++i) {
+					for (int j = other_begin; j < other_end; ++j) {
+						if (dist(m_x[i], m_y[i], m_z[i], m_x[j], m_y[j], m_z[j]) <= sqradius) {
+							sets.unite(m_point_index[i], m_point_index[j]);
+						}
+					}
+				}
+			}
+		}
+		total_visits.fetch_add(visits, std::memory_order_relaxed);
+	});
+
+	sets.flatten(assign, m_thread_count);
+	if (nullptr != visit_count) *visit_count = total_visits.load();
+}
+
+size_t SpatialGrid::memoryUsage() const
+{
+	return m_cell_keys.capacity() * sizeof(uint64_t)
+		+ m_cell_start.capacity() * sizeof(int)
+		+ (m_x.capacity() + m_y.capacity() + m_z.capacity()) * sizeof(Real)
+		+ m_point_index.capacity() * sizeof(int);
+}
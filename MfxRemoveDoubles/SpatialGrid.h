@@ -0,0 +1,115 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <MfxCommon/ScratchArena.h>
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Axis aligned bounding box of a point cloud
+ */
+struct bounds_t {
+	float lower[3];
+	float upper[3];
+};
+
+/**
+ * Uniform grid over a point cloud, an alternative to KDTree to merge points
+ * closer than a fixed radius. Points are sorted by the Morton code of their
+ * cell so that each occupied cell is a contiguous range, and since cells are
+ * at least as large as the radius only the 27 cells around a point can hold
+ * points to merge with.
+ */
+class SpatialGrid {
+public:
+	using Real = float;
+
+	/**
+	 * Build a grid of cells at least cell_size wide over the point_count
+	 * points whose xyz float coordinates are read from point_data, separated
+	 * by stride bytes. Positions are copied, in cell order.
+	 * If arena is not null, the grid and its construction buffers are
+	 * allocated from it, as for KDTree.
+	 */
+	SpatialGrid(int point_count, const char *point_data, int stride, const bounds_t & bounds, Real cell_size, int thread_count = 0, ScratchArena *arena = nullptr);
+
+	/**
+	 * Same contract as KDTree::equivalentAll, and gives the very same output.
+	 * radius must not be larger than the cell size given at construction.
+	 * If visit_count is not null, it receives the number of pairs of
+	 * neighbour cells compared.
+	 */
+	void equivalentAll(Real radius, int *assign, int64_t *visit_count = nullptr) const;
+
+	int pointCount() const { return static_cast<int>(m_point_index.size()); }
+
+	/**
+	 * Original index of each point, in the Morton order of their cells
+	 */
+	const int *pointOrder() const { return m_point_index.data(); }
+	int cellCount() const { return static_cast<int>(m_cell_keys.size()); }
+
+	/**
+	 * Number of bytes held by the grid (cell ranges and cell-ordered points)
+	 */
+	size_t memoryUsage() const;
+
+	static bounds_t computeBounds(int point_count, const char *point_data, int stride, int thread_count = 0);
+
+	/**
+	 * Whether the grid is expected to be faster than a KDTree to merge points
+	 * lying in bounds at the given radius. The grid pays off on large point
+	 * sets as long as cells do not get crowded.
+	 */
+	static bool isSuitable(int point_count, const bounds_t & bounds, Real radius);
+
+public:
+	static constexpr int kBitsPerAxis = 21;
+	static constexpr int kMinSuitablePointCount = 1 << 17;
+	// Expected number of points per cell above which the grid is not used
+	static constexpr float kMaxSuitableOccupancy = 16;
+
+private:
+	/**
+	 * Index of the cell with the given key, or -1 if it is empty. The search
+	 * starts from cell hint.
+	 */
+	int findCell(uint64_t key, int hint) const;
+
+private:
+	int m_thread_count;
+	Real m_cell_size;
+	// Sorted Morton codes of the occupied cells
+	ScratchVector<uint64_t> m_cell_keys;
+	// Range of points of each cell, cellCount() + 1 elements
+	ScratchVector<int> m_cell_start;
+	// Point coordinates in cell order, as three contiguous arrays (SoA)
+	ScratchVector<Real> m_x, m_y, m_z;
+	// Original index of each point, in cell order
+	ScratchVector<int> m_point_index;
+};
@@ -0,0 +1,141 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "TemporalMerge.h"
+
+#include <MfxCommon/ContentHash.h>
+#include <MfxCommon/Parallel.h>
+#include <MfxCommon/Profiling.h>
+
+TemporalMerge::TemporalMerge(int thread_count)
+	: m_thread_count(resolveThreadCount(thread_count))
+	, m_reference_visit_count(0)
+	, m_needs_rebuild(true)
+	, m_radius(0)
+	, m_compaction(thread_count)
+	, m_has_compaction(false)
+	, m_topology_hash(0)
+	, m_corner_count(0)
+	, m_face_count(0)
+	, m_output_order(OutputOrder::Input)
+	, m_rebuilt_tree(false)
+	, m_reused_compaction(false)
+	, m_visit_count(0)
+{}
+
+const MeshCompaction & TemporalMerge::update(
+	int point_count, const char *point_data, int point_stride,
+	const char *corner_data, int corner_stride, int corner_count,
+	const char *face_size_data, int face_size_stride, int face_count,
+	int constant_face_size, float radius, OutputOrder output_order)
+{
+	// 1. Refit the tree of the previous frame, unless it degraded
+	m_rebuilt_tree = m_needs_rebuild || !m_tree || m_tree->pointCount() != point_count;
+	if (m_rebuilt_tree) {
+		ProfileScope scope("tree build");
+		m_tree = std::make_unique<KDTree>(point_count, point_data, point_stride, m_thread_count);
+		m_needs_rebuild = false;
+	}
+	else {
+		ProfileScope scope("tree refit");
+		m_tree->refit(point_data, point_stride);
+	}
+
+	ProfileScope assign_scope("assign");
+	m_next_assign.resize(point_count);
+	m_tree->equivalentAll(radius, m_next_assign.data(), &m_visit_count);
+	assign_scope.stop();
+
+	// The number of visits also depends on the radius, so the reference is
+	// taken again when it changes
+	if (m_rebuilt_tree || radius != m_radius) {
+		m_reference_visit_count = m_visit_count;
+		m_radius = radius;
+	}
+	else if (m_visit_count > kMaxVisitRatio * m_reference_visit_count) {
+		m_needs_rebuild = true;
+	}
+
+	// 2. Reuse the compaction if nothing it depends on changed
+	ProfileScope compaction_scope("compaction");
+	uint64_t topology_hash = hashStrided(corner_data, corner_stride, sizeof(int), corner_count, 0, m_thread_count);
+	if (constant_face_size > 0) {
+		topology_hash = hashCombine(topology_hash, static_cast<uint64_t>(constant_face_size));
+	}
+	else {
+		topology_hash = hashStrided(face_size_data, face_size_stride, sizeof(int), face_count, topology_hash, m_thread_count);
+	}
+
+	m_reused_compaction =
+		m_has_compaction
+		&& topology_hash == m_topology_hash
+		&& corner_count == m_corner_count
+		&& face_count == m_face_count
+		&& output_order == m_output_order
+		&& (output_order == OutputOrder::Input || !m_rebuilt_tree)
+		&& m_next_assign == m_assign;
+
+	m_assign.swap(m_next_assign);
+	if (m_reused_compaction) {
+		m_compaction.rebind(m_assign.data(), corner_data, corner_stride, face_size_data, face_size_stride);
+	}
+	else {
+		m_compaction.count(
+			m_assign.data(), point_count,
+			corner_data, corner_stride, corner_count,
+			face_size_data, face_size_stride, face_count,
+			constant_face_size
+		);
+		// A tree whose build was cancelled is emptied, and has no order
+		if (output_order != OutputOrder::Input && !m_tree->empty()) {
+			m_compaction.reorderPoints(m_tree->pointOrder());
+			if (output_order == OutputOrder::SpatialPointsAndFaces) {
+				m_compaction.reorderFaces();
+			}
+		}
+		m_has_compaction = true;
+		m_topology_hash = topology_hash;
+		m_corner_count = corner_count;
+		m_face_count = face_count;
+		m_output_order = output_order;
+	}
+
+	return m_compaction;
+}
+
+void TemporalMerge::reset()
+{
+	m_tree.reset();
+	m_needs_rebuild = true;
+	m_has_compaction = false;
+	m_assign = std::vector<int>();
+	m_next_assign = std::vector<int>();
+}
+
+size_t TemporalMerge::memoryUsage() const
+{
+	return (m_tree ? m_tree->memoryUsage() : 0)
+		+ (m_assign.capacity() + m_next_assign.capacity()) * sizeof(int)
+		+ m_compaction.memoryUsage();
+}
@@ -0,0 +1,98 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include "KDTree.h"
+#include "MeshCompaction.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Merges the points of successive frames of an animated mesh, whose point
+ * count and topology usually stay the same while positions move. The kd-tree
+ * of a frame is refitted to the next one rather than rebuilt, until queries
+ * get too slow compared to a fresh tree, and the topology compaction is
+ * reused as long as neither the merge map nor the input topology changed.
+ * Any frame gives the very same result as a standalone cook, except for the
+ * numbering of the output when it follows the spatial order of the tree: it
+ * then stays the same from one frame to the next until the tree is rebuilt.
+ */
+class TemporalMerge {
+public:
+	explicit TemporalMerge(int thread_count = 0);
+
+	/**
+	 * Merge the points of a new frame, same arguments as KDTree and
+	 * MeshCompaction::count(). The returned compaction is valid until the
+	 * next update, as are the input buffers it reads. Its output is ordered
+	 * as output_order tells, after the order of the tree.
+	 */
+	const MeshCompaction & update(
+		int point_count, const char *point_data, int point_stride,
+		const char *corner_data, int corner_stride, int corner_count,
+		const char *face_size_data, int face_size_stride, int face_count,
+		int constant_face_size, float radius, OutputOrder output_order = OutputOrder::Input);
+
+	/**
+	 * Drop the state of previous frames
+	 */
+	void reset();
+
+	bool rebuiltTree() const { return m_rebuilt_tree; }
+	bool reusedCompaction() const { return m_reused_compaction; }
+	int64_t visitCount() const { return m_visit_count; }
+
+	/**
+	 * Number of bytes kept from one frame to the next
+	 */
+	size_t memoryUsage() const;
+
+public:
+	// The tree is rebuilt once a query visits this many times more nodes
+	// than it did right after the last build
+	static constexpr double kMaxVisitRatio = 1.5;
+
+private:
+	int m_thread_count;
+	std::unique_ptr<KDTree> m_tree;
+	int64_t m_reference_visit_count;
+	bool m_needs_rebuild;
+	float m_radius;
+
+	std::vector<int> m_assign;
+	std::vector<int> m_next_assign;
+	MeshCompaction m_compaction;
+	bool m_has_compaction;
+	uint64_t m_topology_hash;
+	int m_corner_count;
+	int m_face_count;
+	OutputOrder m_output_order;
+
+	bool m_rebuilt_tree;
+	bool m_reused_compaction;
+	int64_t m_visit_count;
+};
@@ -0,0 +1,292 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#include "TiledMerge.h"
+#include "KDTree.h"
+#include "SpatialGrid.h"
+#include "UnionFind.h"
+
+#include <MfxCommon/CookProgress.h>
+#include <MfxCommon/Parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static constexpr int kGrain = 1 << 16;
+
+using ConstPointView = AttributeView<const float, 3>;
+
+/**
+ * Points of sorted[begin, end) whose coordinate along axis lies within
+ * [lower, upper], written in order to out if it is not null. Returns how many
+ * there are.
+ */
+static int select_in_band(const int *sorted, int begin, int end, const ConstPointView & points, int axis, double lower, double upper, int *out, int thread_count)
+{
+	int count = end - begin;
+	if (count <= 0) return 0;
+	int chunk_count = chunkCount(count, kGrain, thread_count);
+	std::vector<int> offsets(chunk_count + 1, 0);
+	auto in_band = [&](int i) {
+		double x = points[sorted[i]][axis];
+		return x >= lower && x <= upper;
+	};
+
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int n = 0;
+		int chunk_end = begin + chunkBegin(count, chunk_count, chunk + 1);
+		for (int i = begin + chunkBegin(count, chunk_count, chunk); i < chunk_end; ++i) {
+			n += static_cast<int>(in_band(i));
+		}
+		offsets[chunk + 1] = n;
+	});
+	for (int c = 0; c < chunk_count; ++c) {
+		offsets[c + 1] += offsets[c];
+	}
+	if (nullptr == out) return offsets[chunk_count];
+
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int *o = out + offsets[chunk];
+		int chunk_end = begin + chunkBegin(count, chunk_count, chunk + 1);
+		for (int i = begin + chunkBegin(count, chunk_count, chunk); i < chunk_end; ++i) {
+			if (in_band(i)) *o++ = sorted[i];
+		}
+	});
+	return offsets[chunk_count];
+}
+
+TiledMerge::TiledMerge(int point_count, const char *point_data, int stride, int thread_count, ScratchArena *arena)
+	: m_points(point_data, stride, point_count)
+	, m_thread_count(resolveThreadCount(thread_count))
+	, m_arena(arena)
+	, m_tile_count(0)
+	, m_shared_point_count(0)
+	, m_largest_tile(0)
+	, m_visit_count(0)
+	, m_memory_usage(0)
+{}
+
+int TiledMerge::tilePoints(int point_count, size_t memory_cap)
+{
+	size_t n = static_cast<size_t>(std::max(0, point_count));
+	if (memory_cap == 0 || n * kBytesPerPoint <= memory_cap) return 0;
+	size_t set_bytes = n * kSetBytesPerPoint;
+	size_t tile_bytes = memory_cap > set_bytes ? memory_cap - set_bytes : 0;
+	size_t tile_points = std::max<size_t>(kMinTilePoints, tile_bytes / kBytesPerPoint);
+	return static_cast<int>(std::min(n, tile_points));
+}
+
+void TiledMerge::equivalentAll(Real radius, int max_tile_points, MergeBackend backend, int *assign, int *point_order)
+{
+	int point_count = m_points.size();
+	m_tile_count = 0;
+	m_shared_point_count = 0;
+	m_largest_tile = 0;
+	m_visit_count = 0;
+	m_memory_usage = 0;
+	if (point_count == 0) return;
+
+	// 1. Slabs along the longest axis, cut between the bins of a histogram
+	// of the coordinates. Points whose bounds cannot be split, e.g. because
+	// some are infinite, all go to a single slab.
+	bounds_t bounds = SpatialGrid::computeBounds(point_count, m_points.data(), m_points.stride(), m_thread_count);
+	int axis = 0;
+	for (int k = 1; k < 3; ++k) {
+		if (bounds.upper[k] - bounds.lower[k] > bounds.upper[axis] - bounds.lower[axis]) axis = k;
+	}
+	double lower = bounds.lower[axis];
+	double extent = static_cast<double>(bounds.upper[axis]) - lower;
+	bool split = point_count > max_tile_points && std::isfinite(extent) && extent > 0;
+	double bin_width = split ? extent / kHistogramBins : 0.0;
+	double bins_per_unit = split ? kHistogramBins / extent : 0.0;
+	auto bin_of = [&](int i) {
+		// NaN coordinates go to the first bin, they never merge anyway
+		double t = (m_points[i][axis] - lower) * bins_per_unit;
+		return t > 0 ? (t < kHistogramBins ? static_cast<int>(t) : kHistogramBins - 1) : 0;
+	};
+
+	int chunk_count = chunkCount(point_count, kGrain, m_thread_count);
+	std::vector<int> histogram(kHistogramBins, 0);
+	if (split) {
+		std::vector<std::vector<int>> chunk_histograms(chunk_count);
+		parallelForChunks(chunk_count, [&](int chunk) {
+			std::vector<int> & h = chunk_histograms[chunk];
+			h.assign(kHistogramBins, 0);
+			int end = chunkBegin(point_count, chunk_count, chunk + 1);
+			for (int i = chunkBegin(point_count, chunk_count, chunk); i < end; ++i) {
+				++h[bin_of(i)];
+			}
+		});
+		parallelFor(0, kHistogramBins, 1 << 12, m_thread_count, [&](int b, int e) {
+			for (const std::vector<int> & h : chunk_histograms) {
+				for (int bin = b; bin < e; ++bin) {
+					histogram[bin] += h[bin];
+				}
+			}
+		});
+	}
+	else {
+		histogram[0] = point_count;
+	}
+
+	// Bins are taken in order until the next one would overflow the slab
+	std::vector<int> slab_of_bin(kHistogramBins);
+	std::vector<int> first_bin = { 0 };
+	int slab_size = 0;
+	for (int bin = 0; bin < kHistogramBins; ++bin) {
+		if (slab_size > 0 && slab_size + histogram[bin] > max_tile_points) {
+			first_bin.push_back(bin);
+			slab_size = 0;
+		}
+		slab_of_bin[bin] = static_cast<int>(first_bin.size()) - 1;
+		slab_size += histogram[bin];
+	}
+	int slab_count = static_cast<int>(first_bin.size());
+	first_bin.push_back(kHistogramBins);
+	m_tile_count = slab_count;
+
+	// 2. Sort point indices by slab, into assign that is only written at the
+	// end. The sort is stable, so each slab lists its points in index order.
+	int *sorted = assign;
+	std::vector<int> slab_begin(slab_count + 1, 0);
+	std::vector<int> chunk_offsets(static_cast<size_t>(chunk_count) * slab_count, 0);
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int *counts = &chunk_offsets[static_cast<size_t>(chunk) * slab_count];
+		int end = chunkBegin(point_count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(point_count, chunk_count, chunk); i < end; ++i) {
+			++counts[slab_of_bin[bin_of(i)]];
+		}
+	});
+	int offset = 0;
+	for (int s = 0; s < slab_count; ++s) {
+		slab_begin[s] = offset;
+		for (int chunk = 0; chunk < chunk_count; ++chunk) {
+			int & o = chunk_offsets[static_cast<size_t>(chunk) * slab_count + s];
+			int n = o;
+			o = offset;
+			offset += n;
+		}
+	}
+	slab_begin[slab_count] = offset;
+	parallelForChunks(chunk_count, [&](int chunk) {
+		int *offsets = &chunk_offsets[static_cast<size_t>(chunk) * slab_count];
+		int end = chunkBegin(point_count, chunk_count, chunk + 1);
+		for (int i = chunkBegin(point_count, chunk_count, chunk); i < end; ++i) {
+			sorted[offsets[slab_of_bin[bin_of(i)]]++] = i;
+		}
+	});
+
+	// 3. Search each slab along with the points of the others that lie
+	// within radius of it, and join the groups it finds. Bin boundaries are
+	// widened by a bin since the coordinates of the points of a bin are only
+	// known up to rounding, so tiles may hold a few more points than needed,
+	// which is harmless.
+	UnionFind sets(point_count, m_thread_count, m_arena);
+	auto slab_lower = [&](int s) { return lower + first_bin[s] * bin_width; };
+	auto slab_upper = [&](int s) { return lower + first_bin[s + 1] * bin_width; };
+	bool cancelled = false;
+	for (int s = 0; s < slab_count && !cancelled; ++s) {
+		double band_lower = split ? slab_lower(s) - bin_width - radius : -HUGE_VAL;
+		double band_upper = split ? slab_upper(s) + bin_width + radius : HUGE_VAL;
+
+		// Slabs below and above whose points may lie in the band
+		int first_slab = s, last_slab = s;
+		while (first_slab > 0 && slab_upper(first_slab - 1) + bin_width >= band_lower) --first_slab;
+		while (last_slab + 1 < slab_count && slab_lower(last_slab + 1) - bin_width <= band_upper) ++last_slab;
+
+		int core_count = slab_begin[s + 1] - slab_begin[s];
+		int tile_count = core_count;
+		for (int t = first_slab; t <= last_slab; ++t) {
+			if (t == s) continue;
+			tile_count += select_in_band(sorted, slab_begin[t], slab_begin[t + 1], m_points, axis, band_lower, band_upper, nullptr, m_thread_count);
+		}
+
+		size_t tile_mark = nullptr != m_arena ? m_arena->mark() : 0;
+		{
+			// Points of the slab come first, then the shared ones
+			ScratchVector<int> ids(tile_count, m_arena);
+			std::copy(sorted + slab_begin[s], sorted + slab_begin[s + 1], ids.begin());
+			int shared = core_count;
+			for (int t = first_slab; t <= last_slab; ++t) {
+				if (t == s) continue;
+				shared += select_in_band(sorted, slab_begin[t], slab_begin[t + 1], m_points, axis, band_lower, band_upper, ids.data() + shared, m_thread_count);
+			}
+
+			ScratchVector<Real> positions(3 * static_cast<size_t>(tile_count), m_arena);
+			AttributeView<Real, 3> tile_points = AttributeView<Real, 3>::packed(positions.data(), tile_count);
+			gatherAttribute(m_points, tile_points, ids.data(), m_thread_count);
+
+			ScratchVector<int> local_assign(tile_count, m_arena);
+			const char *tile_data = reinterpret_cast<const char*>(positions.data());
+			bounds_t tile_bounds = {};
+			bool use_grid = backend == MergeBackend::Grid;
+			if (backend != MergeBackend::KDTree) {
+				tile_bounds = SpatialGrid::computeBounds(tile_count, tile_data, 3 * sizeof(Real), m_thread_count);
+				use_grid = use_grid || SpatialGrid::isSuitable(tile_count, tile_bounds, radius);
+			}
+
+			// Points of the slab are numbered tile after tile in the order
+			// of the search structure
+			int64_t visits = 0;
+			size_t structure_bytes = 0;
+			auto write_order = [&](const int *order) {
+				if (nullptr == point_order) return;
+				int *o = point_order + slab_begin[s];
+				for (int j = 0; j < tile_count; ++j) {
+					if (order[j] < core_count) *o++ = ids[order[j]];
+				}
+			};
+			if (use_grid) {
+				SpatialGrid grid(tile_count, tile_data, 3 * sizeof(Real), tile_bounds, radius, m_thread_count, m_arena);
+				grid.equivalentAll(radius, local_assign.data(), &visits);
+				if (!cookCancelled()) write_order(grid.pointOrder());
+				structure_bytes = grid.memoryUsage();
+			}
+			else {
+				KDTree tree(tile_count, tile_data, 3 * sizeof(Real), m_thread_count, m_arena);
+				tree.equivalentAll(radius, local_assign.data(), &visits);
+				if (!cookCancelled()) write_order(tree.pointOrder());
+				structure_bytes = tree.memoryUsage();
+			}
+			// The search of a cancelled cook leaves local_assign incomplete
+			cancelled = cookCancelled();
+			if (!cancelled) {
+				parallelFor(0, tile_count, kGrain, m_thread_count, [&](int b, int e) {
+					for (int j = b; j < e; ++j) {
+						if (local_assign[j] != j) sets.unite(ids[j], ids[local_assign[j]]);
+					}
+				});
+			}
+
+			m_shared_point_count += tile_count - core_count;
+			m_largest_tile = std::max(m_largest_tile, tile_count);
+			m_visit_count += visits;
+			m_memory_usage = std::max(m_memory_usage, UnionFind::bytes(point_count) + structure_bytes + static_cast<size_t>(tile_count) * 5 * sizeof(int));
+		}
+		if (nullptr != m_arena) m_arena->rewind(tile_mark);
+	}
+
+	sets.flatten(assign, m_thread_count);
+}
@@ -0,0 +1,133 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/ScratchArena.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Spatial structure used to find the points to merge, both give the same
+ * result.
+ */
+enum class MergeBackend {
+	Auto = 0,
+	KDTree = 1,
+	Grid = 2,
+};
+
+/**
+ * Merges points tile by tile, so that search structures only ever cover a
+ * bounded number of points, for meshes whose kd-tree would not fit in memory
+ * next to the mesh itself. Space is cut into slabs along the longest axis of
+ * the points, and each slab is searched along with the points of the other
+ * slabs that lie within the merge radius of it. Since any two points to
+ * merge then meet in the tile of either of them, joining the groups found in
+ * all tiles gives the very same result as searching all points at once.
+ * Tiles are searched one after the other, each by all threads.
+ */
+class TiledMerge {
+public:
+	using Real = float;
+
+	/**
+	 * Merge the point_count points whose xyz float coordinates are read from
+	 * point_data, separated by stride bytes. The points must stay valid
+	 * while calling equivalentAll(). Tiles are allocated from arena if it is
+	 * not null.
+	 */
+	TiledMerge(int point_count, const char *point_data, int stride, int thread_count = 0, ScratchArena *arena = nullptr);
+
+	/**
+	 * Same contract as KDTree::equivalentAll(), using the given backend in
+	 * each tile (Auto picks one per tile). Tiles hold at most max_tile_points
+	 * points besides the ones they share with their neighbours, unless more
+	 * than this many points fall in a single bin of the histogram that slabs
+	 * are cut from, e.g. on a plane across the axis.
+	 * If point_order is not null, it receives the index of every point, tile
+	 * after tile, each tile being in the order of its search structure, a
+	 * spatially coherent order like KDTree::pointOrder().
+	 */
+	void equivalentAll(Real radius, int max_tile_points, MergeBackend backend, int *assign, int *point_order = nullptr);
+
+	/**
+	 * Max number of points per tile for the scratch memory used by the
+	 * merge, sets and search structure included, to stay within
+	 * memory_cap bytes, or 0 when a single search fits, i.e. when tiling is
+	 * not needed. The cap can not be met when it leaves less than
+	 * kMinTilePoints per tile once the sets are allocated.
+	 */
+	static int tilePoints(int point_count, size_t memory_cap);
+
+	int tileCount() const { return m_tile_count; }
+
+	/**
+	 * Number of points searched by more than one tile, counted once per
+	 * extra tile
+	 */
+	int64_t sharedPointCount() const { return m_shared_point_count; }
+
+	/**
+	 * Number of points of the largest tile, shared ones included
+	 */
+	int largestTile() const { return m_largest_tile; }
+
+	/**
+	 * Nodes or cell pairs visited by the searches of all tiles
+	 */
+	int64_t visitCount() const { return m_visit_count; }
+
+	/**
+	 * Number of bytes held by the sets and the largest tile, search
+	 * structure included
+	 */
+	size_t memoryUsage() const { return m_memory_usage; }
+
+public:
+	// Resolution of the histogram of coordinates along the axis
+	static constexpr int kHistogramBins = 1 << 16;
+	// Scratch bytes per point of a tile, rounded up from the peak measured
+	// on scans: the gathered positions and indices, the search structure,
+	// its construction buffers and the sets of the search
+	static constexpr size_t kBytesPerPoint = 64;
+	// Scratch bytes per point of the whole mesh: the sets joining the groups
+	// found by all tiles
+	static constexpr size_t kSetBytesPerPoint = sizeof(int);
+	// Fewest points per tile, when the sets alone take most of the memory
+	static constexpr int kMinTilePoints = 1 << 12;
+
+private:
+	AttributeView<const Real, 3> m_points;
+	int m_thread_count;
+	ScratchArena *m_arena;
+
+	int m_tile_count;
+	int64_t m_shared_point_count;
+	int m_largest_tile;
+	int64_t m_visit_count;
+	size_t m_memory_usage;
+};
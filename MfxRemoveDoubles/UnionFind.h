@@ -0,0 +1,127 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+#include <MfxCommon/Parallel.h>
+#include <MfxCommon/ScratchArena.h>
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+/**
+ * Disjoint sets over point indices that can be merged concurrently. The root
+ * of a set is always its lowest index, so once all merges are done the
+ * representative of each point does not depend on the order in which merges
+ * happened, nor on the number of threads.
+ *
+ * If arena is not null, the sets are allocated from it, and must be
+ * destroyed before the arena is rewound past the point where they were.
+ */
+class UnionFind {
+public:
+	explicit UnionFind(int count, int thread_count = 0, ScratchArena *arena = nullptr)
+		: m_arena(arena)
+		, m_count(count)
+	{
+		void *memory = nullptr != m_arena ? m_arena->allocate(bytes()) : ::operator new(bytes());
+		m_parent = static_cast<std::atomic<int>*>(memory);
+		parallelFor(0, count, 1 << 16, thread_count, [this](int b, int e) {
+			for (int i = b; i < e; ++i) {
+				new (&m_parent[i]) std::atomic<int>(i);
+			}
+		});
+	}
+
+	~UnionFind() {
+		// Atomic ints need no destruction
+		if (nullptr != m_arena) {
+			m_arena->deallocate(m_parent, bytes());
+		}
+		else {
+			::operator delete(m_parent);
+		}
+	}
+
+	UnionFind(const UnionFind &) = delete;
+	UnionFind & operator=(const UnionFind &) = delete;
+
+	/**
+	 * Bytes taken by count sets
+	 */
+	static size_t bytes(int count) {
+		return static_cast<size_t>(count) * sizeof(std::atomic<int>);
+	}
+
+	/**
+	 * Root of the set containing i, halving the path on the way
+	 */
+	int find(int i) {
+		while (true) {
+			int p = m_parent[i].load();
+			if (p == i) return i;
+			int gp = m_parent[p].load();
+			if (gp != p) {
+				m_parent[i].compare_exchange_weak(p, gp);
+			}
+			i = gp;
+		}
+	}
+
+	/**
+	 * Merge the sets containing a and b, the larger root is linked below the
+	 * smaller one.
+	 */
+	void unite(int a, int b) {
+		while (true) {
+			a = find(a);
+			b = find(b);
+			if (a == b) return;
+			if (a < b) std::swap(a, b);
+			int expected = a;
+			if (m_parent[a].compare_exchange_strong(expected, b)) return;
+		}
+	}
+
+	/**
+	 * Write the representative of each element to assign. Must not run
+	 * concurrently with unite().
+	 */
+	void flatten(int *assign, int thread_count = 0) {
+		parallelFor(0, m_count, 1 << 16, thread_count, [this, assign](int b, int e) {
+			for (int i = b; i < e; ++i) {
+				assign[i] = find(i);
+			}
+		});
+	}
+
+private:
+	size_t bytes() const { return bytes(m_count); }
+
+private:
+	ScratchArena *m_arena;
+	std::atomic<int> *m_parent;
+	int m_count;
+};
@@ -0,0 +1,330 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019-2022 -- Élie Michel <elie.michel@exppad.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+/**
+ * Checks the point merge backends against a brute force search of the
+ * groups of points closer than the radius, and MeshCompaction against a
+ * naive rebuild of the topology. Run by ctest with several MFX_THREADS
+ * values, since results must not depend on the number of threads.
+ */
+
+#include "MfxRemoveDoubles/KDTree.h"
+#include "MfxRemoveDoubles/MeshCompaction.h"
+#include "MfxRemoveDoubles/SpatialGrid.h"
+#include "MfxRemoveDoubles/TiledMerge.h"
+#include "MfxCommon/ScratchArena.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+static int s_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		++s_failures; \
+	} \
+} while (0)
+
+static constexpr float kRadius = 0.1f;
+
+/**
+ * Points with a stride of 4 floats, so that the strided paths are used.
+ * Clusters of duplicates, some exactly equal, lie on a lattice of step 1,
+ * and chains of points 0.07 apart are merged only transitively. All
+ * distances are far enough from the radius for rounding not to matter.
+ */
+static std::vector<float> make_points(int cluster_count, int chain_count, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> jitter(-0.005f, 0.005f);
+	std::uniform_int_distribution<int> cell(0, 15);
+	std::uniform_int_distribution<int> multiplicity(1, 6);
+	std::vector<float> xyz;
+	auto add = [&](float x, float y, float z) {
+		xyz.insert(xyz.end(), { x, y, z, 0.0f });
+	};
+
+	for (int c = 0; c < cluster_count; ++c) {
+		float x = static_cast<float>(cell(rng)), y = static_cast<float>(cell(rng)), z = static_cast<float>(cell(rng));
+		int count = multiplicity(rng);
+		for (int i = 0; i < count; ++i) {
+			if (i % 2 == 0) add(x, y, z);
+			else add(x + jitter(rng), y + jitter(rng), z + jitter(rng));
+		}
+	}
+
+	// Chains run along x from the middle of lattice cells
+	for (int c = 0; c < chain_count; ++c) {
+		float y = cell(rng) + 0.5f, z = cell(rng) + 0.5f;
+		for (int i = 0; i < 12; ++i) {
+			add(0.2f + 0.07f * i + jitter(rng), y + jitter(rng), z + jitter(rng));
+		}
+	}
+
+	// Shuffle the points, so that the lowest index of a group is anywhere
+	int point_count = static_cast<int>(xyz.size() / 4);
+	std::vector<int> order(point_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), rng);
+	std::vector<float> shuffled(xyz.size());
+	for (int i = 0; i < point_count; ++i) {
+		std::copy_n(&xyz[4 * order[i]], 4, &shuffled[4 * i]);
+	}
+	return shuffled;
+}
+
+static int find_root(std::vector<int> & parent, int i)
+{
+	while (parent[i] != i) i = parent[i] = parent[parent[i]];
+	return i;
+}
+
+static std::vector<int> brute_force_groups(const std::vector<float> & xyz, float radius)
+{
+	int point_count = static_cast<int>(xyz.size() / 4);
+	std::vector<int> parent(point_count);
+	std::iota(parent.begin(), parent.end(), 0);
+	for (int i = 0; i < point_count; ++i) {
+		for (int j = i + 1; j < point_count; ++j) {
+			float dx = xyz[4 * i] - xyz[4 * j], dy = xyz[4 * i + 1] - xyz[4 * j + 1], dz = xyz[4 * i + 2] - xyz[4 * j + 2];
+			if (dx * dx + dy * dy + dz * dz > radius * radius) continue;
+			int a = find_root(parent, i), b = find_root(parent, j);
+			if (a != b) parent[std::max(a, b)] = std::min(a, b);
+		}
+	}
+	std::vector<int> assign(point_count);
+	for (int i = 0; i < point_count; ++i) {
+		assign[i] = find_root(parent, i);
+	}
+	return assign;
+}
+
+static bool is_permutation(const std::vector<int> & order)
+{
+	std::vector<int> sorted = order;
+	std::sort(sorted.begin(), sorted.end());
+	for (int i = 0; i < static_cast<int>(sorted.size()); ++i) {
+		if (sorted[i] != i) return false;
+	}
+	return true;
+}
+
+static void test_merge_backends()
+{
+	for (unsigned int seed = 1; seed <= 3; ++seed) {
+		std::vector<float> xyz = make_points(800, 20, seed);
+		int point_count = static_cast<int>(xyz.size() / 4);
+		const char *data = reinterpret_cast<const char*>(xyz.data());
+		int stride = 4 * sizeof(float);
+		std::vector<int> expected = brute_force_groups(xyz, kRadius);
+		ScratchArena arena;
+
+		{
+			std::vector<int> assign(point_count, -1);
+			KDTree tree(point_count, data, stride, 0, &arena);
+			tree.equivalentAll(kRadius, assign.data());
+			CHECK(assign == expected);
+		}
+
+		{
+			std::vector<int> assign(point_count, -1);
+			bounds_t bounds = SpatialGrid::computeBounds(point_count, data, stride);
+			SpatialGrid grid(point_count, data, stride, bounds, kRadius, 0, &arena);
+			grid.equivalentAll(kRadius, assign.data());
+			CHECK(assign == expected);
+			CHECK(is_permutation(std::vector<int>(grid.pointOrder(), grid.pointOrder() + point_count)));
+		}
+
+		for (MergeBackend backend : { MergeBackend::Auto, MergeBackend::KDTree, MergeBackend::Grid }) {
+			for (int tile_points : { 64, 500, point_count }) {
+				std::vector<int> assign(point_count, -1), point_order(point_count, -1);
+				TiledMerge merge(point_count, data, stride, 0, &arena);
+				merge.equivalentAll(kRadius, tile_points, backend, assign.data(), point_order.data());
+				CHECK(assign == expected);
+				CHECK(is_permutation(point_order));
+				CHECK(tile_points < point_count || merge.tileCount() == 1);
+			}
+		}
+	}
+}
+
+static void test_tile_points()
+{
+	size_t mb = 1 << 20;
+	CHECK(TiledMerge::tilePoints(1000000, 0) == 0);
+	CHECK(TiledMerge::tilePoints(1000000, 1000 * mb) == 0);
+	// The sets of all points come out of the cap before the tiles
+	int tile_points = TiledMerge::tilePoints(1000000, 32 * mb);
+	CHECK(tile_points > 0);
+	CHECK(1000000 * TiledMerge::kSetBytesPerPoint + tile_points * TiledMerge::kBytesPerPoint <= 32 * mb);
+	CHECK(TiledMerge::tilePoints(100000000, mb) == TiledMerge::kMinTilePoints);
+}
+
+/**
+ * Topology rebuilt the obvious way: kept points are numbered in order,
+ * repeated points of a face are dropped after their first occurrence and
+ * faces left with less than two corners are removed.
+ */
+struct naive_mesh_t {
+	std::vector<int> point_sources;
+	std::vector<int> corners;
+	std::vector<int> face_sizes;
+	std::vector<int> face_sources;
+};
+
+static naive_mesh_t naive_compaction(const std::vector<int> & assign, const std::vector<int> & corners, const std::vector<int> & face_sizes, const int *point_order)
+{
+	int point_count = static_cast<int>(assign.size());
+	naive_mesh_t mesh;
+	std::vector<int> point_index(point_count, -1);
+	for (int i = 0; i < point_count; ++i) {
+		int p = nullptr != point_order ? point_order[i] : i;
+		if (assign[p] != p) continue;
+		point_index[p] = static_cast<int>(mesh.point_sources.size());
+		mesh.point_sources.push_back(p);
+	}
+
+	int begin = 0;
+	for (int f = 0; f < static_cast<int>(face_sizes.size()); ++f) {
+		std::vector<int> face;
+		for (int j = begin; j < begin + face_sizes[f]; ++j) {
+			int p = point_index[assign[corners[j]]];
+			if (std::find(face.begin(), face.end(), p) == face.end()) face.push_back(p);
+		}
+		begin += face_sizes[f];
+		if (face.size() < 2) continue;
+		mesh.corners.insert(mesh.corners.end(), face.begin(), face.end());
+		mesh.face_sizes.push_back(static_cast<int>(face.size()));
+		mesh.face_sources.push_back(f);
+	}
+	return mesh;
+}
+
+static void check_compaction(const std::vector<int> & assign, const std::vector<int> & corners, const std::vector<int> & face_sizes, int constant_face_size, const int *point_order)
+{
+	int point_count = static_cast<int>(assign.size());
+	int face_count = static_cast<int>(face_sizes.size());
+	naive_mesh_t expected = naive_compaction(assign, corners, face_sizes, point_order);
+	int failures = s_failures;
+
+	ScratchArena arena;
+	MeshCompaction compaction(0, &arena);
+	compaction.count(
+		assign.data(), point_count,
+		reinterpret_cast<const char*>(corners.data()), sizeof(int), static_cast<int>(corners.size()),
+		constant_face_size > 0 ? nullptr : reinterpret_cast<const char*>(face_sizes.data()), sizeof(int), face_count,
+		constant_face_size
+	);
+	if (nullptr != point_order) compaction.reorderPoints(point_order);
+
+	CHECK(compaction.outputPointCount() == static_cast<int>(expected.point_sources.size()));
+	CHECK(compaction.outputCornerCount() == static_cast<int>(expected.corners.size()));
+	CHECK(compaction.outputFaceCount() == static_cast<int>(expected.face_sizes.size()));
+	if (s_failures > failures) return;
+
+	std::vector<int> point_sources(compaction.outputPointCount());
+	std::vector<int> out_corners(compaction.outputCornerCount());
+	std::vector<int> out_face_sizes(compaction.outputFaceCount());
+	std::vector<int> face_sources(compaction.outputFaceCount());
+	compaction.writePointSources(point_sources.data());
+	compaction.writeCorners(reinterpret_cast<char*>(out_corners.data()), sizeof(int));
+	compaction.writeFaceSources(face_sources.data());
+	CHECK(point_sources == expected.point_sources);
+	CHECK(out_corners == expected.corners);
+	CHECK(face_sources == expected.face_sources);
+
+	bool all_full = std::all_of(expected.face_sizes.begin(), expected.face_sizes.end(), [&](int size) { return size == constant_face_size; });
+	if (constant_face_size > 0 && all_full) {
+		CHECK(compaction.outputConstantFaceSize() == constant_face_size);
+	}
+	else {
+		CHECK(compaction.outputConstantFaceSize() <= 0);
+		compaction.writeFaceSizes(reinterpret_cast<char*>(out_face_sizes.data()), sizeof(int));
+		CHECK(out_face_sizes == expected.face_sizes);
+	}
+
+	// Positions of kept points, copied by writePoints()
+	std::vector<float> positions(3 * static_cast<size_t>(point_count));
+	std::iota(positions.begin(), positions.end(), 0.0f);
+	std::vector<float> out_positions(3 * point_sources.size());
+	compaction.writePoints(reinterpret_cast<const char*>(positions.data()), 3 * sizeof(float), reinterpret_cast<char*>(out_positions.data()), 3 * sizeof(float), 3 * sizeof(float));
+	for (size_t i = 0; i < point_sources.size(); ++i) {
+		CHECK(out_positions[3 * i] == positions[3 * static_cast<size_t>(point_sources[i])]);
+	}
+}
+
+static void test_mesh_compaction()
+{
+	std::vector<float> xyz = make_points(3000, 50, 7);
+	int point_count = static_cast<int>(xyz.size() / 4);
+	std::vector<int> assign = brute_force_groups(xyz, kRadius);
+	std::mt19937 rng(11);
+	std::uniform_int_distribution<int> any_point(0, point_count - 1);
+
+	// Spatial order of the points, from a kd-tree
+	ScratchArena arena;
+	KDTree tree(point_count, reinterpret_cast<const char*>(xyz.data()), 4 * sizeof(float), 0, &arena);
+	std::vector<int> point_order(tree.pointOrder(), tree.pointOrder() + point_count);
+
+	// Triangles, quads, and faces of up to 40 corners to go past the small
+	// face buffer, with corners often on merged points
+	for (int constant_face_size : { 3, 4, -1 }) {
+		std::uniform_int_distribution<int> any_size(2, 2 * MeshCompaction::kSmallFaceSize + 8);
+		std::vector<int> corners, face_sizes;
+		for (int f = 0; f < 20000; ++f) {
+			int size = constant_face_size > 0 ? constant_face_size : any_size(rng);
+			int p = any_point(rng);
+			for (int j = 0; j < size; ++j) {
+				corners.push_back(j % 3 == 2 ? p : any_point(rng));
+			}
+			face_sizes.push_back(size);
+		}
+		check_compaction(assign, corners, face_sizes, constant_face_size, nullptr);
+		check_compaction(assign, corners, face_sizes, constant_face_size, point_order.data());
+	}
+
+	// No point merged: every face keeps its size
+	std::vector<int> identity(point_count);
+	std::iota(identity.begin(), identity.end(), 0);
+	std::vector<int> corners(3 * 1000), face_sizes(1000, 3);
+	for (int & c : corners) c = any_point(rng);
+	check_compaction(identity, corners, face_sizes, 3, nullptr);
+}
+
+int main()
+{
+	test_merge_backends();
+	test_tile_points();
+	test_mesh_compaction();
+	if (s_failures > 0) {
+		fprintf(stderr, "%d checks failed\n", s_failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
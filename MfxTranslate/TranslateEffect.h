@@ -0,0 +1,280 @@
+/**
+ * This file is part of MfxPlugins
+ *
+ * Copyright (c) 2019 - 2020 -- Élie Michel <elie.michel@exppad.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * The Software is provided “as is”, without warranty of any kind, express or
+ * implied, including but not limited to the warranties of merchantability,
+ * fitness for a particular purpose and non-infringement. In no event shall the
+ * authors or copyright holders be liable for any claim, damages or other
+ * liability, whether in an action of contract, tort or otherwise, arising
+ * from, out of or in connection with the software or the use or other dealings
+ * in the Software.
+ */
+
+#pragma once
+
+/**
+ * Translate modifier is a very simple demo showcasing the C++ API. Besides a
+ * translation, it can rotate and scale the mesh, which also turns its normals.
+ */
+
+#include <OpenMfx/Sdk/Cpp/Plugin/MfxEffect>
+
+#include <MfxCommon/AttributeForwarding.h>
+#include <MfxCommon/AttributeView.h>
+#include <MfxCommon/PointTransform.h>
+#include <MfxCommon/Profiling.h>
+#include <MfxCommon/TaskScheduler.h>
+
+#include <vector>
+
+// Point attribute that scales how far each point moves, if the host has one
+static const char *kWeightAttribute = "weight";
+
+/**
+ * Normal attribute of the input mesh, i.e. three floats with the normal
+ * semantic, transformed along with the points
+ */
+struct normal_attribute_t {
+	MfxAttributeAttachment attachment;
+	const char *name;
+	MfxAttributeProps props;
+	bool forwarded;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class TranslateEffect : public MfxEffect {
+public:
+	const char* GetName() override
+	{ return "Translate"; }
+
+protected:
+	OfxStatus Describe(OfxMeshEffectHandle descriptor) override {
+		AddInput(kOfxMeshMainInput)
+			.RequestAttribute(
+				MfxAttributeAttachment::Point,
+				kWeightAttribute,
+				1,
+				MfxAttributeType::Float,
+				MfxAttributeSemantic::Weight,
+				false
+			);
+		AddInput(kOfxMeshMainOutput);
+
+		AddParam("translation", double3{ 0.0, 0.0, 0.0 })
+			.Label("Translation");
+
+		AddParam("rotation", double3{ 0.0, 0.0, 0.0 })
+			.Label("Rotation (degrees, XYZ)");
+
+		AddParam("scale", double3{ 1.0, 1.0, 1.0 })
+			.Label("Scale");
+
+		AddParam("threads", 0)
+			.Label("Threads (0: all, as allowed by MFX_THREADS)")
+			.Range(0, 1024);
+
+		return kOfxStatOK;
+	}
+
+	OfxStatus Cook(OfxMeshEffectHandle instance) override {
+		CookProfile profile(GetName());
+		ThreadCapScope thread_cap(GetParam<int>("threads").GetValue());
+		profileCounter("threads", threadCap());
+
+		ProfileScope fetch_scope("fetch");
+		MfxMesh inputMesh = GetInput(kOfxMeshMainInput).GetMesh();
+		MfxMesh outputMesh = GetInput(kOfxMeshMainOutput).GetMesh();
+		double3 translation = GetParam<double3>("translation").GetValue();
+		double3 rotation = GetParam<double3>("rotation").GetValue();
+		double3 scale = GetParam<double3>("scale").GetValue();
+		affine_transform_t transform = trsTransform(&translation[0], &rotation[0], &scale[0]);
+
+		MfxMeshProps inputMeshProps;
+		inputMesh.FetchProperties(inputMeshProps);
+
+		// Weights blend each point between where it is and where the
+		// transform sends it, so that a translation without weights is the
+		// only case where nothing turns
+		MfxAttributeProps weightProps = {};
+		bool weighted = false;
+		if (inputMesh.HasPointAttribute(kWeightAttribute)) {
+			inputMesh.GetPointAttribute(kWeightAttribute).FetchProperties(weightProps);
+			weighted = weightProps.type == MfxAttributeType::Float && weightProps.componentCount == 1;
+		}
+		bool translationOnly = !weighted && isTranslation(transform);
+		std::vector<normal_attribute_t> normals = normalAttributes(inputMesh);
+		fetch_scope.stop();
+		profileCounter("translation only", static_cast<int>(translationOnly));
+		profileCounter("normal attributes", static_cast<int>(normals.size()));
+
+		// Topology is left untouched, so it is forwarded rather than copied
+		ProfileScope forward_scope("forward");
+		MfxAttribute inputPoints = inputMesh.GetCornerAttribute(kOfxMeshAttribCornerPoint);
+		MfxAttribute outputPoints = outputMesh.GetCornerAttribute(kOfxMeshAttribCornerPoint);
+		bool forwardedPoints = forwardAttribute(outputPoints, inputPoints);
+
+		// Meshes whose faces have a constant size have no face size to pass on
+		int constantFaceSize = inputMeshProps.constantFaceSize;
+		MfxAttribute inputFaces = inputMesh.GetFaceAttribute(kOfxMeshAttribFaceSize);
+		MfxAttribute outputFaces = outputMesh.GetFaceAttribute(kOfxMeshAttribFaceSize);
+		bool forwardedFaces = constantFaceSize > 0 || forwardAttribute(outputFaces, inputFaces);
+
+		// So are normals, when the mesh does not turn
+		int forwardedNormals = 0;
+		for (normal_attribute_t & normal : normals) {
+			MfxAttribute output = outputMesh.AddAttribute(normal.attachment, normal.name, 3, MfxAttributeType::Float, MfxAttributeSemantic::Normal);
+			normal.forwarded = translationOnly && forwardAttribute(output, meshAttribute(inputMesh, normal.attachment, normal.name));
+			forwardedNormals += static_cast<int>(normal.forwarded);
+		}
+		forward_scope.stop();
+
+		ProfileScope allocate_scope("allocate");
+		outputMesh.Allocate(inputMeshProps.pointCount, inputMeshProps.cornerCount, inputMeshProps.faceCount, inputMeshProps.noLooseEdge, constantFaceSize);
+
+		MfxAttributeProps inputPos, outputPos;
+		inputMesh.GetPointAttribute(kOfxMeshAttribPointPosition).FetchProperties(inputPos);
+		outputMesh.GetPointAttribute(kOfxMeshAttribPointPosition).FetchProperties(outputPos);
+		allocate_scope.stop();
+
+		// Positions and the first point normal go through a single pass,
+		// other normals through their own
+		ProfileScope transform_scope("transform");
+		point_transform_buffers_t positions;
+		positions.src = inputPos.data;
+		positions.src_stride = inputPos.stride;
+		positions.dst = outputPos.data;
+		positions.dst_stride = outputPos.stride;
+		if (weighted) {
+			positions.weights = weightProps.data;
+			positions.weight_stride = weightProps.stride;
+		}
+		std::vector<float> cornerWeights;
+		for (const normal_attribute_t & normal : normals) {
+			if (normal.forwarded) continue;
+			MfxAttributeProps outputProps;
+			meshAttribute(outputMesh, normal.attachment, normal.name).FetchProperties(outputProps);
+			point_transform_buffers_t buffers;
+			buffers.normal_src = normal.props.data;
+			buffers.normal_src_stride = normal.props.stride;
+			buffers.normal_dst = outputProps.data;
+			buffers.normal_dst_stride = outputProps.stride;
+			int count = elementCount(inputMeshProps, normal.attachment);
+
+			switch (normal.attachment) {
+			case MfxAttributeAttachment::Point:
+				if (nullptr == positions.normal_src) {
+					positions.normal_src = buffers.normal_src;
+					positions.normal_src_stride = buffers.normal_src_stride;
+					positions.normal_dst = buffers.normal_dst;
+					positions.normal_dst_stride = buffers.normal_dst_stride;
+					continue;
+				}
+				buffers.weights = positions.weights;
+				buffers.weight_stride = positions.weight_stride;
+				break;
+			case MfxAttributeAttachment::Corner:
+				// Corners turn as much as their point
+				if (weighted) {
+					if (cornerWeights.empty()) {
+						cornerWeights = gatherCornerWeights(inputMesh, weightProps, inputMeshProps.cornerCount);
+					}
+					buffers.weights = reinterpret_cast<const char*>(cornerWeights.data());
+					buffers.weight_stride = sizeof(float);
+				}
+				break;
+			default:
+				// Faces have no weight of their own, so their normals turn
+				// all the way
+				break;
+			}
+			transformPoints(buffers, count, transform);
+		}
+		transformPoints(positions, inputMeshProps.pointCount, transform);
+		transform_scope.stop();
+
+		ProfileScope copy_scope("copy");
+		if (!forwardedPoints) {
+			outputPoints.CopyFrom(inputPoints, 0, inputMeshProps.cornerCount);
+		}
+		if (!forwardedFaces) {
+			outputFaces.CopyFrom(inputFaces, 0, inputMeshProps.faceCount);
+		}
+		copy_scope.stop();
+		profileCounter("attributes forwarded", static_cast<int>(forwardedPoints) + static_cast<int>(forwardedFaces) + forwardedNormals);
+
+		ProfileScope release_scope("release");
+		inputMesh.Release();
+		outputMesh.Release();
+		return kOfxStatOK;
+	}
+
+	/**
+	 * Attributes of mesh that hold normals, skipping those whose layout is
+	 * not three floats
+	 */
+	static std::vector<normal_attribute_t> normalAttributes(MfxMesh & mesh) {
+		std::vector<normal_attribute_t> normals;
+		int attribute_count = mesh.GetAttributeCount();
+		for (int i = 0; i < attribute_count; ++i) {
+			MfxAttribute attribute = mesh.GetAttributeByIndex(i);
+			normal_attribute_t normal;
+			normal.attachment = attribute.GetAttachment();
+			normal.name = attribute.GetName();
+			normal.forwarded = false;
+			attribute.FetchProperties(normal.props);
+
+			if (normal.props.semantic != MfxAttributeSemantic::Normal
+				|| normal.props.type != MfxAttributeType::Float
+				|| normal.props.componentCount != 3
+				|| normal.attachment == MfxAttributeAttachment::Mesh) continue;
+			normals.push_back(normal);
+		}
+		return normals;
+	}
+
+	/**
+	 * Weight of the point of each corner
+	 */
+	static std::vector<float> gatherCornerWeights(MfxMesh & mesh, const MfxAttributeProps & weights, int corner_count) {
+		MfxAttributeProps cornerPoints;
+		mesh.GetCornerAttribute(kOfxMeshAttribCornerPoint).FetchProperties(cornerPoints);
+		std::vector<float> corner_weights(corner_count);
+		AttributeView<const int> corner_points = attributeView<const int>(cornerPoints, corner_count);
+		AttributeView<const float> point_weights = attributeView<const float>(weights, 0);
+		transformAttribute(corner_points, AttributeView<float>::packed(corner_weights.data(), corner_count), [&](const int *point, float *w) {
+			*w = *point_weights[*point];
+		});
+		return corner_weights;
+	}
+
+	static MfxAttribute meshAttribute(MfxMesh & mesh, MfxAttributeAttachment attachment, const char *name) {
+		switch (attachment) {
+		case MfxAttributeAttachment::Point: return mesh.GetPointAttribute(name);
+		case MfxAttributeAttachment::Corner: return mesh.GetCornerAttribute(name);
+		case MfxAttributeAttachment::Face: return mesh.GetFaceAttribute(name);
+		default: return mesh.GetMeshAttribute(name);
+		}
+	}
+
+	static int elementCount(const MfxMeshProps & props, MfxAttributeAttachment attachment) {
+		switch (attachment) {
+		case MfxAttributeAttachment::Point: return props.pointCount;
+		case MfxAttributeAttachment::Corner: return props.cornerCount;
+		case MfxAttributeAttachment::Face: return props.faceCount;
+		default: return 1;
+		}
+	}
+};
@@ -7,10 +7,108 @@ function(target_treat_warnings_as_errors target)
 	endif()
 endfunction()
 
+# Instruction set levels that dispatched sources are compiled for on top of
+# the baseline, and the compiler flags of each level. They must match the
+# features that CpuDispatch.cpp checks before picking a level.
+set(MFX_ISA_LEVELS)
+if (MFX_ISA_DISPATCH AND CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86_64|AMD64|amd64|x64)$")
+  if (MSVC)
+    set(MFX_ISA_FLAGS_avx2 /arch:AVX2)
+    set(MFX_ISA_FLAGS_avx512 /arch:AVX512)
+  else()
+    # No FMA contraction, so that every level rounds like the baseline, and
+    # no errno from sqrt, which would keep it from being vectorized
+    set(MFX_ISA_FLAGS_baseline -ffp-contract=off -fno-math-errno)
+    set(MFX_ISA_FLAGS_avx2 -mavx2 -mfma -ffp-contract=off -fno-math-errno)
+    set(MFX_ISA_FLAGS_avx512 -mavx2 -mfma -mavx512f -mavx512vl -mavx512bw -mavx512dq -ffp-contract=off -fno-math-errno)
+  endif()
+  set(MFX_ISA_LEVELS avx2 avx512)
+endif()
+
+# Compile sources once per instruction set level into target. Each copy
+# defines MFX_ISA to the name of its level, which MFX_ISA_NAME() appends to
+# the kernels it defines, and the target gets MFX_HAS_ISA_<LEVEL> for each
+# level so that MFX_ISA_SELECT() only picks variants that exist.
+# Dispatched sources must only contain functions with internal linkage
+# besides their kernels, and no inline function shared with other sources,
+# lest the linker keeps a copy built for a level the CPU lacks. They are not
+# link time optimized, which could inline them across levels.
+function(mfx_add_dispatch_sources Target)
+  foreach(level baseline ${MFX_ISA_LEVELS})
+    set(object_target ${Target}_${level})
+    add_library(${object_target} OBJECT ${ARGN})
+    set_target_properties(${object_target} PROPERTIES POSITION_INDEPENDENT_CODE ON)
+    target_include_directories(${object_target} PRIVATE ${PROJECT_SOURCE_DIR})
+    target_compile_definitions(${object_target} PRIVATE MFX_ISA=${level})
+    target_compile_options(${object_target} PRIVATE ${MFX_ISA_FLAGS_${level}})
+    target_sources(${Target} PRIVATE $<TARGET_OBJECTS:${object_target}>)
+    if (NOT level STREQUAL "baseline")
+      string(TOUPPER ${level} upper_level)
+      target_compile_definitions(${Target} PRIVATE MFX_HAS_ISA_${upper_level})
+    endif()
+  endforeach()
+endfunction()
+
+# Link time optimization of release builds, when the toolchain supports it
+if (MFX_LTO)
+  include(CheckIPOSupported)
+  check_ipo_supported(RESULT MFX_LTO_SUPPORTED OUTPUT lto_error LANGUAGES CXX)
+  if (NOT MFX_LTO_SUPPORTED)
+    message(STATUS "Link time optimization is not supported: ${lto_error}")
+  endif()
+endif()
+
+function(mfx_enable_lto Target)
+  if (MFX_LTO AND MFX_LTO_SUPPORTED)
+    set_target_properties(
+      ${Target} PROPERTIES
+      INTERPROCEDURAL_OPTIMIZATION_RELEASE ON
+      INTERPROCEDURAL_OPTIMIZATION_RELWITHDEBINFO ON
+      INTERPROCEDURAL_OPTIMIZATION_MINSIZEREL ON
+    )
+  endif()
+endfunction()
+
+# The implementation of an effect, i.e. everything but its registration, as a
+# library linked both by the plugin of the effect and by the MfxBundle plugin.
+# Effects whose code is all in headers get an interface library.
+macro(add_openmfx_effect Target)
+  set(options)
+  set(oneValueArgs)
+  set(multiValueArgs SRC DISPATCH_SRC LIBS)
+  cmake_parse_arguments("" "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+  set(_compiled_src ${_SRC})
+  list(FILTER _compiled_src INCLUDE REGEX "\\.(c|cc|cpp|cxx)$")
+  if (_compiled_src OR _DISPATCH_SRC)
+    add_library(${Target} STATIC ${_SRC})
+    # Linked into plugins, which are shared libraries
+    set_target_properties(${Target} PROPERTIES POSITION_INDEPENDENT_CODE ON)
+    target_link_libraries(${Target} PUBLIC ${_LIBS})
+    if (_DISPATCH_SRC)
+      mfx_add_dispatch_sources(${Target} ${_DISPATCH_SRC})
+    endif()
+    mfx_enable_lto(${Target})
+  else()
+    add_library(${Target} INTERFACE)
+    target_link_libraries(${Target} INTERFACE ${_LIBS})
+  endif()
+endmacro()
+
+# Copy the MfxRuntime shared library next to the binary of a target, where
+# plugins look for it and where Windows finds it for executables
+function(mfx_copy_runtime Target)
+  add_custom_command(
+    TARGET ${Target} POST_BUILD
+    COMMAND ${CMAKE_COMMAND} -E copy_if_different
+      $<TARGET_FILE:MfxRuntime> $<TARGET_FILE_DIR:${Target}>
+  )
+endfunction()
+
 macro(add_openmfx_plugin Target)
   set(options TREAT_WARNINGS_AS_ERRORS)
   set(oneValueArgs)
-  set(multiValueArgs SRC LIBS)
+  set(multiValueArgs SRC DISPATCH_SRC LIBS)
   cmake_parse_arguments("" "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
 
   # An OpenMfx plugin is a shared library with a different extension
@@ -19,7 +117,24 @@ macro(add_openmfx_plugin Target)
 
   target_link_libraries(${Target} PRIVATE ${_LIBS})
 
+  # Ship the shared runtime next to the plugin, and look for it there. Hosts
+  # load it once per process whichever copy they find first.
+  if (APPLE)
+    set_target_properties(${Target} PROPERTIES INSTALL_RPATH "@loader_path")
+  else()
+    set_target_properties(${Target} PROPERTIES INSTALL_RPATH "$ORIGIN")
+  endif()
+  set_target_properties(${Target} PROPERTIES BUILD_WITH_INSTALL_RPATH ON)
+  mfx_copy_runtime(${Target})
+
   if (DEFINED _TREAT_WARNINGS_AS_ERRORS)
     target_link_libraries(${Target} PRIVATE OpenMfx::Sdk::Cpp::Plugin)
   endif()
+
+  # Hot kernels, compiled for each instruction set level and picked at load
+  if (_DISPATCH_SRC)
+    mfx_add_dispatch_sources(${Target} ${_DISPATCH_SRC})
+  endif()
+
+  mfx_enable_lto(${Target})
 endmacro()